@@ -1,6 +1,9 @@
 #include "Application.h"
 #include "Rasterization_Functions.h"
-#include "Camera.h"
+#include "SceneBenchmark.h"
+#include <cstring>
+#include <ctime>
+#include <string>
 
 #include "Textures/InnSigns/celestial.h"
 #include "Textures/InnSigns/flower.h"
@@ -10,54 +13,33 @@
 #include "StoneHenge.h"
 #include "StoneHenge_Texture.h"
 
-void GenerateMipMapForTexture(Texture& lastTexture)
-{
-	Texture* newTexture = new Texture();
-	newTexture->Width = lastTexture.Width / 2;
-	newTexture->Height = lastTexture.Height / 2;
-	newTexture->NumOfPixels = newTexture->Width * newTexture->Height;
-
-	unsigned int* pixels = new unsigned int[newTexture->NumOfPixels];
-
-	for (unsigned int i = 0; i < lastTexture.Height; i += 2)
-	{
-		for (unsigned int j = 0; j < lastTexture.Width; j += 2)
-		{
-			unsigned int position = Math::Convert2DTo1D(j, i, lastTexture.Width);
-
-			unsigned int nextPixel = (position + 1) % lastTexture.NumOfPixels;
-			unsigned int bottomPixel = (position + lastTexture.Width) % lastTexture.NumOfPixels;
-			unsigned int diagonalPixel = (bottomPixel + 1) % lastTexture.NumOfPixels;
-
-			unsigned int color1 = Math::LerpColor(lastTexture.Pixels[position], (lastTexture.Pixels[nextPixel % lastTexture.NumOfPixels]), 0.5f);
-			unsigned int color2 = Math::LerpColor((lastTexture.Pixels[bottomPixel % lastTexture.NumOfPixels]), (lastTexture.Pixels[diagonalPixel % lastTexture.NumOfPixels]), 0.5f);
-			pixels[Math::Convert2DTo1D(j / 2, i / 2, newTexture->Width)] = Math::LerpColor(color1, color2, 0.5f);
-		}
-	}
-
-	newTexture->Pixels = pixels;
-	Textures.push_back(newTexture);
-
-	if (newTexture->Width != 1 && newTexture->Height != 1)
-	{
-		GenerateMipMapForTexture(*newTexture);
-	}
-}
+#if !defined(_WIN32)
+/* No window to take keyboard input from, every key reads as up */
+inline short GetAsyncKeyState(int virtualKey) { return 0; }
+#endif
 
-void InitializeStars()
+/* Scatters the stars in a 100 unit cube. Uses its own generator, rand() differs between C runtimes and a seed has to give the same sky everywhere */
+void InitializeStars(unsigned int seed)
 {
-	srand(time(NULL));
+	// xorshift32, 0 is its only fixed point
+	unsigned int state = seed ? seed : 1;
+	auto nextRandom = [&state]()
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return (state >> 8) * (1.0f / 16777216.0f);
+	};
 
 	Vertex starVertex;
 	starVertex.W = 1.0f;
 	starVertex.Color = WHITE;
 
-	float randScalar = (1.0f / (RAND_MAX * 0.5f));
 	for (int i = 0; i < STARS_COUNT; i++)
 	{
-		starVertex.X = ((rand() * randScalar) - 1.0f) * 50.0f;
-		starVertex.Y = ((rand() * randScalar) - 1.0f) * 50.0f;
-		starVertex.Z = ((rand() * randScalar) - 1.0f) * 50.0f;
+		starVertex.X = (nextRandom() * 2.0f - 1.0f) * 50.0f;
+		starVertex.Y = (nextRandom() * 2.0f - 1.0f) * 50.0f;
+		starVertex.Z = (nextRandom() * 2.0f - 1.0f) * 50.0f;
 
 		starsVertices[i] = starVertex;
 	}
@@ -85,39 +67,61 @@ void InitializeStoneHedge()
 	}
 }
 
-void Application::Init()
+SceneState::SceneState()
+	: TotalTimePassed(0.0f), PointLightRadius(0.0f), Step(0),
+	bPipelinePinned(false), FrameMode(RenderFrameMode::Textured), SamplerFilter(TextureFilter::NEAREST)
 {
+	WorldCamera.Translate(0.0f, 0.0f, -1.0f);
+	WorldCamera.Rotate(0.0f, -18.0f, 0.0f);
+}
+
+void Application::Init(const ApplicationOptions& options)
+{
+	mOptions = options;
+
 	RS_Initialize("Vrij Patel", RASTER_WIDTH, RASTER_HEIGHT);
 
-	InitializeStars();
+	if (options.VideoOutputPath && !mVideoWriter.Open(options.VideoOutputPath, RASTER_WIDTH, RASTER_HEIGHT, static_cast<unsigned int>(1.0f / FRAME_RATE + 0.5f)))
+	{
+		std::cerr << "Could not open video output " << options.VideoOutputPath << std::endl;
+	}
+
+	const char* replayPath = options.SceneBenchmarkPath ? options.SceneBenchmarkPath : options.ReplayInputPath;
+	std::string error;
+	if (replayPath && !mInputPath.Load(replayPath, error))
+	{
+		std::cerr << "Could not load input path: " << error << std::endl;
+		mExitCode = 1;
+		return;
+	}
+
+	// Replays have to see the same sky every time
+	InitializeStars(replayPath ? STARS_REPLAY_SEED : static_cast<unsigned int>(time(NULL)));
 	InitializeStoneHedge();
+	mStoneHedgeVertexBuffer.Assign(stoneHedgeVertices, 1457);
+	Rasterization::InvalidateFrameState(mRenderContext);
 
 	Update();
 }
 
 void Application::Update()
 {
-	VERTEX_SHADER = VS_World;
-	PIXEL_SHADER = PS_RedColor;
+	RenderContext& context = mRenderContext;
 
-	Camera worldCamera;
-	worldCamera.Translate(0.0f, 0.0f, -1.0f);
-	worldCamera.Rotate(0.0f, -18.0f, 0.0f);
+	context.VertexShader = VS_World;
+	context.PixelShader = PS_RedColor;
 
-	float worldCameraTranslateSpeed = 60.0f;
+	context.NearPlane = 0.1f;
+	context.FarPlane = 100.0f;
 
-	SV_NearPlane = 0.1f;
-	SV_FarPlane = 100.0f;
-
-	Matrix4D projectionMatrix = Math::GetProjectionMatrix
+	context.WorldMatrix = Matrix4D::Identity();
+	context.ProjectionMatrix = Math::GetProjectionMatrix
 	(
 		RASTER_WIDTH, RASTER_HEIGHT,
-		90.0f, SV_NearPlane, SV_FarPlane
+		90.0f, context.NearPlane, context.FarPlane
 	);
 
-	float timePassed = 0.0f;
-
-	SV_TextureFilter = TextureFilter::NEAREST;
+	context.SamplerFilter = TextureFilter::NEAREST;
 
 	// Mip Map
 	unsigned int numOFPixels = StoneHenge_width * StoneHenge_height;
@@ -128,147 +132,388 @@ void Application::Update()
 		convertPixels[i] = Math::ConvertBGRAToARGB(StoneHenge_pixels[i]);
 	}
 
-	Texture* stoneHedgeTexture = new Texture(convertPixels, StoneHenge_width, StoneHenge_height, numOFPixels);
-	Textures.push_back(stoneHedgeTexture);
-	GenerateMipMapForTexture(*Textures[0]);
-
-	SV_MaxMipMapLevel = Textures.size() - 1;
+	TextureFormat textureFormat = TEXTURES_COMPRESSED ? BlockCompression::ChooseFormat(convertPixels, numOFPixels) : TextureFormat::ARGB;
+	mStoneHedgeTexture.Build(convertPixels, StoneHenge_width, StoneHenge_height, TEXTURES_TILED ? TextureLayout::Tiled : TextureLayout::Linear, textureFormat);
+	delete[] convertPixels;
 
-	SV_Texture = *Textures[0];
+	context.TextureSampler = Sampler(mStoneHedgeTexture);
 
-	SV_DirectionLightDirection = Vector3D(-0.577f, -0.577f, 0.577f);
-	SV_DirectionalLightColor = 0xFFC0C0F0;
+	context.DirectionLightDirection = Vector3D(-0.577f, -0.577f, 0.577f);
+	context.DirectionalLightColor = 0xFFC0C0F0;
 
-	SV_PointLightPosition = Vector3D(-1.0f, 0.5f, 1.0f);
-	SV_PointLightColor = 0xFFFFFF00;
-	SV_PointLightRadius = 10.0f;
-	float currentPointLightRadius = 0.0f;
+	context.PointLightPosition = Vector3D(-1.0f, 0.5f, 1.0f);
+	context.PointLightColor = 0xFFFFFF00;
+	context.PointLightRadius = 10.0f;
 
-	SV_AmbientTerm = 0.3f;
+	context.AmbientTerm = 0.3f;
 
-	float totalTimePassed = 0.0f;
+	context.FrameMode = RenderFrameMode::Textured;
+	context.bShowTriangleVertexNormals = false;
 
-	renderFrameMode = RenderFrameMode::Textured;
-	bShowTriangleVertexNormals = false;
+	// Frames are drawn straight into the swap chain buffers, the next one is drawn while the last one is presented
+	RS_CreateSwapChain(context.ColorBuffers, SWAP_CHAIN_LENGTH);
+	context.Pixels = RS_AcquireBackBuffer();
 
-	while (RS_Update(pixels, TOTAL_PIXELS))
+	if (mOptions.SceneBenchmarkPath)
 	{
-		timePassed += static_cast<float>(mTimer.Delta());
-		totalTimePassed += static_cast<float>(mTimer.Delta());
+		RunSceneBenchmark();
+	}
+	else
+	{
+		// Paced to FRAME_RATE, or as fast as possible when benchmarking
+		SceneState scene;
+		FrameScheduler scheduler(FRAME_RATE, mOptions.BenchmarkFrames);
+		RunFrames(scene, scheduler, [](const unsigned int* pixels) { });
 
-		if (timePassed > FRAME_RATE)
+		if (scheduler.IsBenchmark())
 		{
-			Rasterization::ClearBuffers(0xff163d49);
+			scheduler.PrintReport(std::cout);
+			FrameProfiler::PrintReport(std::cout);
+		}
 
-			worldCamera.SetViewMatrix();
+		if (mOptions.RecordInputPath)
+		{
+			mInputPath.SetStepCount(scene.Step);
+			if (!mInputPath.Save(mOptions.RecordInputPath))
+			{
+				std::cerr << "Could not save input path " << mOptions.RecordInputPath << std::endl;
+			}
+		}
+	}
 
-			SV_WorldMatrix = Matrix4D::Identity();
-			SV_ViewMatrix = worldCamera.GetViewMatrix();
-			SV_ProjectionMatrix = projectionMatrix;
+	if (mOptions.TracePath)
+	{
+#if PROFILING_ENABLED
+		if (!FrameProfiler::WriteChromeTrace(mOptions.TracePath))
+		{
+			std::cerr << "Could not write trace " << mOptions.TracePath << std::endl;
+		}
+#else
+		std::cerr << "Not writing trace " << mOptions.TracePath << ", profiling is compiled out (PROFILING_ENABLED)" << std::endl;
+#endif // PROFILING_ENABLED
+	}
+}
 
-			worldCameraFowardVector = worldCamera.GetForwardVector();
+void Application::RunSceneBenchmark()
+{
+	RenderContext& context = mRenderContext;
 
-			PIXEL_SHADER = PS_WhiteColor;
-			for (int i = 0; i < STARS_COUNT; i++)
-			{
-				Rasterization::DrawPoint(starsVertices[i]);
-			}
+	const RenderFrameMode frameModes[] = { RenderFrameMode::WireFrame, RenderFrameMode::Textured, RenderFrameMode::Shaded };
+	const TextureFilter samplerFilters[] = { TextureFilter::NEAREST, TextureFilter::BILINEAR, TextureFilter::TRILINEAR };
 
-			/* Point Lighting */
-			currentPointLightRadius += FRAME_RATE * sin(totalTimePassed) * 10.0f;
-			currentPointLightRadius = Math::Clamp(0.0f, 10.0f, currentPointLightRadius);
-			SV_PointLightRadius = currentPointLightRadius;
+	// The path may toggle these, every run starts from the same pipeline
+	const FillPath fillPath = context.TriangleFillPath;
 
-			if (renderFrameMode == RenderFrameMode::Textured || renderFrameMode == RenderFrameMode::Shaded)
-			{
-				PIXEL_SHADER = PS_Texture;
-				Rasterization::DrawTriangleWithIndexBuffer(stoneHedgeVertices, StoneHenge_indicies, 2532);
-			}
-			else
-			{
-				PIXEL_SHADER = PS_GreenColor;
-				Rasterization::DrawTriangleOutlinesWithIndexBuffer(stoneHedgeVertices, StoneHenge_indicies, 2532);
-			}
+	// Goldens only exist for builds they were recorded with, say so before spending the runs on nothing to compare to
+	if (mOptions.GoldenPath && !mOptions.bRecordGolden && !SceneBenchmark::HasGolden(mOptions.GoldenPath))
+	{
+		std::cerr << "No golden hashes at " << mOptions.GoldenPath << ", record them with this build first: --golden "
+			<< mOptions.GoldenPath << " --record-golden" << std::endl;
+		mExitCode = 1;
+		return;
+	}
 
-			// Input
-			if (GetAsyncKeyState(0x31) & 0x01) // 1
-			{
-				SV_TextureFilter = TextureFilter::NEAREST;
-			}
-			else if (GetAsyncKeyState(0x32) & 0x01) // 2
-			{
-				SV_TextureFilter = TextureFilter::BILINEAR;
-			}
-			else if (GetAsyncKeyState(0x33) & 0x01) // 3
+	SceneBenchmark benchmark;
+	bool bCompleted = true;
+	for (RenderFrameMode frameMode : frameModes)
+	{
+		// Only textured frames sample the texture, the other modes would draw the same frames for every filter
+		unsigned int filterCount = frameMode == RenderFrameMode::Textured ? 3 : 1;
+		for (unsigned int filter = 0; filter < filterCount; filter++)
+		{
+			TextureFilter samplerFilter = samplerFilters[filter];
+			if (!context.Pixels)
 			{
-				SV_TextureFilter = TextureFilter::TRILINEAR;
+				bCompleted = false;
+				break;
 			}
 
-			if (GetAsyncKeyState(0x57) & 0x01) // w
-			{
-				worldCamera.Translate(0.0f, 0.0f, worldCameraTranslateSpeed * FRAME_RATE);
-			}
-			else if (GetAsyncKeyState(0x53) & 0x01) // s
-			{
-				worldCamera.Translate(0.0f, 0.0f, -worldCameraTranslateSpeed * FRAME_RATE);
-			}
-			else if (GetAsyncKeyState(0x41) & 0x01) // a
-			{
-				worldCamera.Translate(-worldCameraTranslateSpeed * FRAME_RATE, 0.0f, 0.0f);
-			}
-			else if (GetAsyncKeyState(0x44) & 0x01) // d
-			{
-				worldCamera.Translate(worldCameraTranslateSpeed * FRAME_RATE, 0.0f, 0.0f);
-			}
+			SceneState scene;
+			scene.bPipelinePinned = true;
+			scene.FrameMode = frameMode;
+			scene.SamplerFilter = samplerFilter;
 
-			if (GetAsyncKeyState(0x26) & 0x01) // arrow up  
-			{
-				worldCamera.Rotate(0.0f, worldCameraTranslateSpeed * FRAME_RATE, 0.0f);
-			}
-			if (GetAsyncKeyState(0x28) & 0x01) // arrow down
+			context.bShowTriangleVertexNormals = false;
+			context.bTiledRasterization = true;
+			context.bHierarchicalDepthTest = true;
+			context.TriangleFillPath = fillPath;
+
+			SceneBenchmarkRun& run = benchmark.AddRun(frameMode, samplerFilter);
+
+			// Every frame is exactly one step of the path
+			FrameScheduler scheduler(FRAME_RATE, static_cast<unsigned int>(mInputPath.GetStepCount()));
+			long long lastFrameEnd = FrameProfiler::Now();
+			RunFrames(scene, scheduler, [&](const unsigned int* pixels)
 			{
-				worldCamera.Rotate(0.0f, -worldCameraTranslateSpeed * FRAME_RATE, 0.0f);
-			}
+				long long now = FrameProfiler::Now();
+				run.FrameTimes.push_back(now - lastFrameEnd);
+				run.FrameHashes.push_back(SceneBenchmark::HashPixels(pixels, TOTAL_PIXELS));
+				lastFrameEnd = now;
+			});
+
+			bCompleted = bCompleted && run.FrameHashes.size() == mInputPath.GetStepCount();
+		}
+	}
+
+	benchmark.PrintReport(std::cout);
+
+	if (mOptions.TimingsPath && !benchmark.WriteTimings(mOptions.TimingsPath))
+	{
+		std::cerr << "Could not write timings " << mOptions.TimingsPath << std::endl;
+	}
+
+	if (!bCompleted)
+	{
+		std::cerr << "Scene benchmark was cut short, the surface closed before every run finished" << std::endl;
+		mExitCode = 1;
+	}
+	else if (mOptions.GoldenPath && mOptions.bRecordGolden)
+	{
+		if (!benchmark.WriteGolden(mOptions.GoldenPath))
+		{
+			std::cerr << "Could not write golden hashes " << mOptions.GoldenPath << std::endl;
+			mExitCode = 1;
+		}
+	}
+	else if (mOptions.GoldenPath && !benchmark.CompareGolden(mOptions.GoldenPath, std::cout))
+	{
+		mExitCode = 1;
+	}
+}
+
+template<class FrameCallback>
+void Application::RunFrames(SceneState& scene, FrameScheduler& scheduler, FrameCallback onFrame)
+{
+	RenderContext& context = mRenderContext;
+
+	// Benchmarks have to draw every frame
+	bool bReuseStaticFrames = !scheduler.IsBenchmark();
+	unsigned int* lastPresentedPixels = nullptr;
+	unsigned long long lastPresentedState = 0;
+
+	while (context.Pixels)
+	{
+		unsigned int steps = scheduler.BeginFrame();
+		if (!steps)
+		{
+			break;
+		}
+
+		// Simulation, always advances in FRAME_RATE steps however long frames take to draw
+		for (unsigned int step = 0; step < steps; step++)
+		{
+			PROFILE_SCOPE("Simulate");
+			Simulate(scene);
+		}
 
-			if (GetAsyncKeyState(0x25) & 0x01) // arrow left
+		scene.WorldCamera.SetViewMatrix();
+
+		context.ViewMatrix = scene.WorldCamera.GetViewMatrix();
+		context.CameraForwardVector = scene.WorldCamera.GetForwardVector();
+
+		context.PointLightRadius = scene.PointLightRadius;
+
+		// A still scene is not drawn again, the back buffer may already hold this very frame, otherwise the last one presented is
+		unsigned long long frameState = Rasterization::HashFrameState(context);
+		unsigned long long& backBufferState = context.ColorBufferStates[Rasterization::GetColorBufferIndex(context, context.Pixels)];
+		if (!bReuseStaticFrames || backBufferState != frameState)
+		{
+			if (bReuseStaticFrames && lastPresentedPixels && lastPresentedState == frameState)
 			{
-				worldCamera.Rotate(-worldCameraTranslateSpeed * FRAME_RATE, 0.0f, 0.0f);
+				PROFILE_SCOPE("Copy Cached Frame");
+				memcpy(context.Pixels, lastPresentedPixels, TOTAL_PIXELS * sizeof(unsigned int));
 			}
-			if (GetAsyncKeyState(0x27) & 0x01) // arrow right
+			else
 			{
-				worldCamera.Rotate(worldCameraTranslateSpeed * FRAME_RATE, 0.0f, 0.0f);
+				PROFILE_SCOPE("Draw");
+
+				Rasterization::ClearBuffers(context, 0xff163d49);
+				Rasterization::ResetPipelineStats(context);
+
+				context.PixelShader = PS_WhiteColor;
+				{
+					PROFILE_SCOPE("Draw Stars");
+					for (int i = 0; i < STARS_COUNT; i++)
+					{
+						Rasterization::DrawPoint(context, starsVertices[i]);
+					}
+				}
+
+				if (context.FrameMode == RenderFrameMode::Textured || context.FrameMode == RenderFrameMode::Shaded)
+				{
+					context.PixelShader = PS_Texture;
+					Rasterization::DrawTriangleWithIndexBuffer(context, mStoneHedgeVertexBuffer, StoneHenge_indicies, 2532);
+				}
+				else
+				{
+					context.PixelShader = PS_GreenColor;
+					Rasterization::DrawTriangleOutlinesWithIndexBuffer(context, stoneHedgeVertices, StoneHenge_indicies, 2532);
+				}
+
+				Rasterization::RecordPipelineStats(context);
 			}
 
+			backBufferState = frameState;
+		}
 
-			if (GetAsyncKeyState(0x09) & 0x01) // Tab
-			{
-				renderFrameMode = (RenderFrameMode)((((int)renderFrameMode) + 1) % 3);
-			}
+		// The presented buffer is not handed out again before the next present, it can still be read for recording
+		unsigned int* presentedPixels = context.Pixels;
+		{
+			PROFILE_SCOPE("Present");
+			context.Pixels = RS_Present(presentedPixels) ? RS_AcquireBackBuffer() : nullptr;
+		}
+		lastPresentedPixels = presentedPixels;
+		lastPresentedState = frameState;
 
-			if (GetAsyncKeyState(0x4E) & 0x01) // N
+		if (context.Pixels)
+		{
+			onFrame(static_cast<const unsigned int*>(presentedPixels));
+
+			// Recording stops if the video output goes away, rendering carries on
+			if (mVideoWriter.IsOpen() && !mVideoWriter.WriteFrame(presentedPixels))
 			{
-				bShowTriangleVertexNormals = !bShowTriangleVertexNormals;
+				std::cerr << "Video output closed, recording stopped" << std::endl;
+				mVideoWriter.Close();
 			}
-
-			timePassed = 0.0f;
 		}
 
-		mTimer.Signal();
+		FrameProfiler::EndFrame();
+	}
+}
+
+void Application::Simulate(SceneState& scene)
+{
+	RenderContext& context = mRenderContext;
+	const float worldCameraTranslateSpeed = 60.0f;
+
+	scene.TotalTimePassed += FRAME_RATE;
+
+	/* Point Lighting */
+	scene.PointLightRadius += FRAME_RATE * sin(scene.TotalTimePassed) * 10.0f;
+	scene.PointLightRadius = Math::Clamp(0.0f, 10.0f, scene.PointLightRadius);
+
+	// Input
+	if (WasKeyPressed(scene, 0x31)) // 1
+	{
+		context.SamplerFilter = TextureFilter::NEAREST;
+	}
+	else if (WasKeyPressed(scene, 0x32)) // 2
+	{
+		context.SamplerFilter = TextureFilter::BILINEAR;
+	}
+	else if (WasKeyPressed(scene, 0x33)) // 3
+	{
+		context.SamplerFilter = TextureFilter::TRILINEAR;
+	}
+
+	if (WasKeyPressed(scene, 0x57)) // w
+	{
+		scene.WorldCamera.Translate(0.0f, 0.0f, worldCameraTranslateSpeed * FRAME_RATE);
+	}
+	else if (WasKeyPressed(scene, 0x53)) // s
+	{
+		scene.WorldCamera.Translate(0.0f, 0.0f, -worldCameraTranslateSpeed * FRAME_RATE);
+	}
+	else if (WasKeyPressed(scene, 0x41)) // a
+	{
+		scene.WorldCamera.Translate(-worldCameraTranslateSpeed * FRAME_RATE, 0.0f, 0.0f);
+	}
+	else if (WasKeyPressed(scene, 0x44)) // d
+	{
+		scene.WorldCamera.Translate(worldCameraTranslateSpeed * FRAME_RATE, 0.0f, 0.0f);
+	}
+
+	if (WasKeyPressed(scene, 0x26)) // arrow up  
+	{
+		scene.WorldCamera.Rotate(0.0f, worldCameraTranslateSpeed * FRAME_RATE, 0.0f);
+	}
+	if (WasKeyPressed(scene, 0x28)) // arrow down
+	{
+		scene.WorldCamera.Rotate(0.0f, -worldCameraTranslateSpeed * FRAME_RATE, 0.0f);
+	}
+
+	if (WasKeyPressed(scene, 0x25)) // arrow left
+	{
+		scene.WorldCamera.Rotate(-worldCameraTranslateSpeed * FRAME_RATE, 0.0f, 0.0f);
+	}
+	if (WasKeyPressed(scene, 0x27)) // arrow right
+	{
+		scene.WorldCamera.Rotate(worldCameraTranslateSpeed * FRAME_RATE, 0.0f, 0.0f);
+	}
+
+
+	if (WasKeyPressed(scene, 0x09)) // Tab
+	{
+		context.FrameMode = (RenderFrameMode)((((int)context.FrameMode) + 1) % 3);
+	}
+
+	if (WasKeyPressed(scene, 0x4E)) // N
+	{
+		context.bShowTriangleVertexNormals = !context.bShowTriangleVertexNormals;
+	}
+
+	if (WasKeyPressed(scene, 0x54)) // T
+	{
+		context.bTiledRasterization = !context.bTiledRasterization;
+	}
+
+	if (WasKeyPressed(scene, 0x56)) // V
+	{
+		context.TriangleFillPath = (FillPath)((((int)context.TriangleFillPath) + 1) % 3);
+	}
+
+	if (WasKeyPressed(scene, 0x48)) // H
+	{
+		context.bHierarchicalDepthTest = !context.bHierarchicalDepthTest;
+	}
+
+	if (WasKeyPressed(scene, 0x46)) // F
+	{
+		std::cout << "Fragments tested: " << context.Stats.FragmentsTested
+			<< ", failed the depth test: " << context.Stats.DepthTestFailed
+			<< ", shaded: " << context.Stats.FragmentsShaded
+			<< ", depth tiles killed by hierarchical Z: " << context.Stats.HierarchicalDepthKilledTiles << std::endl;
+		std::cout << "Vertex shader invocations: " << context.Stats.VerticesShaded
+			<< ", saved by the vertex cache: " << context.Stats.VertexCacheHits << std::endl;
+		std::cout << "Triangles back face culled: " << context.Stats.TrianglesBackFaceCulled
+			<< ", clipped: " << context.Stats.TrianglesClipped << std::endl;
+	}
+
+	if (WasKeyPressed(scene, 0x50)) // P
+	{
+		FrameProfiler::PrintReport(std::cout);
+	}
+
+	if (scene.bPipelinePinned)
+	{
+		context.FrameMode = scene.FrameMode;
+		context.SamplerFilter = scene.SamplerFilter;
+	}
+
+	scene.Step++;
+}
+
+bool Application::WasKeyPressed(const SceneState& scene, int virtualKey)
+{
+	// A replay only ever sees the path, live keys would make it diverge
+	if (mOptions.SceneBenchmarkPath || mOptions.ReplayInputPath)
+	{
+		return mInputPath.WasKeyPressed(scene.Step, virtualKey);
 	}
 
-	for (unsigned int i = 0; i < Textures.size(); i++)
+	bool bPressed = (GetAsyncKeyState(virtualKey) & 0x01) != 0;
+	if (bPressed && mOptions.RecordInputPath)
 	{
-		delete[] Textures[i]->Pixels;
-		delete[] Textures[i];
+		mInputPath.AddKeyPress(scene.Step, virtualKey);
 	}
+	return bPressed;
 }
 
 Application::~Application()
 {
+	mVideoWriter.Close();
 	RS_Shutdown();
 
-	delete[] pixels;
-	delete[] depthBuffer;
 	delete[] starsVertices;
 	delete[] stoneHedgeVertices;
 }
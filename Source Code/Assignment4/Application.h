@@ -1,21 +1,107 @@
 #pragma once
 
 #include "RasterSurface.h"
-#include "XTime.h"
+#include "FrameScheduler.h"
+#include "RenderContext.h"
+#include "Graphics/VertexBuffer.h"
+#include "Y4MWriter.h"
+#include "InputPath.h"
+#include "Camera.h"
+
+/* Settings taken from the command line, see Main.cpp */
+struct ApplicationOptions
+{
+	/* Where every presented frame is streamed to as Y4M video (see Y4MWriter::Open), nullptr to not record */
+	const char* VideoOutputPath = nullptr;
+
+	/* Frames to render as fast as possible before printing the throughput and quitting, 0 paces frames to FRAME_RATE */
+	unsigned int BenchmarkFrames = 0;
+
+	/* Where the profiler's frames, scopes and counters are written as a Chrome trace on exit, nullptr for none */
+	const char* TracePath = nullptr;
+
+	/* InputPath replayed instead of reading the keyboard, nullptr for live input */
+	const char* ReplayInputPath = nullptr;
+
+	/* Where the keys pressed during the run are saved as an InputPath on exit, nullptr to not record */
+	const char* RecordInputPath = nullptr;
+
+	/* InputPath the scene benchmark replays once for every frame mode and texture filter, nullptr for a normal run */
+	const char* SceneBenchmarkPath = nullptr;
+
+	/* Golden hashes the scene benchmark's output is compared with, or written to when bRecordGolden */
+	const char* GoldenPath = nullptr;
+	bool bRecordGolden = false;
+
+	/* Where the scene benchmark writes every frame's time and hash as CSV, nullptr for none */
+	const char* TimingsPath = nullptr;
+};
+
+/* Everything the simulation advances, a replay starts from a fresh one */
+struct SceneState
+{
+	Camera WorldCamera;
+
+	float TotalTimePassed;
+	float PointLightRadius;
+
+	/* Simulation steps taken, input paths are indexed by it */
+	unsigned long long Step;
+
+	/* Frame mode and texture filter the scene benchmark holds while it replays a path, whatever keys the path presses */
+	bool bPipelinePinned;
+	RenderFrameMode FrameMode;
+	TextureFilter SamplerFilter;
+
+public:
+	SceneState();
+};
 
 class Application
 {
 private:
-	XTime mTimer;
+	ApplicationOptions mOptions;
+
+	RenderContext mRenderContext;
+
+	/* Stone henge mesh in the layout the batched vertex stage reads */
+	VertexBuffer mStoneHedgeVertexBuffer;
+
+	/* Stone henge texture and its mip levels, what the context's sampler points into */
+	MipChain mStoneHedgeTexture;
+
+	Y4MWriter mVideoWriter;
+
+	/* Key presses being replayed or recorded, see ApplicationOptions */
+	InputPath mInputPath;
+
+	int mExitCode;
 
 public:
-	Application() = default;
+	Application()
+		: mExitCode(0) { }
 	~Application();
 
 public:
-	void Init();
+	void Init(const ApplicationOptions& options);
+
+	/* 0 unless the scene benchmark failed or its output did not match the golden hashes */
+	int GetExitCode() const { return mExitCode; }
 
 private:
 	void Update();
+
+	/* Replays the scene benchmark's path once for every frame mode and texture filter, then reports and checks the output */
+	void RunSceneBenchmark();
+
+	/* Draws and presents frames until the scheduler is done or the surface closes, calling onFrame(pixels) with every presented frame */
+	template<class FrameCallback>
+	void RunFrames(SceneState& scene, FrameScheduler& scheduler, FrameCallback onFrame);
+
+	/* Advances the scene by one FRAME_RATE step */
+	void Simulate(SceneState& scene);
+
+	/* Whether the key was pressed this step, from the replayed path or the keyboard */
+	bool WasKeyPressed(const SceneState& scene, int virtualKey);
 };
 
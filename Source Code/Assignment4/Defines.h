@@ -5,8 +5,46 @@
 
 #define STARS_COUNT 3000
 
+/* Star field seed of replayed input paths and the scene benchmark, live runs seed with the time */
+#define STARS_REPLAY_SEED 0x5EED
+
 const unsigned int TOTAL_PIXELS = (RASTER_WIDTH * RASTER_HEIGHT);
 
+/* Screen tiles used by the binned (sort-middle) rasterizer */
+#define TILE_SIZE 64
+
+const unsigned int TILE_COUNT_X = (RASTER_WIDTH + TILE_SIZE - 1) / TILE_SIZE;
+const unsigned int TILE_COUNT_Y = (RASTER_HEIGHT + TILE_SIZE - 1) / TILE_SIZE;
+const unsigned int TILE_COUNT = (TILE_COUNT_X * TILE_COUNT_Y);
+
+/* Depth tiles of the hierarchical Z buffer, TILE_SIZE must be a multiple of this so each depth tile lives in one screen tile */
+#define HIZ_TILE_SIZE 8
+
+const unsigned int HIZ_TILE_COUNT_X = (RASTER_WIDTH + HIZ_TILE_SIZE - 1) / HIZ_TILE_SIZE;
+const unsigned int HIZ_TILE_COUNT_Y = (RASTER_HEIGHT + HIZ_TILE_SIZE - 1) / HIZ_TILE_SIZE;
+const unsigned int HIZ_TILE_COUNT = (HIZ_TILE_COUNT_X * HIZ_TILE_COUNT_Y);
+
+/* Triangles are only clipped against x / y once they reach this many screen sizes out,
+*  small enough that guard band vertices still fit the SIMD block fill (BLOCK_FILL_COORDINATE_LIMIT) */
+const float GUARD_BAND_SCALE = 16.0f;
+
+/* Textures are stored in 4x4 texel tiles (TextureLayout::Tiled) instead of row after row, 0 stores them linear.
+*  Only the memory order changes, the pixels drawn are the same */
+#ifndef TEXTURES_TILED
+#define TEXTURES_TILED 1
+#endif
+
+/* Textures are block compressed when they are loaded, BC1 if opaque and BC3 otherwise (BlockCompression.h), and decoded as
+*  they are sampled: a quarter (BC3) to an eighth (BC1) of the memory, at a small loss of color precision and the cost of decoding.
+*  Only worth it once the textures no longer fit in the caches, a scene with one texture that does is faster off.
+*  Compressed textures are always tiled */
+#ifndef TEXTURES_COMPRESSED
+#define TEXTURES_COMPRESSED 0
+#endif
+
+/* Color buffers the renderer rotates through when presenting with a swap chain, at most RS_MAX_SWAP_CHAIN_LENGTH */
+#define SWAP_CHAIN_LENGTH 3
+
 #define GRID_COUNT 11
 
 const unsigned int GRID_SIZE = GRID_COUNT * 2;
@@ -30,4 +68,9 @@ const unsigned int CYAN = (GREEN_CHANNEL | BLUE_CHANNEL);
 const unsigned int MAGENTA = (RED_CHANNEL | BLUE_CHANNEL);
 
 #define SHOW_TRIANGLE_OUTLINES 0
+
+/* Profiler scopes, per frame counters and trace export (FrameProfiler.h), 0 compiles all of it out */
+#ifndef PROFILING_ENABLED
+#define PROFILING_ENABLED 1
+#endif
 //#define SHOW_TRIANGLE_VERTEX_NORMALS 0
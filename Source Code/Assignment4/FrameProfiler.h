@@ -0,0 +1,491 @@
+#pragma once
+#include "Defines.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <climits>
+#if defined(__linux__)
+#include <ctime>
+#endif
+
+// std::min / std::max are written (std::min)(a, b) in here, Windows.h may have defined min and max macros
+
+/* Monotonic nanoseconds, kept when profiling is compiled out since the frame scheduler paces with it */
+struct ProfileClock
+{
+public:
+	static long long Now()
+	{
+#if defined(__linux__)
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return static_cast<long long>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+};
+
+#if PROFILING_ENABLED
+/* One timed interval, every field is atomic so a report can read a ring while its thread keeps writing */
+struct ProfileSample
+{
+	std::atomic<const char*> Name;
+	std::atomic<long long> Start;
+	std::atomic<long long> Duration;
+	std::atomic<unsigned long long> Frame;
+
+public:
+	ProfileSample()
+		: Name(nullptr), Start(0), Duration(0), Frame(0) { }
+};
+
+/* Fixed capacity ring of samples written by a single thread, lock free for the writer and for any number of readers.
+*  Once full the oldest samples are overwritten, readers drop whatever was overwritten while they read
+*/
+template<unsigned int Capacity>
+class ProfileSampleRing
+{
+private:
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+	ProfileSample mSamples[Capacity];
+
+	/* Samples pushed so far, only written by the owning thread */
+	alignas(64) std::atomic<unsigned long long> mWritten;
+
+public:
+	ProfileSampleRing()
+		: mWritten(0) { }
+
+	ProfileSampleRing(const ProfileSampleRing&) = delete;
+	ProfileSampleRing& operator=(const ProfileSampleRing&) = delete;
+
+public:
+	/* Owning thread only */
+	void Push(const char* name, long long start, long long duration, unsigned long long frame)
+	{
+		unsigned long long index = mWritten.load(std::memory_order_relaxed);
+		ProfileSample& sample = mSamples[index & (Capacity - 1)];
+		sample.Name.store(name, std::memory_order_relaxed);
+		sample.Start.store(start, std::memory_order_relaxed);
+		sample.Duration.store(duration, std::memory_order_relaxed);
+		sample.Frame.store(frame, std::memory_order_relaxed);
+		mWritten.store(index + 1, std::memory_order_release);
+	}
+
+	/* Any thread, calls visit(name, start, duration, frame) for every sample still in the ring, oldest first */
+	template<class Visitor>
+	void ForEach(Visitor visit) const
+	{
+		struct Copy { const char* Name; long long Start; long long Duration; unsigned long long Frame; };
+
+		unsigned long long end = mWritten.load(std::memory_order_acquire);
+		unsigned long long begin = end > Capacity ? end - Capacity : 0;
+
+		std::vector<Copy> copies;
+		copies.reserve(static_cast<size_t>(end - begin));
+		for (unsigned long long i = begin; i < end; i++)
+		{
+			const ProfileSample& sample = mSamples[i & (Capacity - 1)];
+			Copy copy = { sample.Name.load(std::memory_order_relaxed), sample.Start.load(std::memory_order_relaxed),
+				sample.Duration.load(std::memory_order_relaxed), sample.Frame.load(std::memory_order_relaxed) };
+			copies.push_back(copy);
+		}
+
+		// The slot of sample 'written' may be half written already, everything older than a ring before it is gone
+		std::atomic_thread_fence(std::memory_order_acquire);
+		unsigned long long written = mWritten.load(std::memory_order_relaxed);
+		unsigned long long firstIntact = written + 1 > Capacity ? written + 1 - Capacity : 0;
+
+		for (unsigned long long i = (std::max)(begin, firstIntact); i < end; i++)
+		{
+			const Copy& copy = copies[static_cast<size_t>(i - begin)];
+			visit(copy.Name, copy.Start, copy.Duration, copy.Frame);
+		}
+	}
+
+	/* Any thread, true once samples have been overwritten. The oldest frame left may then be missing some of its samples */
+	bool HasOverwritten() const
+	{
+		return mWritten.load(std::memory_order_acquire) > Capacity;
+	}
+};
+
+/* Frame time and scoped timer profiler, portable replacement for XTime.
+*
+*  EndFrame is called once per frame by the render loop and records the time since the last call.
+*  PROFILE_SCOPE("Name") times the rest of the enclosing block on whatever thread runs it, into that thread's own ring,
+*  tagged with the frame it ended in. Nothing is locked on either path, a thread only takes a mutex once to register its ring.
+*
+*  PROFILE_COUNTER("Name", value) records a per frame count from the render loop's thread.
+*
+*  PrintReport covers the frames every ring still holds in full: p50 / p95 / p99 / max frame times, a frame time histogram
+*  and the same percentiles of every scope's total time per frame and of every counter.
+*  WriteChromeTrace exports the same window as Chrome trace event JSON (chrome://tracing, ui.perfetto.dev).
+*
+*  With PROFILING_ENABLED 0 (Defines.h) every call is empty and the macros expand to nothing.
+*/
+class FrameProfiler
+{
+public:
+	static const unsigned int FRAME_CAPACITY = 1024;
+
+	/* Scopes a thread may record per frame and still keep as many frames as the frame ring */
+	static const unsigned int THREAD_SCOPES_PER_FRAME = 16;
+	static const unsigned int THREAD_SAMPLE_CAPACITY = FRAME_CAPACITY * THREAD_SCOPES_PER_FRAME;
+	static const unsigned int COUNTER_CAPACITY = 16384;
+
+	typedef ProfileSampleRing<THREAD_SAMPLE_CAPACITY> ThreadRing;
+
+private:
+	struct State
+	{
+		ProfileSampleRing<FRAME_CAPACITY> Frames;
+
+		/* Counter samples keep their value in Duration, only the render loop's thread writes them */
+		ProfileSampleRing<COUNTER_CAPACITY> Counters;
+		std::atomic<unsigned long long> FrameIndex;
+		long long LastFrameEnd;
+
+		/* Every thread's ring, kept alive after the thread exits so its samples still get reported */
+		std::mutex ThreadRingsMutex;
+		std::vector<std::shared_ptr<ThreadRing>> ThreadRings;
+
+		State()
+			: FrameIndex(0), LastFrameEnd(0) { }
+	};
+
+public:
+	/* Monotonic nanoseconds */
+	static long long Now() { return ProfileClock::Now(); }
+
+	/* Frame the render loop is on, scopes are attributed to it */
+	static unsigned long long GetFrameIndex()
+	{
+		return GetState().FrameIndex.load(std::memory_order_relaxed);
+	}
+
+	/* Render loop only, marks the end of a frame. The first call only starts the clock */
+	static void EndFrame()
+	{
+		State& state = GetState();
+		long long now = Now();
+		if (state.LastFrameEnd)
+		{
+			state.Frames.Push("Frame", state.LastFrameEnd, now - state.LastFrameEnd, state.FrameIndex.load(std::memory_order_relaxed));
+		}
+		state.LastFrameEnd = now;
+		state.FrameIndex.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/* Records a finished scope on the calling thread */
+	static void RecordScope(const char* name, long long start, long long end)
+	{
+		GetThreadRing().Push(name, start, end - start, GetFrameIndex());
+	}
+
+	/* Render loop's thread only, value is what name amounted to in the current frame */
+	static void RecordCounter(const char* name, long long value)
+	{
+		GetState().Counters.Push(name, Now(), value, GetFrameIndex());
+	}
+
+	static void PrintReport(std::ostream& stream)
+	{
+		State& state = GetState();
+
+		// Total time of every scope and total of every counter in every frame the rings hold, and the frame times
+		std::map<unsigned long long, long long> frameTimes;
+		std::map<std::string, std::map<unsigned long long, long long>> scopeFrameTimes;
+		std::map<std::string, std::map<unsigned long long, long long>> counterFrameValues;
+
+		// A ring that overwrote samples may hold only part of its oldest frame, so the window starts after it
+		unsigned long long firstFrame = 0;
+		unsigned long long lastFrame = 0;
+		auto limitWindow = [&](bool bOverwritten, unsigned long long oldestFrame)
+		{
+			if (bOverwritten && oldestFrame != ~0ull) { firstFrame = (std::max)(firstFrame, oldestFrame + 1); }
+		};
+
+		unsigned long long oldestFrame = ~0ull;
+		state.Frames.ForEach([&](const char*, long long, long long duration, unsigned long long frame)
+		{
+			frameTimes[frame] = duration;
+			oldestFrame = (std::min)(oldestFrame, frame);
+			lastFrame = (std::max)(lastFrame, frame);
+		});
+		firstFrame = oldestFrame;
+
+		if (frameTimes.empty())
+		{
+			stream << "Profiler: no frames recorded yet" << std::endl;
+			return;
+		}
+
+		for (const std::shared_ptr<ThreadRing>& ring : GetThreadRings())
+		{
+			oldestFrame = ~0ull;
+			ring->ForEach([&](const char* name, long long, long long duration, unsigned long long frame)
+			{
+				if (name) { scopeFrameTimes[name][frame] += duration; }
+				oldestFrame = (std::min)(oldestFrame, frame);
+			});
+			limitWindow(ring->HasOverwritten(), oldestFrame);
+		}
+
+		oldestFrame = ~0ull;
+		state.Counters.ForEach([&](const char* name, long long, long long value, unsigned long long frame)
+		{
+			if (name) { counterFrameValues[name][frame] += value; }
+			oldestFrame = (std::min)(oldestFrame, frame);
+		});
+		limitWindow(state.Counters.HasOverwritten(), oldestFrame);
+
+		std::vector<long long> windowFrameTimes = GetValues(frameTimes, firstFrame, lastFrame);
+		if (windowFrameTimes.empty())
+		{
+			stream << "Profiler: no frame is held in full by every ring" << std::endl;
+			return;
+		}
+
+		std::ios::fmtflags flags = stream.flags();
+		std::streamsize precision = stream.precision();
+		stream << std::fixed << std::setprecision(3);
+
+		stream << "Frame times over the last " << windowFrameTimes.size() << " frames, in ms. Rows count the frames their scope or counter ran in" << std::endl;
+		stream << std::left << std::setw(28) << "" << std::right << std::setw(8) << "frames"
+			<< std::setw(12) << "mean" << std::setw(12) << "p50" << std::setw(12) << "p95" << std::setw(12) << "p99" << std::setw(12) << "max" << std::endl;
+		PrintPercentiles(stream, "Frame", windowFrameTimes, 1e-6);
+		for (const auto& scope : scopeFrameTimes)
+		{
+			PrintPercentiles(stream, scope.first.c_str(), GetValues(scope.second, firstFrame, lastFrame), 1e-6);
+		}
+
+		if (!counterFrameValues.empty())
+		{
+			stream << "Counters per frame" << std::endl << std::setprecision(0);
+			for (const auto& counter : counterFrameValues)
+			{
+				PrintPercentiles(stream, counter.first.c_str(), GetValues(counter.second, firstFrame, lastFrame), 1.0);
+			}
+		}
+
+		PrintHistogram(stream, windowFrameTimes);
+
+		stream.flags(flags);
+		stream.precision(precision);
+	}
+
+	/* Writes the frames, scopes and counters still in the rings as Chrome trace event JSON.
+	*  Frames go on their own track, every thread that recorded scopes gets a track of its own
+	*/
+	static bool WriteChromeTrace(const char* path)
+	{
+		std::ofstream file(path);
+		if (!file) { return false; }
+
+		State& state = GetState();
+		std::vector<std::shared_ptr<ThreadRing>> threadRings = GetThreadRings();
+
+		// Timestamps are relative to the oldest sample
+		long long origin = LLONG_MAX;
+		auto findOrigin = [&](const char*, long long start, long long, unsigned long long) { origin = (std::min)(origin, start); };
+		state.Frames.ForEach(findOrigin);
+		state.Counters.ForEach(findOrigin);
+		for (const std::shared_ptr<ThreadRing>& ring : threadRings)
+		{
+			ring->ForEach(findOrigin);
+		}
+
+		file << std::fixed << std::setprecision(3);
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Frames\"}}";
+		for (size_t i = 0; i < threadRings.size(); i++)
+		{
+			file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i + 1 << ",\"args\":{\"name\":\"Thread " << i + 1 << "\"}}";
+		}
+
+		auto writeComplete = [&](size_t track)
+		{
+			return [&, track](const char* name, long long start, long long duration, unsigned long long frame)
+			{
+				file << ",\n{\"name\":";
+				WriteJsonString(file, name);
+				file << ",\"ph\":\"X\",\"ts\":" << (start - origin) / 1e3 << ",\"dur\":" << duration / 1e3
+					<< ",\"pid\":1,\"tid\":" << track << ",\"args\":{\"frame\":" << frame << "}}";
+			};
+		};
+		state.Frames.ForEach(writeComplete(0));
+		for (size_t i = 0; i < threadRings.size(); i++)
+		{
+			threadRings[i]->ForEach(writeComplete(i + 1));
+		}
+
+		state.Counters.ForEach([&](const char* name, long long time, long long value, unsigned long long)
+		{
+			file << ",\n{\"name\":";
+			WriteJsonString(file, name);
+			file << ",\"ph\":\"C\",\"ts\":" << (time - origin) / 1e3 << ",\"pid\":1,\"args\":{\"value\":" << value << "}}";
+		});
+
+		file << "\n]}\n";
+		return static_cast<bool>(file);
+	}
+
+private:
+	static State& GetState()
+	{
+		static State state;
+		return state;
+	}
+
+	static ThreadRing& GetThreadRing()
+	{
+		thread_local std::shared_ptr<ThreadRing> ring;
+		if (!ring)
+		{
+			ring = std::make_shared<ThreadRing>();
+
+			State& state = GetState();
+			std::lock_guard<std::mutex> lock(state.ThreadRingsMutex);
+			state.ThreadRings.push_back(ring);
+		}
+		return *ring;
+	}
+
+	static std::vector<std::shared_ptr<ThreadRing>> GetThreadRings()
+	{
+		State& state = GetState();
+		std::lock_guard<std::mutex> lock(state.ThreadRingsMutex);
+		return state.ThreadRings;
+	}
+
+	/* Values of the frames from firstFrame to lastFrame */
+	static std::vector<long long> GetValues(const std::map<unsigned long long, long long>& frameValues, unsigned long long firstFrame, unsigned long long lastFrame)
+	{
+		std::vector<long long> values;
+		for (auto frame = frameValues.lower_bound(firstFrame); frame != frameValues.end() && frame->first <= lastFrame; ++frame)
+		{
+			values.push_back(frame->second);
+		}
+		return values;
+	}
+
+	/* Nearest rank percentile of sorted values */
+	static long long Percentile(const std::vector<long long>& sorted, double percentile)
+	{
+		size_t rank = static_cast<size_t>(percentile * sorted.size() + 0.999999);
+		return sorted[(std::min)((std::max)(rank, static_cast<size_t>(1)), sorted.size()) - 1];
+	}
+
+	/* One row of the report, values are multiplied by scale (1e-6 turns nanoseconds into ms). Nothing for no values */
+	static void PrintPercentiles(std::ostream& stream, const char* name, std::vector<long long> values, double scale)
+	{
+		if (values.empty()) { return; }
+
+		std::sort(values.begin(), values.end());
+
+		double total = 0.0;
+		for (long long value : values)
+		{
+			total += static_cast<double>(value);
+		}
+
+		stream << std::left << std::setw(28) << name << std::right << std::setw(8) << values.size()
+			<< std::setw(12) << total * scale / values.size()
+			<< std::setw(12) << Percentile(values, 0.50) * scale << std::setw(12) << Percentile(values, 0.95) * scale
+			<< std::setw(12) << Percentile(values, 0.99) * scale << std::setw(12) << values.back() * scale << std::endl;
+	}
+
+	static void WriteJsonString(std::ostream& stream, const char* text)
+	{
+		stream << '"';
+		for (; *text; text++)
+		{
+			if (*text == '"' || *text == '\\') { stream << '\\'; }
+			stream << *text;
+		}
+		stream << '"';
+	}
+
+	/* 1 ms buckets, everything from 32 ms on shares the last one */
+	static void PrintHistogram(std::ostream& stream, const std::vector<long long>& frameTimes)
+	{
+		const unsigned int BUCKET_COUNT = 33;
+		const unsigned int BAR_WIDTH = 50;
+
+		unsigned int buckets[BUCKET_COUNT] = {};
+		unsigned int fullestBucket = 0;
+		for (long long time : frameTimes)
+		{
+			unsigned int bucket = static_cast<unsigned int>((std::min)(time / 1000000, static_cast<long long>(BUCKET_COUNT - 1)));
+			fullestBucket = (std::max)(fullestBucket, ++buckets[bucket]);
+		}
+
+		stream << "Frame time histogram" << std::endl;
+		for (unsigned int i = 0; i < BUCKET_COUNT; i++)
+		{
+			if (!buckets[i]) { continue; }
+
+			std::string label = (i + 1 < BUCKET_COUNT) ? std::to_string(i) + "-" + std::to_string(i + 1) + " ms" : ">= " + std::to_string(i) + " ms";
+			stream << std::right << std::setw(10) << label << std::setw(7) << buckets[i] << " "
+				<< std::string((buckets[i] * BAR_WIDTH + fullestBucket - 1) / fullestBucket, '#') << std::endl;
+		}
+	}
+};
+
+/* Times the enclosing block, see PROFILE_SCOPE */
+class ProfileScope
+{
+private:
+	const char* mName;
+	long long mStart;
+
+public:
+	explicit ProfileScope(const char* name)
+		: mName(name), mStart(FrameProfiler::Now()) { }
+
+	~ProfileScope() { FrameProfiler::RecordScope(mName, mStart, FrameProfiler::Now()); }
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+#define PROFILE_CONCATENATE_INNER(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_INNER(a, b)
+
+/* name must be a string literal (or otherwise outlive the profiler) */
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCATENATE(profileScope, __LINE__)(name)
+#define PROFILE_COUNTER(name, value) FrameProfiler::RecordCounter((name), static_cast<long long>(value))
+
+#else
+/* Profiling compiled out, only the clock is left */
+class FrameProfiler
+{
+public:
+	static long long Now() { return ProfileClock::Now(); }
+
+	static unsigned long long GetFrameIndex() { return 0; }
+
+	static void EndFrame() { }
+
+	static void PrintReport(std::ostream& stream)
+	{
+		stream << "Profiler: compiled out, see PROFILING_ENABLED" << std::endl;
+	}
+
+	static bool WriteChromeTrace(const char*) { return false; }
+};
+
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_COUNTER(name, value) ((void)0)
+#endif // PROFILING_ENABLED
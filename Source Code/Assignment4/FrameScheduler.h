@@ -0,0 +1,156 @@
+#pragma once
+#include "FrameProfiler.h"
+#include <chrono>
+#include <thread>
+#include <iostream>
+#if defined(_WIN32)
+#include "Windows.h"
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#elif defined(__linux__)
+#include <cerrno>
+#endif
+
+/* Drives the render loop: the simulation always advances in fixed steps, independent of how often frames get drawn.
+*
+*  Paced: BeginFrame sleeps until the next frame is due (an absolute deadline one step after the last, so sleep overshoot
+*  does not drift) and returns how many steps are due, usually 1. After a hitch it catches up at most MAX_CATCH_UP_STEPS
+*  steps and drops the rest of the backlog instead of spiraling.
+*
+*  Benchmark: no sleeping, every frame is exactly one step so the run is deterministic, and after the requested number
+*  of frames BeginFrame returns 0 and PrintReport shows the throughput.
+*/
+class FrameScheduler
+{
+private:
+	static const unsigned int MAX_CATCH_UP_STEPS = 5;
+
+	long long mStepNanoseconds;
+	unsigned int mBenchmarkFrames;
+
+	long long mNextFrameTime;
+	long long mStartTime;
+	long long mEndTime;
+
+	unsigned long long mFrameCount;
+	unsigned long long mStepCount;
+
+#if defined(_WIN32)
+	HANDLE mWaitableTimer;
+#endif
+
+public:
+	/* benchmarkFrames 0 paces frames to stepSeconds, anything else runs that many frames as fast as possible */
+	FrameScheduler(double stepSeconds, unsigned int benchmarkFrames)
+		: mStepNanoseconds(static_cast<long long>(stepSeconds * 1e9 + 0.5)), mBenchmarkFrames(benchmarkFrames),
+		mNextFrameTime(0), mStartTime(0), mEndTime(0), mFrameCount(0), mStepCount(0)
+	{
+#if defined(_WIN32)
+		// The default timer resolution (15.6ms) is coarser than a frame, ask for a high resolution one where it exists
+		mWaitableTimer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		if (!mWaitableTimer)
+		{
+			mWaitableTimer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+		}
+#endif
+	}
+
+	~FrameScheduler()
+	{
+#if defined(_WIN32)
+		if (mWaitableTimer) { CloseHandle(mWaitableTimer); }
+#endif
+	}
+
+	FrameScheduler(const FrameScheduler&) = delete;
+	FrameScheduler& operator=(const FrameScheduler&) = delete;
+
+public:
+	bool IsBenchmark() const { return mBenchmarkFrames != 0; }
+
+	/* Steps simulated so far, the simulation time is this times the step */
+	unsigned long long GetStepCount() const { return mStepCount; }
+
+	double GetStepSeconds() const { return mStepNanoseconds / 1e9; }
+
+	/* Waits for the next frame and returns how many simulation steps to run before drawing it, 0 once the benchmark is done */
+	unsigned int BeginFrame()
+	{
+		long long now = FrameProfiler::Now();
+		if (mFrameCount == 0)
+		{
+			mStartTime = now;
+			mNextFrameTime = now;
+		}
+
+		if (IsBenchmark())
+		{
+			if (mFrameCount == mBenchmarkFrames)
+			{
+				if (!mEndTime) { mEndTime = now; }
+				return 0;
+			}
+
+			mFrameCount++;
+			mStepCount++;
+			return 1;
+		}
+
+		if (now < mNextFrameTime)
+		{
+			SleepUntil(mNextFrameTime);
+			now = FrameProfiler::Now();
+		}
+
+		unsigned int steps = 0;
+		while (mNextFrameTime <= now && steps < MAX_CATCH_UP_STEPS)
+		{
+			mNextFrameTime += mStepNanoseconds;
+			steps++;
+		}
+		if (mNextFrameTime <= now)
+		{
+			mNextFrameTime = now + mStepNanoseconds;
+		}
+
+		mFrameCount++;
+		mStepCount += steps;
+		return steps;
+	}
+
+	/* Frames, wall time and frames per second since the first frame */
+	void PrintReport(std::ostream& stream) const
+	{
+		double seconds = ((mEndTime ? mEndTime : FrameProfiler::Now()) - mStartTime) / 1e9;
+		stream << "Rendered " << mFrameCount << " frames in " << seconds << " s: "
+			<< (seconds > 0.0 ? mFrameCount / seconds : 0.0) << " frames per second, "
+			<< (mFrameCount ? seconds * 1000.0 / mFrameCount : 0.0) << " ms per frame" << std::endl;
+	}
+
+private:
+	void SleepUntil(long long deadline)
+	{
+#if defined(__linux__)
+		timespec wakeUp = { static_cast<time_t>(deadline / 1000000000LL), static_cast<long>(deadline % 1000000000LL) };
+		// Signals wake the sleep early, an absolute deadline can simply be slept on again
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeUp, nullptr) == EINTR) { }
+#elif defined(_WIN32)
+		long long remaining = deadline - FrameProfiler::Now();
+		if (remaining <= 0) { return; }
+
+		LARGE_INTEGER dueTime;
+		dueTime.QuadPart = -(remaining / 100); // relative, in 100ns units
+		if (mWaitableTimer && SetWaitableTimer(mWaitableTimer, &dueTime, 0, nullptr, nullptr, FALSE))
+		{
+			WaitForSingleObject(mWaitableTimer, INFINITE);
+		}
+		else
+		{
+			std::this_thread::sleep_for(std::chrono::nanoseconds(remaining));
+		}
+#else
+		std::this_thread::sleep_for(std::chrono::nanoseconds(deadline - FrameProfiler::Now()));
+#endif
+	}
+};
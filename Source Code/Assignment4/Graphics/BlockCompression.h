@@ -0,0 +1,312 @@
+#pragma once
+#include "Defines.h"
+#include <utility>
+
+/* What the texels of a mip level are stored as */
+enum class TextureFormat
+{
+	/* 32 bits per texel */
+	ARGB,
+
+	/* 4x4 texel blocks of 64 bits: two RGB565 endpoints and a 2 bit index per texel, for opaque textures */
+	BC1,
+
+	/* 4x4 texel blocks of 128 bits: an alpha block (two 8 bit endpoints, a 3 bit index per texel) then a BC1 color block */
+	BC3
+};
+
+/* BC1 / BC3 (DXT1 / DXT5) encoding and decoding of 4x4 texel blocks. A block is kept as 64 bit words, least significant
+*  byte first they are the bytes of the standard block layout. Texels are ARGB, 16 of them row after row
+*/
+struct BlockCompression
+{
+public:
+	static const unsigned int BLOCK_BITS = 2;
+	static const unsigned int BLOCK_TEXELS = 16;
+
+	/* BC1 when every texel is opaque, BC3 otherwise */
+	static TextureFormat ChooseFormat(const unsigned int* pixels, unsigned int count)
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			if ((pixels[i] & ALPHA_CHANNEL) != ALPHA_CHANNEL) { return TextureFormat::BC3; }
+		}
+		return TextureFormat::BC1;
+	}
+
+	/* The color block of texels: two opposite corners of their bounding box, inset a little, and each texel's closest of the 4 colors
+	*  between them. Endpoint 0 is always above endpoint 1, so BC1 decodes the block with 4 colors as well, the same as BC3
+	*/
+	static unsigned long long EncodeColorBlock(const unsigned int* texels)
+	{
+		int minimum[3] = { 255, 255, 255 };
+		int maximum[3] = { 0, 0, 0 };
+		int sum[3] = { 0, 0, 0 };
+		for (unsigned int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			for (unsigned int channel = 0; channel < 3; channel++)
+			{
+				int value = GetChannel(texels[i], channel);
+				minimum[channel] = value < minimum[channel] ? value : minimum[channel];
+				maximum[channel] = value > maximum[channel] ? value : maximum[channel];
+				sum[channel] += value;
+			}
+		}
+
+		// Red and blue that fall as green rises take the box's other diagonal, the sign of their covariance with green says which
+		int covariance[3] = { 0, 0, 0 };
+		for (unsigned int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			int green = GetChannel(texels[i], 1) * static_cast<int>(BLOCK_TEXELS) - sum[1];
+			covariance[0] += (GetChannel(texels[i], 0) * static_cast<int>(BLOCK_TEXELS) - sum[0]) * green;
+			covariance[2] += (GetChannel(texels[i], 2) * static_cast<int>(BLOCK_TEXELS) - sum[2]) * green;
+		}
+
+		// Pulling the corners in by 1/16 of the box spends the endpoints' precision where most texels are
+		int start[3];
+		int end[3];
+		for (unsigned int channel = 0; channel < 3; channel++)
+		{
+			int inset = (maximum[channel] - minimum[channel]) >> 4;
+			start[channel] = covariance[channel] < 0 ? minimum[channel] + inset : maximum[channel] - inset;
+			end[channel] = covariance[channel] < 0 ? maximum[channel] - inset : minimum[channel] + inset;
+		}
+
+		unsigned int endpoint0 = PackRGB565(start[0], start[1], start[2]);
+		unsigned int endpoint1 = PackRGB565(end[0], end[1], end[2]);
+		if (endpoint0 < endpoint1) { std::swap(endpoint0, endpoint1); }
+
+		unsigned long long block = endpoint0 | (endpoint1 << 16);
+		if (endpoint0 == endpoint1) { return block; }
+
+		unsigned int palette[4];
+		GetColorPalette(endpoint0, endpoint1, palette);
+
+		for (unsigned int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			unsigned int bestIndex = 0;
+			int bestDistance = 0x7FFFFFFF;
+			for (unsigned int index = 0; index < 4; index++)
+			{
+				int distance = 0;
+				for (unsigned int channel = 0; channel < 3; channel++)
+				{
+					int difference = GetChannel(texels[i], channel) - GetChannel(palette[index], channel);
+					distance += difference * difference;
+				}
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					bestIndex = index;
+				}
+			}
+			block |= static_cast<unsigned long long>(bestIndex) << (32 + i * 2);
+		}
+		return block;
+	}
+
+	/* The alpha block of texels: their lowest and highest alpha and each texel's closest of the 8 alphas between them */
+	static unsigned long long EncodeAlphaBlock(const unsigned int* texels)
+	{
+		unsigned int minimum = 255;
+		unsigned int maximum = 0;
+		for (unsigned int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			unsigned int alpha = texels[i] >> 24;
+			minimum = alpha < minimum ? alpha : minimum;
+			maximum = alpha > maximum ? alpha : maximum;
+		}
+
+		unsigned long long block = maximum | (minimum << 8);
+		if (maximum == minimum) { return block; }
+
+		unsigned int palette[8];
+		GetAlphaPalette(maximum, minimum, palette);
+
+		for (unsigned int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			unsigned int alpha = texels[i] >> 24;
+			unsigned int bestIndex = 0;
+			unsigned int bestDistance = 256;
+			for (unsigned int index = 0; index < 8; index++)
+			{
+				unsigned int distance = alpha > palette[index] ? alpha - palette[index] : palette[index] - alpha;
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					bestIndex = index;
+				}
+			}
+			block |= static_cast<unsigned long long>(bestIndex) << (16 + i * 3);
+		}
+		return block;
+	}
+
+	/* The 16 opaque texels of a color block. bFourColors is BC3's rule, BC1 only uses 4 colors when endpoint 0 is above endpoint 1
+	*  and otherwise 3 and transparent black
+	*/
+	static void DecodeColorBlock(unsigned long long block, bool bFourColors, unsigned int* texels)
+	{
+		unsigned int endpoint0 = static_cast<unsigned int>(block & 0xFFFF);
+		unsigned int endpoint1 = static_cast<unsigned int>((block >> 16) & 0xFFFF);
+
+		unsigned int palette[4];
+		if (bFourColors || endpoint0 > endpoint1)
+		{
+			GetColorPalette(endpoint0, endpoint1, palette);
+		}
+		else
+		{
+			unsigned int color0 = UnpackRGB565(endpoint0);
+			unsigned int color1 = UnpackRGB565(endpoint1);
+			palette[0] = color0;
+			palette[1] = color1;
+			// Halves of each channel, plus the 1 both halves drop when both are odd
+			palette[2] = (((color0 & 0x00FEFEFE) >> 1) + ((color1 & 0x00FEFEFE) >> 1) + (color0 & color1 & 0x00010101)) | ALPHA_CHANNEL;
+			palette[3] = 0;
+		}
+
+		unsigned int indices = static_cast<unsigned int>(block >> 32);
+		for (unsigned int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			texels[i] = palette[(indices >> (i * 2)) & 3];
+		}
+	}
+
+	/* Replaces the alpha of the 16 texels with the alpha block's */
+	static void DecodeAlphaBlock(unsigned long long block, unsigned int* texels)
+	{
+		unsigned int palette[8];
+		GetAlphaPalette(static_cast<unsigned int>(block & 0xFF), static_cast<unsigned int>((block >> 8) & 0xFF), palette);
+
+		for (unsigned int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			unsigned int alpha = palette[(block >> (16 + i * 3)) & 7];
+			texels[i] = (texels[i] & ~ALPHA_CHANNEL) | (alpha << 24);
+		}
+	}
+
+private:
+	/* Channel 0 is red, 1 green, 2 blue */
+	inline static int GetChannel(unsigned int color, unsigned int channel)
+	{
+		return static_cast<int>((color >> (16 - channel * 8)) & 0xFF);
+	}
+
+	/* Rounded to the nearest 5 / 6 / 5 bit value */
+	inline static unsigned int PackRGB565(int red, int green, int blue)
+	{
+		unsigned int red5 = static_cast<unsigned int>(red * 31 + 127) / 255;
+		unsigned int green6 = static_cast<unsigned int>(green * 63 + 127) / 255;
+		unsigned int blue5 = static_cast<unsigned int>(blue * 31 + 127) / 255;
+		return (red5 << 11) | (green6 << 5) | blue5;
+	}
+
+	/* Opaque ARGB, the top bits of each channel repeated into its low bits so 0 and the maximum map to 0 and 255 */
+	inline static unsigned int UnpackRGB565(unsigned int color)
+	{
+		unsigned int red = (color >> 11) & 0x1F;
+		unsigned int green = (color >> 5) & 0x3F;
+		unsigned int blue = color & 0x1F;
+		return ALPHA_CHANNEL | ((red << 3) | (red >> 2)) << 16 | ((green << 2) | (green >> 4)) << 8 | ((blue << 3) | (blue >> 2));
+	}
+
+	/* The RGB channels of color 21 bits apart, so the palette's weighted sums and divisions run on all three at once */
+	inline static unsigned long long SpreadChannels(unsigned int color)
+	{
+		return (color & 0xFF) | (static_cast<unsigned long long>(color & 0xFF00) << 13) | (static_cast<unsigned long long>(color & 0xFF0000) << 26);
+	}
+
+	/* Opaque color of channels (at most 765 each) divided by 3. x * 683 >> 11 is x / 3 exactly below 1536 and stays inside a field */
+	inline static unsigned int GatherChannelsDividedBy3(unsigned long long channels)
+	{
+		unsigned long long quotients = (channels * 683) >> 11;
+		return ALPHA_CHANNEL | static_cast<unsigned int>((quotients & 0xFF) | ((quotients >> 13) & 0xFF00) | ((quotients >> 26) & 0xFF0000));
+	}
+
+	/* The endpoints and the colors 1/3 and 2/3 of the way from endpoint 0 to endpoint 1 */
+	inline static void GetColorPalette(unsigned int endpoint0, unsigned int endpoint1, unsigned int* palette)
+	{
+		unsigned int color0 = UnpackRGB565(endpoint0);
+		unsigned int color1 = UnpackRGB565(endpoint1);
+		unsigned long long channels0 = SpreadChannels(color0);
+		unsigned long long channels1 = SpreadChannels(color1);
+
+		palette[0] = color0;
+		palette[1] = color1;
+		palette[2] = GatherChannelsDividedBy3(channels0 * 2 + channels1);
+		palette[3] = GatherChannelsDividedBy3(channels0 + channels1 * 2);
+	}
+
+	/* 6 alphas between the endpoints when alpha0 is above alpha1, otherwise 4 between them and 0 and 255 */
+	inline static void GetAlphaPalette(unsigned int alpha0, unsigned int alpha1, unsigned int* palette)
+	{
+		palette[0] = alpha0;
+		palette[1] = alpha1;
+		if (alpha0 > alpha1)
+		{
+			for (unsigned int i = 1; i < 7; i++)
+			{
+				palette[i + 1] = (alpha0 * (7 - i) + alpha1 * i) / 7;
+			}
+		}
+		else
+		{
+			for (unsigned int i = 1; i < 5; i++)
+			{
+				palette[i + 1] = (alpha0 * (5 - i) + alpha1 * i) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+};
+
+/* The texels of the blocks sampled last on this thread, so bilinear filtering and neighbouring pixels, which mostly read
+*  the same few blocks, decode each of them once. Entries are found by the block's bits, so blocks that are alike share one
+*  and there is nothing to invalidate when a texture goes away
+*/
+struct DecodedBlockCache
+{
+public:
+	static const unsigned int ENTRY_BITS = 6;
+	static const unsigned int ENTRY_COUNT = 1 << ENTRY_BITS;
+
+	struct Entry
+	{
+		unsigned long long Color;
+		unsigned long long Alpha;
+
+		/* ARGB (0) while the entry is empty */
+		TextureFormat Format;
+
+		unsigned int Texels[BlockCompression::BLOCK_TEXELS];
+	};
+
+	Entry Entries[ENTRY_COUNT];
+
+public:
+	/* Zero initialized, so the first use on a thread costs nothing to set up */
+	inline static DecodedBlockCache& GetThreadCache()
+	{
+		static thread_local DecodedBlockCache cache;
+		return cache;
+	}
+
+	/* The 16 texels of a BC1 (alpha is 0) or BC3 block */
+	inline const unsigned int* GetTexels(TextureFormat format, unsigned long long color, unsigned long long alpha)
+	{
+		unsigned int slot = static_cast<unsigned int>(((color ^ alpha) * 0x9E3779B97F4A7C15ull) >> (64 - ENTRY_BITS));
+		Entry& entry = Entries[slot];
+		if (entry.Color != color || entry.Alpha != alpha || entry.Format != format)
+		{
+			entry.Color = color;
+			entry.Alpha = alpha;
+			entry.Format = format;
+
+			BlockCompression::DecodeColorBlock(color, format == TextureFormat::BC3, entry.Texels);
+			if (format == TextureFormat::BC3) { BlockCompression::DecodeAlphaBlock(alpha, entry.Texels); }
+		}
+		return entry.Texels;
+	}
+};
@@ -0,0 +1,189 @@
+#pragma once
+#include "Math/SIMDLanes.h"
+
+/* XRGB to 8 bit YUV 4:2:0 (BT.601 coefficients, limited range 16 - 235 / 16 - 240), the layout of a Y4M C420jpeg frame:
+*  a width x height Y plane followed by U and V planes of ((width + 1) / 2) x ((height + 1) / 2).
+*  Every chroma sample is the rounded average of its 2x2 block, odd widths / heights replicate the last column / row.
+*  The AVX2 kernel and the scalar path produce identical bytes, the scalar one also finishes the edges the kernel skips.
+*/
+struct ColorConversion
+{
+public:
+	static void XRGBToYUV420(const unsigned int* xrgbPixels, unsigned int width, unsigned int height,
+		unsigned char* yPlane, unsigned char* uPlane, unsigned char* vPlane)
+	{
+#if SIMD_AVX2_AVAILABLE
+		static const bool bAVX2 = SIMD::IsAVX2Supported();
+		if (bAVX2)
+		{
+			XRGBToYUV420AVX2(xrgbPixels, width, height, yPlane, uPlane, vPlane);
+			return;
+		}
+#endif
+		XRGBToYUV420Scalar(xrgbPixels, width, height, yPlane, uPlane, vPlane);
+	}
+
+	static void XRGBToYUV420Scalar(const unsigned int* xrgbPixels, unsigned int width, unsigned int height,
+		unsigned char* yPlane, unsigned char* uPlane, unsigned char* vPlane)
+	{
+		for (unsigned int y = 0; y < height; y += 2)
+		{
+			for (unsigned int x = 0; x < width; x += 2)
+			{
+				ConvertBlock(xrgbPixels, width, height, x, y, yPlane, uPlane, vPlane);
+			}
+		}
+	}
+
+#if SIMD_AVX2_AVAILABLE
+	/* 16 x 2 pixels per step, 16 bit lanes for luma and 32 bit lanes for chroma so the math is exactly the scalar one */
+	SIMD_AVX2_FUNCTION static void XRGBToYUV420AVX2(const unsigned int* xrgbPixels, unsigned int width, unsigned int height,
+		unsigned char* yPlane, unsigned char* uPlane, unsigned char* vPlane)
+	{
+		const unsigned int chromaWidth = (width + 1) / 2;
+		const unsigned int vectorWidth = width & ~15u;
+
+		const __m256i byteMask = _mm256_set1_epi32(0xFF);
+		const __m256i lumaR = _mm256_set1_epi16(66);
+		const __m256i lumaG = _mm256_set1_epi16(129);
+		const __m256i lumaB = _mm256_set1_epi16(25);
+		const __m256i lumaBias = _mm256_set1_epi16(128);
+		const __m256i lumaOffset = _mm256_set1_epi16(16);
+		const __m256i ones = _mm256_set1_epi16(1);
+		const __m256i two = _mm256_set1_epi32(2);
+		const __m256i uR = _mm256_set1_epi32(-38);
+		const __m256i uG = _mm256_set1_epi32(-74);
+		const __m256i vG = _mm256_set1_epi32(-94);
+		const __m256i vB = _mm256_set1_epi32(-18);
+		const __m256i chroma112 = _mm256_set1_epi32(112);
+		const __m256i chromaBias = _mm256_set1_epi32(128);
+
+		for (unsigned int y = 0; y + 1 < height; y += 2)
+		{
+			const unsigned int* row0 = xrgbPixels + y * width;
+			const unsigned int* row1 = row0 + width;
+			unsigned char* yRow0 = yPlane + y * width;
+			unsigned char* yRow1 = yRow0 + width;
+			unsigned char* uRow = uPlane + (y / 2) * chromaWidth;
+			unsigned char* vRow = vPlane + (y / 2) * chromaWidth;
+
+			for (unsigned int x = 0; x < vectorWidth; x += 16)
+			{
+				__m256i r0, g0, b0, r1, g1, b1;
+				LoadChannels(row0 + x, byteMask, r0, g0, b0);
+				LoadChannels(row1 + x, byteMask, r1, g1, b1);
+
+				StoreLuma(yRow0 + x, r0, g0, b0, lumaR, lumaG, lumaB, lumaBias, lumaOffset);
+				StoreLuma(yRow1 + x, r1, g1, b1, lumaR, lumaG, lumaB, lumaBias, lumaOffset);
+
+				// Vertical pair sums fit 16 bits, madd with ones adds the horizontal pairs into 32 bit lanes
+				__m256i r = _mm256_srli_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_add_epi16(r0, r1), ones), two), 2);
+				__m256i g = _mm256_srli_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_add_epi16(g0, g1), ones), two), 2);
+				__m256i b = _mm256_srli_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_add_epi16(b0, b1), ones), two), 2);
+
+				__m256i u = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(r, uR), _mm256_mullo_epi32(g, uG)),
+					_mm256_add_epi32(_mm256_mullo_epi32(b, chroma112), chromaBias));
+				__m256i v = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(r, chroma112), _mm256_mullo_epi32(g, vG)),
+					_mm256_add_epi32(_mm256_mullo_epi32(b, vB), chromaBias));
+				u = _mm256_add_epi32(_mm256_srai_epi32(u, 8), chromaBias);
+				v = _mm256_add_epi32(_mm256_srai_epi32(v, 8), chromaBias);
+
+				StoreChroma(uRow + x / 2, u);
+				StoreChroma(vRow + x / 2, v);
+			}
+
+			for (unsigned int x = vectorWidth; x < width; x += 2)
+			{
+				ConvertBlock(xrgbPixels, width, height, x, y, yPlane, uPlane, vPlane);
+			}
+		}
+
+		if (height & 1)
+		{
+			for (unsigned int x = 0; x < width; x += 2)
+			{
+				ConvertBlock(xrgbPixels, width, height, x, height - 1, yPlane, uPlane, vPlane);
+			}
+		}
+	}
+#endif
+
+private:
+	inline static unsigned char Luma(int r, int g, int b)
+	{
+		return static_cast<unsigned char>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+	}
+
+	/* Writes the luma of the (up to) 2x2 block at x, y and its chroma sample */
+	inline static void ConvertBlock(const unsigned int* xrgbPixels, unsigned int width, unsigned int height, unsigned int x, unsigned int y,
+		unsigned char* yPlane, unsigned char* uPlane, unsigned char* vPlane)
+	{
+		const unsigned int columns[2] = { x, (x + 1 < width) ? x + 1 : x };
+		const unsigned int rows[2] = { y, (y + 1 < height) ? y + 1 : y };
+
+		int rSum = 0;
+		int gSum = 0;
+		int bSum = 0;
+		for (unsigned int i = 0; i < 2; i++)
+		{
+			for (unsigned int j = 0; j < 2; j++)
+			{
+				unsigned int pixel = xrgbPixels[rows[i] * width + columns[j]];
+				int r = (pixel >> 16) & 0xFF;
+				int g = (pixel >> 8) & 0xFF;
+				int b = pixel & 0xFF;
+
+				rSum += r;
+				gSum += g;
+				bSum += b;
+
+				yPlane[rows[i] * width + columns[j]] = Luma(r, g, b);
+			}
+		}
+
+		int r = (rSum + 2) >> 2;
+		int g = (gSum + 2) >> 2;
+		int b = (bSum + 2) >> 2;
+
+		unsigned int chromaIndex = (y / 2) * ((width + 1) / 2) + x / 2;
+		uPlane[chromaIndex] = static_cast<unsigned char>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+		vPlane[chromaIndex] = static_cast<unsigned char>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+	}
+
+#if SIMD_AVX2_AVAILABLE
+	/* Splits 16 pixels into their channels, one 16 bit lane per pixel in pixel order */
+	SIMD_AVX2_FUNCTION inline static void LoadChannels(const unsigned int* pixels, __m256i byteMask, __m256i& r, __m256i& g, __m256i& b)
+	{
+		__m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels));
+		__m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels + 8));
+
+		// packus interleaves the 128 bit halves of both inputs, the permute puts the pixels back in order
+		r = _mm256_permute4x64_epi64(_mm256_packus_epi32(_mm256_and_si256(_mm256_srli_epi32(low, 16), byteMask),
+			_mm256_and_si256(_mm256_srli_epi32(high, 16), byteMask)), 0xD8);
+		g = _mm256_permute4x64_epi64(_mm256_packus_epi32(_mm256_and_si256(_mm256_srli_epi32(low, 8), byteMask),
+			_mm256_and_si256(_mm256_srli_epi32(high, 8), byteMask)), 0xD8);
+		b = _mm256_permute4x64_epi64(_mm256_packus_epi32(_mm256_and_si256(low, byteMask),
+			_mm256_and_si256(high, byteMask)), 0xD8);
+	}
+
+	/* 66r + 129g + 25b + 128 stays below 2^16, so unsigned 16 bit math is exact */
+	SIMD_AVX2_FUNCTION inline static void StoreLuma(unsigned char* destination, __m256i r, __m256i g, __m256i b,
+		__m256i lumaR, __m256i lumaG, __m256i lumaB, __m256i lumaBias, __m256i lumaOffset)
+	{
+		__m256i luma = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(r, lumaR), _mm256_mullo_epi16(g, lumaG)),
+			_mm256_add_epi16(_mm256_mullo_epi16(b, lumaB), lumaBias));
+		luma = _mm256_add_epi16(_mm256_srli_epi16(luma, 8), lumaOffset);
+
+		__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(luma, luma), 0x08);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(destination), _mm256_castsi256_si128(packed));
+	}
+
+	/* Stores 8 chroma samples held in 32 bit lanes */
+	SIMD_AVX2_FUNCTION inline static void StoreChroma(unsigned char* destination, __m256i chroma)
+	{
+		__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(chroma, chroma), 0x08);
+		__m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(packed), _mm256_castsi256_si128(packed));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(destination), bytes);
+	}
+#endif
+};
@@ -0,0 +1,270 @@
+#pragma once
+#include "Math/Math.h"
+#include "Graphics/BlockCompression.h"
+#include <vector>
+#include <algorithm>
+#include <atomic>
+
+/* Order of the texels in memory */
+enum class TextureLayout
+{
+	/* Row after row */
+	Linear,
+
+	/* 4x4 tiles of texels, each one cache line, tile after tile along rows of tiles. The texels bilinear filtering reads
+	*  are mostly in one line whichever direction the texture coordinates run in
+	*/
+	Tiled
+};
+
+/* One level of a MipChain. Sizes are powers of two, so texel coordinates wrap with a mask.
+*  Texels are kept in square tiles 1 << TileBits texels a side (TileBits 0 is plain rows), the index of texel x, y
+*  is GetTexelIndexX(x) | GetTexelIndexY(y): the parts the two coordinates give never overlap.
+*  Block compressed levels are tiled 4x4 and each tile is a block, the block of texel index is index >> 4
+*/
+struct MipLevel
+{
+	TextureFormat Format;
+
+	/* ARGB levels' texels */
+	const unsigned int* Pixels;
+
+	/* Block compressed levels' blocks, one 64 bit word each for BC1 and two (alpha then color) for BC3 */
+	const unsigned long long* Blocks;
+
+	unsigned int Width;
+	unsigned int Height;
+
+	unsigned int WidthMask;
+	unsigned int HeightMask;
+
+	unsigned int TileBits;
+	unsigned int TileMask;
+
+	/* Tiles along a row of tiles are 1 << TileShift texels apart, rows of tiles 1 << RowShift */
+	unsigned int TileShift;
+	unsigned int RowShift;
+
+	/* Width and Height as floats, what texture coordinates get scaled by */
+	float ScaleU;
+	float ScaleV;
+
+public:
+	inline MipLevel()
+		: Format(TextureFormat::ARGB), Pixels(nullptr), Blocks(nullptr), Width(0), Height(0), WidthMask(0), HeightMask(0), TileBits(0), TileMask(0), TileShift(0), RowShift(0),
+		ScaleU(0.0f), ScaleV(0.0f) { }
+
+	/* x, y must already be wrapped to the level */
+	inline unsigned int GetTexelIndexX(unsigned int x) const { return ((x >> TileBits) << TileShift) | (x & TileMask); }
+	inline unsigned int GetTexelIndexY(unsigned int y) const { return ((y >> TileBits) << RowShift) | ((y & TileMask) << TileBits); }
+	inline unsigned int GetTexelIndex(unsigned int x, unsigned int y) const { return GetTexelIndexX(x) | GetTexelIndexY(y); }
+};
+
+/* A texture and all of its mip levels, level 0 first, in one allocation per format.
+*  Each level halves the one before it by averaging 2x2 texels, down to a level 1 texel wide or high.
+*  Compressed chains downsample the texels before they are encoded, so encoding errors do not add up level after level
+*/
+class MipChain
+{
+public:
+	static const unsigned int MAX_LEVELS = 16;
+
+private:
+	std::vector<unsigned int> mPixels;
+	std::vector<unsigned long long> mBlocks;
+
+	MipLevel mLevels[MAX_LEVELS];
+	unsigned int mLevelCount;
+
+	/* Changes whenever the texels do and is never shared by two MipChains, 0 before the first Build */
+	unsigned long long mGeneration;
+
+public:
+	MipChain()
+		: mLevelCount(0), mGeneration(0) { }
+
+	/* Levels point into mPixels */
+	MipChain(const MipChain&) = delete;
+	MipChain& operator=(const MipChain&) = delete;
+
+public:
+	const MipLevel* GetLevels() const { return mLevels; }
+	unsigned int GetLevelCount() const { return mLevelCount; }
+	unsigned long long GetGeneration() const { return mGeneration; }
+
+	/* Replaces the chain with pixels (row after row) and its mip levels, stored in layout and format.
+	*  Block compressed chains are always tiled, levels smaller than a block stay ARGB.
+	*  A size that is not a power of two is resampled up to the next one
+	*/
+	void Build(const unsigned int* pixels, unsigned int width, unsigned int height, TextureLayout layout = TextureLayout::Linear,
+		TextureFormat format = TextureFormat::ARGB)
+	{
+		const unsigned int tileBits = (layout == TextureLayout::Tiled || format != TextureFormat::ARGB) ? BlockCompression::BLOCK_BITS : 0;
+
+		unsigned int levelWidth = RoundUpToPowerOfTwo(width);
+		unsigned int levelHeight = RoundUpToPowerOfTwo(height);
+
+		// Sizes and offsets first, so the pixels are allocated once
+		unsigned int offsets[MAX_LEVELS];
+		unsigned int totalPixels = 0;
+		mLevelCount = 0;
+		while (mLevelCount < MAX_LEVELS)
+		{
+			MipLevel& level = mLevels[mLevelCount];
+			level.Format = TextureFormat::ARGB;
+			level.Blocks = nullptr;
+			level.Width = levelWidth;
+			level.Height = levelHeight;
+			level.WidthMask = levelWidth - 1;
+			level.HeightMask = levelHeight - 1;
+			// Levels smaller than a tile are tiled as far as they go
+			level.TileBits = (std::min)(tileBits, (std::min)(Log2(levelWidth), Log2(levelHeight)));
+			level.TileMask = (1u << level.TileBits) - 1;
+			level.TileShift = level.TileBits * 2;
+			level.RowShift = Log2(levelWidth) + level.TileBits;
+			level.ScaleU = static_cast<float>(levelWidth);
+			level.ScaleV = static_cast<float>(levelHeight);
+
+			offsets[mLevelCount++] = totalPixels;
+			totalPixels += levelWidth * levelHeight;
+
+			if (levelWidth == 1 || levelHeight == 1) { break; }
+			levelWidth /= 2;
+			levelHeight /= 2;
+		}
+
+		mBlocks.clear();
+		mPixels.assign(totalPixels, 0);
+		for (unsigned int i = 0; i < mLevelCount; i++)
+		{
+			mLevels[i].Pixels = mPixels.data() + offsets[i];
+		}
+
+		unsigned int* levelPixels = mPixels.data();
+		for (unsigned int y = 0; y < mLevels[0].Height; y++)
+		{
+			unsigned int sourceRow = (y * height / mLevels[0].Height) * width;
+			for (unsigned int x = 0; x < mLevels[0].Width; x++)
+			{
+				levelPixels[mLevels[0].GetTexelIndex(x, y)] = pixels[sourceRow + x * width / mLevels[0].Width];
+			}
+		}
+
+		for (unsigned int i = 1; i < mLevelCount; i++)
+		{
+			const MipLevel& last = mLevels[i - 1];
+			unsigned int* newPixels = mPixels.data() + offsets[i];
+
+			for (unsigned int y = 0; y < mLevels[i].Height; y++)
+			{
+				for (unsigned int x = 0; x < mLevels[i].Width; x++)
+				{
+					unsigned int left = last.GetTexelIndexX(x * 2);
+					unsigned int right = last.GetTexelIndexX(x * 2 + 1);
+					unsigned int top = last.GetTexelIndexY(y * 2);
+					unsigned int bottom = last.GetTexelIndexY(y * 2 + 1);
+
+					unsigned int color1 = Math::LerpColor(last.Pixels[top | left], last.Pixels[top | right], 0.5f);
+					unsigned int color2 = Math::LerpColor(last.Pixels[bottom | left], last.Pixels[bottom | right], 0.5f);
+					newPixels[mLevels[i].GetTexelIndex(x, y)] = Math::LerpColor(color1, color2, 0.5f);
+				}
+			}
+		}
+
+		mGeneration = NextGeneration();
+
+		if (format != TextureFormat::ARGB) { Compress(format); }
+	}
+
+private:
+	/* Encodes every level a block or more a side into mBlocks, then keeps only the other levels' texels */
+	void Compress(TextureFormat format)
+	{
+		const unsigned int blockWords = (format == TextureFormat::BC3) ? 2 : 1;
+
+		unsigned int totalBlockWords = 0;
+		unsigned int totalPixels = 0;
+		for (unsigned int i = 0; i < mLevelCount; i++)
+		{
+			unsigned int levelTexels = mLevels[i].Width * mLevels[i].Height;
+			if (mLevels[i].TileBits == BlockCompression::BLOCK_BITS) { totalBlockWords += levelTexels / BlockCompression::BLOCK_TEXELS * blockWords; }
+			else { totalPixels += levelTexels; }
+		}
+
+		mBlocks.assign(totalBlockWords, 0);
+		std::vector<unsigned int> pixels(totalPixels);
+
+		unsigned int blockOffset = 0;
+		unsigned int pixelOffset = 0;
+		for (unsigned int i = 0; i < mLevelCount; i++)
+		{
+			MipLevel& level = mLevels[i];
+			unsigned int levelTexels = level.Width * level.Height;
+
+			if (level.TileBits != BlockCompression::BLOCK_BITS)
+			{
+				std::copy(level.Pixels, level.Pixels + levelTexels, pixels.begin() + pixelOffset);
+				pixelOffset += levelTexels;
+				continue;
+			}
+
+			// Tiles are blocks, so a block's texels are 16 in a row, in block order
+			unsigned long long* blocks = mBlocks.data() + blockOffset;
+			for (unsigned int block = 0; block < levelTexels / BlockCompression::BLOCK_TEXELS; block++)
+			{
+				const unsigned int* texels = level.Pixels + block * BlockCompression::BLOCK_TEXELS;
+				if (format == TextureFormat::BC3)
+				{
+					blocks[block * 2] = BlockCompression::EncodeAlphaBlock(texels);
+					blocks[block * 2 + 1] = BlockCompression::EncodeColorBlock(texels);
+				}
+				else
+				{
+					blocks[block] = BlockCompression::EncodeColorBlock(texels);
+				}
+			}
+
+			level.Format = format;
+			level.Blocks = blocks;
+			blockOffset += levelTexels / BlockCompression::BLOCK_TEXELS * blockWords;
+		}
+
+		mPixels.swap(pixels);
+
+		pixelOffset = 0;
+		for (unsigned int i = 0; i < mLevelCount; i++)
+		{
+			MipLevel& level = mLevels[i];
+			if (level.Format != TextureFormat::ARGB)
+			{
+				level.Pixels = nullptr;
+				continue;
+			}
+			level.Pixels = mPixels.data() + pixelOffset;
+			pixelOffset += level.Width * level.Height;
+		}
+
+		mGeneration = NextGeneration();
+	}
+
+	/* Counts up across every MipChain, so a rebuilt chain never reuses a generation, even at the address of a destroyed one */
+	static unsigned long long NextGeneration()
+	{
+		static std::atomic<unsigned long long> generation(0);
+		return ++generation;
+	}
+
+	static unsigned int RoundUpToPowerOfTwo(unsigned int value)
+	{
+		unsigned int powerOfTwo = 1;
+		while (powerOfTwo < value) { powerOfTwo <<= 1; }
+		return powerOfTwo;
+	}
+
+	static unsigned int Log2(unsigned int powerOfTwo)
+	{
+		unsigned int log = 0;
+		while ((1u << log) < powerOfTwo) { log++; }
+		return log;
+	}
+};
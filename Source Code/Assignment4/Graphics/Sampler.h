@@ -0,0 +1,247 @@
+#pragma once
+#include "Graphics/MipChain.h"
+
+/* Handle to the levels of a MipChain the pixel shaders sample, bound to the context before drawing.
+*  Coordinates wrap, both in whole texels and for the neighbours bilinear filtering reads.
+*  Filtering runs on the packed 8 bit channels with fixed point weights, one texel at a time or a block of SIMD lanes at a time.
+*  Block compressed levels are decoded as they are fetched, through this thread's DecodedBlockCache
+*/
+struct Sampler
+{
+	const MipLevel* Levels;
+	unsigned int MaxLevel;
+
+	/* The chain Levels points into, only to tell when its texels change */
+	const MipChain* Chain;
+
+	/* Filter weights are fixed point, FILTER_WEIGHT_ONE is a weight of 1 */
+	static const unsigned int FILTER_WEIGHT_BITS = 8;
+	static const unsigned int FILTER_WEIGHT_ONE = 1 << FILTER_WEIGHT_BITS;
+
+public:
+	inline Sampler()
+		: Levels(nullptr), MaxLevel(0), Chain(nullptr) { }
+
+	inline Sampler(const MipChain& mipChain)
+		: Levels(mipChain.GetLevels()), MaxLevel(mipChain.GetLevelCount() ? mipChain.GetLevelCount() - 1 : 0), Chain(&mipChain) { }
+
+	inline const MipLevel& GetLevel(unsigned int level) const { return Levels[level]; }
+
+	/* MipChain::GetGeneration of the bound chain, 0 if none is bound */
+	inline unsigned long long GetGeneration() const { return Chain ? Chain->GetGeneration() : 0; }
+
+	/* Level closest to lod, what nearest and bilinear filtering sample */
+	inline static unsigned int GetNearestLevel(float lod) { return static_cast<unsigned int>(lod + 0.5f); }
+
+	/* The texel u, v falls in */
+	inline static unsigned int SampleNearest(const MipLevel& level, float u, float v)
+	{
+		unsigned int x = static_cast<unsigned int>(static_cast<int>(u * level.ScaleU)) & level.WidthMask;
+		unsigned int y = static_cast<unsigned int>(static_cast<int>(v * level.ScaleV)) & level.HeightMask;
+
+		return FetchTexel(level, level.GetTexelIndex(x, y));
+	}
+
+	/* The texel u, v falls in blended with its right, bottom and diagonal neighbours by how far u, v is into it */
+	inline static unsigned int SampleBilinear(const MipLevel& level, float u, float v)
+	{
+		// Texel coordinates with FILTER_WEIGHT_BITS of fraction, the shift floors them and the mask wraps them
+		unsigned int texelU = static_cast<unsigned int>(static_cast<int>(u * (level.ScaleU * FILTER_WEIGHT_ONE)));
+		unsigned int texelV = static_cast<unsigned int>(static_cast<int>(v * (level.ScaleV * FILTER_WEIGHT_ONE)));
+
+		unsigned int left = level.GetTexelIndexX((texelU >> FILTER_WEIGHT_BITS) & level.WidthMask);
+		unsigned int right = level.GetTexelIndexX(((texelU >> FILTER_WEIGHT_BITS) + 1) & level.WidthMask);
+		unsigned int top = level.GetTexelIndexY((texelV >> FILTER_WEIGHT_BITS) & level.HeightMask);
+		unsigned int bottom = level.GetTexelIndexY(((texelV >> FILTER_WEIGHT_BITS) + 1) & level.HeightMask);
+
+		unsigned int uWeight = texelU & (FILTER_WEIGHT_ONE - 1);
+		unsigned int vWeight = texelV & (FILTER_WEIGHT_ONE - 1);
+
+		unsigned int topLeft, topRight, bottomLeft, bottomRight;
+		if (level.Format == TextureFormat::ARGB)
+		{
+			topLeft = level.Pixels[top | left];
+			topRight = level.Pixels[top | right];
+			bottomLeft = level.Pixels[bottom | left];
+			bottomRight = level.Pixels[bottom | right];
+		}
+		else
+		{
+			// Mostly all 4 texels are in the top left one's block, which is then decoded or looked up once.
+			// They are all read from it before any other block is fetched, that could take over its cache entry
+			const unsigned int* texels = GetBlockTexels(level, top | left);
+			const unsigned int texelMask = BlockCompression::BLOCK_TEXELS - 1;
+			topLeft = texels[(top | left) & texelMask];
+			topRight = texels[(top | right) & texelMask];
+			bottomLeft = texels[(bottom | left) & texelMask];
+			bottomRight = texels[(bottom | right) & texelMask];
+
+			bool bRightInBlock = ((top | right) >> BLOCK_INDEX_SHIFT) == ((top | left) >> BLOCK_INDEX_SHIFT);
+			bool bBottomInBlock = ((bottom | left) >> BLOCK_INDEX_SHIFT) == ((top | left) >> BLOCK_INDEX_SHIFT);
+			if (!bRightInBlock) { topRight = FetchTexel(level, top | right); }
+			if (!bBottomInBlock) { bottomLeft = FetchTexel(level, bottom | left); }
+			if (!bRightInBlock || !bBottomInBlock) { bottomRight = FetchTexel(level, bottom | right); }
+		}
+
+		unsigned int color1 = LerpTexels(topLeft, topRight, uWeight);
+		unsigned int color2 = LerpTexels(bottomLeft, bottomRight, uWeight);
+
+		return LerpTexels(color1, color2, vWeight) | ALPHA_CHANNEL;
+	}
+
+	/* Bilinear samples of two levels blended by ratio, 0 is all of level1. Skips level2 when its weight rounds to 0 */
+	inline static unsigned int SampleTrilinear(const MipLevel& level1, const MipLevel& level2, float u, float v, float ratio)
+	{
+		unsigned int color1 = SampleBilinear(level1, u, v);
+
+		unsigned int weight = static_cast<unsigned int>(ratio * FILTER_WEIGHT_ONE);
+		if (weight == 0) { return color1; }
+
+		return LerpTexels(color1, SampleBilinear(level2, u, v), weight) | ALPHA_CHANNEL;
+	}
+
+	/* Sampler::SampleNearest of every lane in mask, the lanes outside of it are 0 */
+	template<class Lanes>
+	inline static typename Lanes::Int SampleNearestBlock(const MipLevel& level, typename Lanes::Float u, typename Lanes::Float v, int mask)
+	{
+		typedef typename Lanes::Int Int;
+
+		if (level.Format != TextureFormat::ARGB) { return SampleEachLane<Lanes, SampleNearest>(level, u, v, mask); }
+
+		Int x = Lanes::And(Lanes::ToIntTruncate(Lanes::Mul(u, Lanes::Set(level.ScaleU))), Lanes::SetInt(level.WidthMask));
+		Int y = Lanes::And(Lanes::ToIntTruncate(Lanes::Mul(v, Lanes::Set(level.ScaleV))), Lanes::SetInt(level.HeightMask));
+
+		return Lanes::MaskGather(level.Pixels, Lanes::Or(GetTexelIndexXBlock<Lanes>(level, x), GetTexelIndexYBlock<Lanes>(level, y)), mask);
+	}
+
+	/* Sampler::SampleBilinear of every lane in mask, the same texels to the bit. The lanes outside of mask are undefined */
+	template<class Lanes>
+	inline static typename Lanes::Int SampleBilinearBlock(const MipLevel& level, typename Lanes::Float u, typename Lanes::Float v, int mask)
+	{
+		typedef typename Lanes::Int Int;
+
+		if (level.Format != TextureFormat::ARGB) { return SampleEachLane<Lanes, SampleBilinear>(level, u, v, mask); }
+
+		Int texelU = Lanes::ToIntTruncate(Lanes::Mul(u, Lanes::Set(level.ScaleU * FILTER_WEIGHT_ONE)));
+		Int texelV = Lanes::ToIntTruncate(Lanes::Mul(v, Lanes::Set(level.ScaleV * FILTER_WEIGHT_ONE)));
+
+		Int one = Lanes::SetInt(1);
+		Int widthMask = Lanes::SetInt(level.WidthMask);
+		Int heightMask = Lanes::SetInt(level.HeightMask);
+
+		Int left = GetTexelIndexXBlock<Lanes>(level, Lanes::And(Lanes::ShiftRight(texelU, FILTER_WEIGHT_BITS), widthMask));
+		Int right = GetTexelIndexXBlock<Lanes>(level, Lanes::And(Lanes::AddInt(Lanes::ShiftRight(texelU, FILTER_WEIGHT_BITS), one), widthMask));
+		Int top = GetTexelIndexYBlock<Lanes>(level, Lanes::And(Lanes::ShiftRight(texelV, FILTER_WEIGHT_BITS), heightMask));
+		Int bottom = GetTexelIndexYBlock<Lanes>(level, Lanes::And(Lanes::AddInt(Lanes::ShiftRight(texelV, FILTER_WEIGHT_BITS), one), heightMask));
+
+		Int weightMask = Lanes::SetInt(FILTER_WEIGHT_ONE - 1);
+		Int uWeight = Lanes::And(texelU, weightMask);
+		Int vWeight = Lanes::And(texelV, weightMask);
+
+		Int color1 = LerpTexelsBlock<Lanes>(Lanes::MaskGather(level.Pixels, Lanes::Or(top, left), mask), Lanes::MaskGather(level.Pixels, Lanes::Or(top, right), mask), uWeight);
+		Int color2 = LerpTexelsBlock<Lanes>(Lanes::MaskGather(level.Pixels, Lanes::Or(bottom, left), mask), Lanes::MaskGather(level.Pixels, Lanes::Or(bottom, right), mask), uWeight);
+
+		return Lanes::Or(LerpTexelsBlock<Lanes>(color1, color2, vWeight), Lanes::SetInt(static_cast<int>(ALPHA_CHANNEL)));
+	}
+
+	/* Sampler::SampleTrilinear of every lane in mask, ratio is per lane. The lanes outside of mask are undefined */
+	template<class Lanes>
+	inline static typename Lanes::Int SampleTrilinearBlock(const MipLevel& level1, const MipLevel& level2, typename Lanes::Float u, typename Lanes::Float v, typename Lanes::Float ratio, int mask)
+	{
+		typedef typename Lanes::Int Int;
+
+		// A weight of 0 blends in nothing of level2, the same texel the scalar path gets by skipping it
+		Int weight = Lanes::ToIntTruncate(Lanes::Mul(ratio, Lanes::Set(static_cast<float>(FILTER_WEIGHT_ONE))));
+		Int color = LerpTexelsBlock<Lanes>(SampleBilinearBlock<Lanes>(level1, u, v, mask), SampleBilinearBlock<Lanes>(level2, u, v, mask), weight);
+
+		return Lanes::Or(color, Lanes::SetInt(static_cast<int>(ALPHA_CHANNEL)));
+	}
+
+private:
+	/* start + (end - start) * weight / FILTER_WEIGHT_ONE for all 4 channels at once, rounded.
+	*  Red / blue and alpha / green are multiplied as two pairs of 16 bit fields, a channel times a weight never carries out of its field
+	*/
+	inline static unsigned int LerpTexels(unsigned int start, unsigned int end, unsigned int weight)
+	{
+		unsigned int inverse = FILTER_WEIGHT_ONE - weight;
+
+		unsigned int redBlue = (((start & 0x00FF00FF) * inverse + (end & 0x00FF00FF) * weight + 0x00800080) >> FILTER_WEIGHT_BITS) & 0x00FF00FF;
+		unsigned int alphaGreen = (((start >> 8) & 0x00FF00FF) * inverse + ((end >> 8) & 0x00FF00FF) * weight + 0x00800080) & 0xFF00FF00;
+
+		return redBlue | alphaGreen;
+	}
+
+	/* Compressed levels' texel indices shifted down by this are block indices */
+	static const unsigned int BLOCK_INDEX_SHIFT = BlockCompression::BLOCK_BITS * 2;
+
+	/* The decoded texels of the block texel index is in, of a compressed level */
+	inline static const unsigned int* GetBlockTexels(const MipLevel& level, unsigned int index)
+	{
+		unsigned int block = index >> BLOCK_INDEX_SHIFT;
+
+		DecodedBlockCache& cache = DecodedBlockCache::GetThreadCache();
+		if (level.Format == TextureFormat::BC3)
+		{
+			return cache.GetTexels(TextureFormat::BC3, level.Blocks[block * 2 + 1], level.Blocks[block * 2]);
+		}
+		return cache.GetTexels(TextureFormat::BC1, level.Blocks[block], 0);
+	}
+
+	/* The texel at index, decoding its block when the level is compressed */
+	inline static unsigned int FetchTexel(const MipLevel& level, unsigned int index)
+	{
+		if (level.Format == TextureFormat::ARGB) { return level.Pixels[index]; }
+		return GetBlockTexels(level, index)[index & (BlockCompression::BLOCK_TEXELS - 1)];
+	}
+
+	/* Sample of every lane in mask, the lanes outside of it are 0. Compressed levels are sampled this way, by the scalar
+	*  samplers, so each lane decodes its block once; the scalar and block samplers compute the same texels either way
+	*/
+	template<class Lanes, unsigned int (*Sample)(const MipLevel&, float, float)>
+	inline static typename Lanes::Int SampleEachLane(const MipLevel& level, typename Lanes::Float u, typename Lanes::Float v, int mask)
+	{
+		float laneU[Lanes::Width];
+		float laneV[Lanes::Width];
+		unsigned int texels[Lanes::Width] = {};
+		Lanes::Store(laneU, u);
+		Lanes::Store(laneV, v);
+		for (int i = 0; i < Lanes::Width; i++)
+		{
+			if (mask & (1 << i)) { texels[i] = Sample(level, laneU[i], laneV[i]); }
+		}
+		return Lanes::LoadInt(texels);
+	}
+
+	/* MipLevel::GetTexelIndexX / GetTexelIndexY for every lane */
+	template<class Lanes>
+	inline static typename Lanes::Int GetTexelIndexXBlock(const MipLevel& level, typename Lanes::Int x)
+	{
+		return Lanes::Or(Lanes::ShiftLeft(Lanes::ShiftRight(x, level.TileBits), level.TileShift), Lanes::And(x, Lanes::SetInt(level.TileMask)));
+	}
+
+	template<class Lanes>
+	inline static typename Lanes::Int GetTexelIndexYBlock(const MipLevel& level, typename Lanes::Int y)
+	{
+		return Lanes::Or(Lanes::ShiftLeft(Lanes::ShiftRight(y, level.TileBits), level.RowShift), Lanes::ShiftLeft(Lanes::And(y, Lanes::SetInt(level.TileMask)), level.TileBits));
+	}
+
+	/* LerpTexels for every lane, weight is 0 - FILTER_WEIGHT_ONE per lane */
+	template<class Lanes>
+	inline static typename Lanes::Int LerpTexelsBlock(typename Lanes::Int start, typename Lanes::Int end, typename Lanes::Int weight)
+	{
+		typedef typename Lanes::Int Int;
+
+		// The weight in both 16 bit halves, so each pair of fields is scaled by one Mul16
+		Int weights = Lanes::Or(weight, Lanes::ShiftLeft(weight, 16));
+		Int inverses = Lanes::SubInt(Lanes::SetInt(static_cast<int>(FILTER_WEIGHT_ONE | FILTER_WEIGHT_ONE << 16)), weights);
+
+		Int fieldMask = Lanes::SetInt(0x00FF00FF);
+		Int rounding = Lanes::SetInt(0x00800080);
+
+		Int redBlue = Lanes::AddInt(Lanes::AddInt(Lanes::Mul16(Lanes::And(start, fieldMask), inverses), Lanes::Mul16(Lanes::And(end, fieldMask), weights)), rounding);
+		Int alphaGreen = Lanes::AddInt(Lanes::AddInt(Lanes::Mul16(Lanes::And(Lanes::ShiftRight(start, 8), fieldMask), inverses),
+			Lanes::Mul16(Lanes::And(Lanes::ShiftRight(end, 8), fieldMask), weights)), rounding);
+
+		return Lanes::Or(Lanes::And(Lanes::ShiftRight(redBlue, FILTER_WEIGHT_BITS), fieldMask), Lanes::And(alphaGreen, Lanes::SetInt(static_cast<int>(0xFF00FF00))));
+	}
+};
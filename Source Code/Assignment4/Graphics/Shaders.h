@@ -1,147 +1,228 @@
 #pragma once
 
 #include "Math/Math.h"
-#include <vector>
+#include "RenderContext.h"
+#include "Graphics/VertexBuffer.h"
 
-enum class TextureFilter
+/* Shaders read their constants from the context they are run with, pixel shaders get their interpolated inputs passed in.
+*  Nothing here is global, so any number of contexts can run the same shaders at once
+*/
+
+void VS_World(const RenderContext& context, Vertex& vertex)
 {
-	NEAREST,
-	BILINEAR,
-	TRILINEAR
-};
+	Math::MultiplyVertexByMatrix(vertex, context.WorldMatrix);
+	Math::MultiplyVertexByMatrix(vertex, context.ViewMatrix);
+	Math::MultiplyVertexByMatrix(vertex, context.ProjectionMatrix);
 
-// Vertex Shader
-void (*VERTEX_SHADER)(Vertex&) = 0;
+	float lightRatio = Math::Clamp(0.0f, 1.0f, Vector3D::DotProduct(-context.DirectionLightDirection, vertex.Normal));
+	vertex.Color = Math::LerpColor(0, context.DirectionalLightColor, lightRatio);
 
-// Pixel Shader
-void (*PIXEL_SHADER)(unsigned int&) = 0;
+	/* Point light */
+	Vector3D lightSurfaceDisplacement = context.PointLightPosition - Vector3D(vertex.X, vertex.Y, vertex.Z);
+	lightRatio = Math::Clamp(0.0f, 1.0f, Vector3D::DotProduct(lightSurfaceDisplacement, vertex.Normal));
+	lightRatio = Math::Clamp(0.0f, 1.0f, lightRatio + context.AmbientTerm);
+	float attenuation = 1.0f - Math::Clamp(0.0f, 1.0f, lightSurfaceDisplacement.Length() / context.PointLightRadius);
+	vertex.Color = Math::LerpColor(vertex.Color, context.PointLightColor, attenuation * lightRatio);
+}
 
-// Shader variables 'SV_'
-Matrix4D SV_WorldMatrix;
-Matrix4D SV_ViewMatrix;
-Matrix4D SV_ProjectionMatrix;
+#if SIMD_SSE2_AVAILABLE
+/* Math::LerpColor of Lanes::Width colors at once */
+template<class Lanes>
+inline typename Lanes::Int LerpColorLanes(typename Lanes::Int startColor, typename Lanes::Int endColor, typename Lanes::Float ratio)
+{
+	typename Lanes::Int channelMask = Lanes::SetInt(0xFF);
+	typename Lanes::Int color = Lanes::SetInt(static_cast<int>(ALPHA_CHANNEL));
 
-Texture SV_Texture;
-unsigned int SV_MaxMipMapLevel;
-unsigned int SV_MipMapLevel;
+	for (int shift = 0; shift <= 16; shift += 8)
+	{
+		typename Lanes::Float start = Lanes::ToFloat(Lanes::And(Lanes::ShiftRight(startColor, shift), channelMask));
+		typename Lanes::Float end = Lanes::ToFloat(Lanes::And(Lanes::ShiftRight(endColor, shift), channelMask));
 
-float SV_TexCoordU;
-float SV_TexCoordV;
+		typename Lanes::Int channel = Lanes::ToIntTruncate(Lanes::MulAdd(Lanes::Sub(end, start), ratio, start));
+		color = Lanes::Or(color, Lanes::ShiftLeft(channel, shift));
+	}
 
-TextureFilter SV_TextureFilter;
+	return color;
+}
 
-/* To Be Changed */
-float SV_NearPlane;
-float SV_FarPlane;
+/* VS_World over a whole structure of arrays vertex buffer, Lanes::Width vertices per iteration, written to output[0] ... output[Count - 1].
+*  World, view and projection are concatenated once per batch so every vertex costs a single matrix multiply,
+*  the lighting matches VS_World lane for lane
+*/
+template<class Lanes>
+void VS_WorldBatch(const RenderContext& context, const VertexBuffer& input, Vertex* output)
+{
+	typedef typename Lanes::Float Float;
+	typedef typename Lanes::Int Int;
 
-/* Lighting */
-Vector3D SV_DirectionLightDirection;
-unsigned int SV_DirectionalLightColor;
+	Matrix4D worldViewProjection = context.WorldMatrix * context.ViewMatrix * context.ProjectionMatrix;
 
-Vector3D SV_PointLightPosition;
-unsigned int SV_PointLightColor;
-float SV_PointLightRadius;
+	Float matrix[4][4];
+	for (int row = 0; row < 4; row++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			matrix[row][column] = Lanes::Set(worldViewProjection(row, column));
+		}
+	}
 
-float SV_AmbientTerm;
+	Float zero = Lanes::Set(0.0f);
+	Float one = Lanes::Set(1.0f);
 
-std::vector<Texture*> Textures;
+	Float lightDirectionX = Lanes::Set(-context.DirectionLightDirection.X);
+	Float lightDirectionY = Lanes::Set(-context.DirectionLightDirection.Y);
+	Float lightDirectionZ = Lanes::Set(-context.DirectionLightDirection.Z);
+	Int directionalLightColor = Lanes::SetInt(static_cast<int>(context.DirectionalLightColor));
 
-void VS_World(Vertex& vertex)
-{
-	Math::MultiplyVertexByMatrix(vertex, SV_WorldMatrix);
-	Math::MultiplyVertexByMatrix(vertex, SV_ViewMatrix);
-	Math::MultiplyVertexByMatrix(vertex, SV_ProjectionMatrix);
+	Float pointLightX = Lanes::Set(context.PointLightPosition.X);
+	Float pointLightY = Lanes::Set(context.PointLightPosition.Y);
+	Float pointLightZ = Lanes::Set(context.PointLightPosition.Z);
+	Float pointLightRadius = Lanes::Set(context.PointLightRadius);
+	Int pointLightColor = Lanes::SetInt(static_cast<int>(context.PointLightColor));
 
-	float lightRatio = Math::Clamp(0.0f, 1.0f, Vector3D::DotProduct(-SV_DirectionLightDirection, vertex.Normal));
-	vertex.Color = Math::LerpColor(0, SV_DirectionalLightColor, lightRatio);
+	Float ambientTerm = Lanes::Set(context.AmbientTerm);
 
-	/* Point light */
-	Vector3D lightSurfaceDisplacement = SV_PointLightPosition - Vector3D(vertex.X, vertex.Y, vertex.Z);
-	lightRatio = Math::Clamp(0.0f, 1.0f, Vector3D::DotProduct(lightSurfaceDisplacement, vertex.Normal));
-	lightRatio = Math::Clamp(0.0f, 1.0f, lightRatio + SV_AmbientTerm);
-	float attenuation = 1.0f - Math::Clamp(0.0f, 1.0f, lightSurfaceDisplacement.Length() / SV_PointLightRadius);
-	vertex.Color = Math::LerpColor(vertex.Color, SV_PointLightColor, attenuation * lightRatio);
+	for (unsigned int first = 0; first < input.Count; first += Lanes::Width)
+	{
+		Float x = Lanes::Load(&input.X[first]);
+		Float y = Lanes::Load(&input.Y[first]);
+		Float z = Lanes::Load(&input.Z[first]);
+		Float w = Lanes::Load(&input.W[first]);
+
+		Float clipX = Lanes::MulAdd(x, matrix[0][0], Lanes::MulAdd(y, matrix[1][0], Lanes::MulAdd(z, matrix[2][0], Lanes::Mul(w, matrix[3][0]))));
+		Float clipY = Lanes::MulAdd(x, matrix[0][1], Lanes::MulAdd(y, matrix[1][1], Lanes::MulAdd(z, matrix[2][1], Lanes::Mul(w, matrix[3][1]))));
+		Float clipZ = Lanes::MulAdd(x, matrix[0][2], Lanes::MulAdd(y, matrix[1][2], Lanes::MulAdd(z, matrix[2][2], Lanes::Mul(w, matrix[3][2]))));
+		Float clipW = Lanes::MulAdd(x, matrix[0][3], Lanes::MulAdd(y, matrix[1][3], Lanes::MulAdd(z, matrix[2][3], Lanes::Mul(w, matrix[3][3]))));
+
+		Float normalX = Lanes::Load(&input.NormalX[first]);
+		Float normalY = Lanes::Load(&input.NormalY[first]);
+		Float normalZ = Lanes::Load(&input.NormalZ[first]);
+
+		/* Directional light */
+		Float lightRatio = Lanes::MulAdd(lightDirectionX, normalX, Lanes::MulAdd(lightDirectionY, normalY, Lanes::Mul(lightDirectionZ, normalZ)));
+		lightRatio = Lanes::Min(one, Lanes::Max(zero, lightRatio));
+		Int color = LerpColorLanes<Lanes>(Lanes::SetInt(0), directionalLightColor, lightRatio);
+
+		/* Point light */
+		Float displacementX = Lanes::Sub(pointLightX, clipX);
+		Float displacementY = Lanes::Sub(pointLightY, clipY);
+		Float displacementZ = Lanes::Sub(pointLightZ, clipZ);
+
+		lightRatio = Lanes::MulAdd(displacementX, normalX, Lanes::MulAdd(displacementY, normalY, Lanes::Mul(displacementZ, normalZ)));
+		lightRatio = Lanes::Min(one, Lanes::Max(zero, lightRatio));
+		lightRatio = Lanes::Min(one, Lanes::Max(zero, Lanes::Add(lightRatio, ambientTerm)));
+
+		Float distance = Lanes::Sqrt(Lanes::MulAdd(displacementX, displacementX, Lanes::MulAdd(displacementY, displacementY, Lanes::Mul(displacementZ, displacementZ))));
+		Float attenuation = Lanes::Sub(one, Lanes::Min(one, Lanes::Max(zero, Lanes::Div(distance, pointLightRadius))));
+		color = LerpColorLanes<Lanes>(color, pointLightColor, Lanes::Mul(attenuation, lightRatio));
+
+		// Primitive assembly works on whole vertices, write the lanes back out one vertex each
+		alignas(32) float outX[Lanes::Width];
+		alignas(32) float outY[Lanes::Width];
+		alignas(32) float outZ[Lanes::Width];
+		alignas(32) float outW[Lanes::Width];
+		alignas(32) unsigned int outColor[Lanes::Width];
+
+		Lanes::Store(outX, clipX);
+		Lanes::Store(outY, clipY);
+		Lanes::Store(outZ, clipZ);
+		Lanes::Store(outW, clipW);
+		Lanes::StoreInt(outColor, color);
+
+		unsigned int laneCount = Math::Min(static_cast<unsigned int>(Lanes::Width), input.Count - first);
+		for (unsigned int lane = 0; lane < laneCount; lane++)
+		{
+			unsigned int i = first + lane;
+			Vertex& vertex = output[i];
+
+			vertex.X = outX[lane];
+			vertex.Y = outY[lane];
+			vertex.Z = outZ[lane];
+			vertex.W = outW[lane];
+
+			vertex.Normal = Vector3D(input.NormalX[i], input.NormalY[i], input.NormalZ[i]);
+			vertex.TexCoordU = input.TexCoordU[i];
+			vertex.TexCoordV = input.TexCoordV[i];
+			vertex.Color = outColor[lane];
+		}
+	}
+}
+
+#if SIMD_AVX2_AVAILABLE
+/* VS_WorldBatch<AVX2Lanes>, compiled for AVX2 */
+SIMD_AVX2_ENTRY void VS_WorldBatchAVX2(const RenderContext& context, const VertexBuffer& input, Vertex* output)
+{
+	VS_WorldBatch<AVX2Lanes>(context, input, output);
 }
+#endif
+#endif // SIMD_SSE2_AVAILABLE
 
-void PS_RedColor(unsigned int& pixel)
+void PS_RedColor(const RenderContext& context, const PixelShaderInput& input, unsigned int& pixel)
 {
 	pixel = RED;
 }
 
-void PS_GreenColor(unsigned int& pixel)
+void PS_GreenColor(const RenderContext& context, const PixelShaderInput& input, unsigned int& pixel)
 {
 	pixel = GREEN;
 }
 
-void PS_WhiteColor(unsigned int& pixel)
+void PS_WhiteColor(const RenderContext& context, const PixelShaderInput& input, unsigned int& pixel)
 {
 	pixel = 0xffffffff;
 }
 
-void PS_BlueColor(unsigned int& pixel)
+void PS_BlueColor(const RenderContext& context, const PixelShaderInput& input, unsigned int& pixel)
 {
 	pixel = BLUE;
 }
 
-void PS_NoColor(unsigned int& pixel) { }
+void PS_NoColor(const RenderContext& context, const PixelShaderInput& input, unsigned int& pixel) { }
 
-void PS_Texture(unsigned int& pixel)
+/* Texture lookup with the filter fixed at compile time, see PS_Texture */
+template<TextureFilter Filter>
+void PS_TextureFiltered(const RenderContext& context, const PixelShaderInput& input, unsigned int& pixel)
 {
-	SV_Texture = *Textures[static_cast<unsigned int>(SV_MipMapLevel)];
-
-	float uRatio = SV_TexCoordU * SV_Texture.Width;
-	float vRatio = SV_TexCoordV * SV_Texture.Height;
-
-	int x = static_cast<int>(uRatio);
-	int y = static_cast<int>(vRatio);
-
-	unsigned int currentTexel = Math::Convert2DTo1D(x, y, SV_Texture.Width);
-	pixel = (SV_Texture.Pixels[currentTexel]);
+	switch (Filter)
+	{
 
-	switch (SV_TextureFilter)
+	case TextureFilter::NEAREST:
 	{
+		const MipLevel& level = context.TextureSampler.GetLevel(Sampler::GetNearestLevel(input.MipMapLod));
+		pixel = Sampler::SampleNearest(level, input.TexCoordU, input.TexCoordV);
+		break;
+	}
 
 	case TextureFilter::BILINEAR:
 	{
-		uRatio -= x;
-		vRatio -= y;
-
-		pixel = Math::CalculateBilinearTextureFilter(uRatio, vRatio, currentTexel, SV_Texture);
+		const MipLevel& level = context.TextureSampler.GetLevel(Sampler::GetNearestLevel(input.MipMapLod));
+		pixel = Sampler::SampleBilinear(level, input.TexCoordU, input.TexCoordV);
 		break;
 	}
 
 	case TextureFilter::TRILINEAR:
 	{
-		// Bi-Linear
-		uRatio -= x;
-		vRatio -= y;
-
-		unsigned int color1 = Math::CalculateBilinearTextureFilter(uRatio, vRatio, currentTexel, SV_Texture);
-
-		// Trilinear 
-		unsigned int mipMapLevelCeil = static_cast<unsigned int>(ceil(SV_MipMapLevel));
-		mipMapLevelCeil = mipMapLevelCeil > SV_MaxMipMapLevel ? SV_MaxMipMapLevel : mipMapLevelCeil;
-
-		float mipMapLevelCeilRatio = static_cast<float>(mipMapLevelCeil - SV_MipMapLevel);
-		Texture& trilinearTexture = *Textures[mipMapLevelCeil];
+		// The levels either side of the lod, blended by its fraction
+		unsigned int level = static_cast<unsigned int>(input.MipMapLod);
+		unsigned int nextLevel = level < context.TextureSampler.MaxLevel ? level + 1 : context.TextureSampler.MaxLevel;
 
-		uRatio = SV_TexCoordU * trilinearTexture.Width;
-		vRatio = SV_TexCoordV * trilinearTexture.Height;
-
-		x = static_cast<int>(uRatio);
-		y = static_cast<int>(vRatio);
-
-		currentTexel = Math::Convert2DTo1D(x, y, trilinearTexture.Width);
-		pixel = (trilinearTexture.Pixels[currentTexel]);
-
-		uRatio -= x;
-		vRatio -= y;
-		
-		unsigned int color2 = Math::CalculateBilinearTextureFilter(uRatio, vRatio, currentTexel, trilinearTexture);
-
-		pixel = Math::LerpColor(color1, color2, mipMapLevelCeilRatio);
+		pixel = Sampler::SampleTrilinear(context.TextureSampler.GetLevel(level), context.TextureSampler.GetLevel(nextLevel),
+			input.TexCoordU, input.TexCoordV, input.MipMapLod - static_cast<float>(level));
 		break;
 	}
 
+	}
+}
+
+/* Samples the bound texture with the context's SamplerFilter. The rasterizer's pipelines look for this shader
+*  and call the PS_TextureFiltered variant of the current filter directly instead
+*/
+void PS_Texture(const RenderContext& context, const PixelShaderInput& input, unsigned int& pixel)
+{
+	switch (context.SamplerFilter)
+	{
+	case TextureFilter::NEAREST: PS_TextureFiltered<TextureFilter::NEAREST>(context, input, pixel); break;
+	case TextureFilter::BILINEAR: PS_TextureFiltered<TextureFilter::BILINEAR>(context, input, pixel); break;
+	case TextureFilter::TRILINEAR: PS_TextureFiltered<TextureFilter::TRILINEAR>(context, input, pixel); break;
 	}
 }
\ No newline at end of file
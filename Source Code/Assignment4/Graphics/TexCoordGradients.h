@@ -0,0 +1,128 @@
+#pragma once
+#include "Graphics/Texel.h"
+#include "Graphics/Sampler.h"
+#include "Math/EdgeFunction.h"
+#include <cstring>
+
+/* Screen space gradients of a triangle's perspective divided texture coordinates. u / w, v / w and 1 / w are linear
+*  across the screen, so they can be evaluated at any pixel, even one outside of the triangle.
+*
+*  The mip level of a pixel comes from its 2x2 quad (the pixels at even x, y and the ones right of and below them):
+*  the texture coordinates at the quad's top left, top right and bottom left pixels give how many texels one pixel step covers.
+*  Every pixel of a quad gets the same level, whichever fill path draws it and in whatever order
+*/
+struct TexCoordGradients
+{
+	/* Steps of u / w, v / w and 1 / w per pixel in x and y */
+	float UdX, UdY;
+	float VdX, VdY;
+	float RecipWdX, RecipWdY;
+
+	/* Size of mip level 0, texture coordinate steps are scaled by it to texel steps */
+	float ScaleU;
+	float ScaleV;
+
+	float MaxLod;
+
+public:
+	inline TexCoordGradients(const Texel& a, const Texel& b, const Texel& c, const TriangleEdges& edges, const Sampler& sampler)
+	{
+		float areaReciprocal = 1.0f / static_cast<float>(edges.Area);
+		Vector3D recipW((1.0f / a.W), (1.0f / b.W), (1.0f / c.W));
+
+		// The barycentric weights step by their edge's A in x and B in y, over the area
+		Vector3D weightdX(edges.BC.A * areaReciprocal, edges.CA.A * areaReciprocal, edges.AB.A * areaReciprocal);
+		Vector3D weightdY(edges.BC.B * areaReciprocal, edges.CA.B * areaReciprocal, edges.AB.B * areaReciprocal);
+
+		UdX = Math::Berp(a.TexCoordU * recipW.X, b.TexCoordU * recipW.Y, c.TexCoordU * recipW.Z, weightdX);
+		UdY = Math::Berp(a.TexCoordU * recipW.X, b.TexCoordU * recipW.Y, c.TexCoordU * recipW.Z, weightdY);
+		VdX = Math::Berp(a.TexCoordV * recipW.X, b.TexCoordV * recipW.Y, c.TexCoordV * recipW.Z, weightdX);
+		VdY = Math::Berp(a.TexCoordV * recipW.X, b.TexCoordV * recipW.Y, c.TexCoordV * recipW.Z, weightdY);
+		RecipWdX = Math::Berp(recipW.X, recipW.Y, recipW.Z, weightdX);
+		RecipWdY = Math::Berp(recipW.X, recipW.Y, recipW.Z, weightdY);
+
+		ScaleU = sampler.Levels ? sampler.GetLevel(0).ScaleU : 0.0f;
+		ScaleV = sampler.Levels ? sampler.GetLevel(0).ScaleV : 0.0f;
+		MaxLod = static_cast<float>(sampler.MaxLevel);
+	}
+
+	/* Mip level, with its fraction, of the pixel at x, y given its u / w, v / w and 1 / w. 0 - MaxLod */
+	inline float GetLod(float uOverW, float vOverW, float recipW, int x, int y) const
+	{
+		// Back to the quad's top left pixel
+		float quadX = static_cast<float>(x & 1);
+		float quadY = static_cast<float>(y & 1);
+
+		float u = uOverW - quadX * UdX - quadY * UdY;
+		float v = vOverW - quadX * VdX - quadY * VdY;
+		float r = recipW - quadX * RecipWdX - quadY * RecipWdY;
+
+		float recip = 1.0f / r;
+		float recipRight = 1.0f / (r + RecipWdX);
+		float recipBottom = 1.0f / (r + RecipWdY);
+
+		float u0 = u * recip;
+		float v0 = v * recip;
+
+		float uStepX = ((u + UdX) * recipRight - u0) * ScaleU;
+		float vStepX = ((v + VdX) * recipRight - v0) * ScaleV;
+		float uStepY = ((u + UdY) * recipBottom - u0) * ScaleU;
+		float vStepY = ((v + VdY) * recipBottom - v0) * ScaleV;
+
+		float lengthX = uStepX * uStepX + vStepX * vStepX;
+		float lengthY = uStepY * uStepY + vStepY * vStepY;
+		float lengthSquared = lengthX > lengthY ? lengthX : lengthY;
+
+		// log2 of the longer step, half the log2 of its square
+		int bits;
+		memcpy(&bits, &lengthSquared, sizeof(bits));
+		float lod = static_cast<float>(bits) * LOG2_BITS_SCALE - LOG2_BITS_BIAS;
+
+		lod = lod > 0.0f ? lod : 0.0f;
+		return lod < MaxLod ? lod : MaxLod;
+	}
+
+	/* GetLod of the Lanes::Width pixels starting at x, y, to the bit */
+	template<class Lanes>
+	inline typename Lanes::Float GetLodBlock(typename Lanes::Float uOverW, typename Lanes::Float vOverW, typename Lanes::Float recipW, int x, int y) const
+	{
+		typedef typename Lanes::Float Float;
+
+		Float quadX = Lanes::ToFloat(Lanes::And(Lanes::SetIntSequence(x, 1), Lanes::SetInt(1)));
+		Float quadY = Lanes::Set(static_cast<float>(y & 1));
+
+		Float u = Lanes::Sub(Lanes::Sub(uOverW, Lanes::Mul(quadX, Lanes::Set(UdX))), Lanes::Mul(quadY, Lanes::Set(UdY)));
+		Float v = Lanes::Sub(Lanes::Sub(vOverW, Lanes::Mul(quadX, Lanes::Set(VdX))), Lanes::Mul(quadY, Lanes::Set(VdY)));
+		Float r = Lanes::Sub(Lanes::Sub(recipW, Lanes::Mul(quadX, Lanes::Set(RecipWdX))), Lanes::Mul(quadY, Lanes::Set(RecipWdY)));
+
+		Float one = Lanes::Set(1.0f);
+		Float recip = Lanes::Div(one, r);
+		Float recipRight = Lanes::Div(one, Lanes::Add(r, Lanes::Set(RecipWdX)));
+		Float recipBottom = Lanes::Div(one, Lanes::Add(r, Lanes::Set(RecipWdY)));
+
+		Float u0 = Lanes::Mul(u, recip);
+		Float v0 = Lanes::Mul(v, recip);
+
+		Float scaleU = Lanes::Set(ScaleU);
+		Float scaleV = Lanes::Set(ScaleV);
+		Float uStepX = Lanes::Mul(Lanes::Sub(Lanes::Mul(Lanes::Add(u, Lanes::Set(UdX)), recipRight), u0), scaleU);
+		Float vStepX = Lanes::Mul(Lanes::Sub(Lanes::Mul(Lanes::Add(v, Lanes::Set(VdX)), recipRight), v0), scaleV);
+		Float uStepY = Lanes::Mul(Lanes::Sub(Lanes::Mul(Lanes::Add(u, Lanes::Set(UdY)), recipBottom), u0), scaleU);
+		Float vStepY = Lanes::Mul(Lanes::Sub(Lanes::Mul(Lanes::Add(v, Lanes::Set(VdY)), recipBottom), v0), scaleV);
+
+		Float lengthX = Lanes::Add(Lanes::Mul(uStepX, uStepX), Lanes::Mul(vStepX, vStepX));
+		Float lengthY = Lanes::Add(Lanes::Mul(uStepY, uStepY), Lanes::Mul(vStepY, vStepY));
+		Float lengthSquared = Lanes::Max(lengthX, lengthY);
+
+		Float lod = Lanes::Sub(Lanes::Mul(Lanes::ToFloat(Lanes::AsInt(lengthSquared)), Lanes::Set(LOG2_BITS_SCALE)), Lanes::Set(LOG2_BITS_BIAS));
+
+		return Lanes::Min(Lanes::Max(lod, Lanes::Set(0.0f)), Lanes::Set(MaxLod));
+	}
+
+private:
+	/* The bits of a positive float read as an int, times 2^-23, minus 127 are its log2 with the mantissa taken as linear.
+	*  Halved here, as the lod is the log2 of a length computed squared
+	*/
+	static constexpr float LOG2_BITS_SCALE = 1.0f / 16777216.0f;
+	static constexpr float LOG2_BITS_BIAS = 63.5f;
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include "Vertex.h"
+#include <vector>
+
+/* Structure of arrays copy of a mesh's vertices, every attribute component is its own contiguous stream
+*  so the batched vertex stage can load Lanes::Width vertices of it with one instruction.
+*  Streams are padded with zeros up to a multiple of MAX_LANES, the last batch never reads past the end
+*/
+struct VertexBuffer
+{
+public:
+	/* Widest SIMD batch the streams are padded for */
+	static const unsigned int MAX_LANES = 8;
+
+	std::vector<float> X;
+	std::vector<float> Y;
+	std::vector<float> Z;
+	std::vector<float> W;
+
+	std::vector<float> NormalX;
+	std::vector<float> NormalY;
+	std::vector<float> NormalZ;
+
+	std::vector<float> TexCoordU;
+	std::vector<float> TexCoordV;
+
+	std::vector<unsigned int> Colors;
+
+	unsigned int Count;
+
+public:
+	inline VertexBuffer()
+		: Count(0) { }
+
+public:
+	/* Replaces the contents with a copy of vertices[0] ... vertices[count - 1] */
+	inline void Assign(const Vertex* vertices, unsigned int count);
+
+	/* Reassembles vertex i */
+	inline Vertex GetVertex(unsigned int i) const;
+};
+
+inline void VertexBuffer::Assign(const Vertex* vertices, unsigned int count)
+{
+	Count = count;
+
+	unsigned int paddedCount = (count + MAX_LANES - 1) / MAX_LANES * MAX_LANES;
+	std::vector<float>* streams[] = { &X, &Y, &Z, &W, &NormalX, &NormalY, &NormalZ, &TexCoordU, &TexCoordV };
+	for (std::vector<float>* stream : streams)
+	{
+		stream->assign(paddedCount, 0.0f);
+	}
+	Colors.assign(paddedCount, 0);
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const Vertex& vertex = vertices[i];
+
+		X[i] = vertex.X;
+		Y[i] = vertex.Y;
+		Z[i] = vertex.Z;
+		W[i] = vertex.W;
+
+		NormalX[i] = vertex.Normal.X;
+		NormalY[i] = vertex.Normal.Y;
+		NormalZ[i] = vertex.Normal.Z;
+
+		TexCoordU[i] = vertex.TexCoordU;
+		TexCoordV[i] = vertex.TexCoordV;
+
+		Colors[i] = vertex.Color;
+	}
+}
+
+inline Vertex VertexBuffer::GetVertex(unsigned int i) const
+{
+	Vertex vertex(X[i], Y[i], Z[i], W[i], TexCoordU[i], TexCoordV[i], Colors[i]);
+	vertex.Normal = Vector3D(NormalX[i], NormalY[i], NormalZ[i]);
+	return vertex;
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include <set>
+#include <utility>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+
+/* Key presses by simulation step, so a flight through the scene can be recorded once and replayed exactly.
+*  The simulation advances in fixed steps, so the same presses at the same steps always give the same camera and scene.
+*
+*  The file is text, '#' starts a comment:
+*    steps <simulation steps the path lasts>
+*    <first step> <steps> <key>    the key is pressed on every one of the steps, starting at first step
+*  Keys are named after their virtual key: A - Z, 0 - 9, TAB, LEFT, UP, RIGHT, DOWN, anything else as hex (0x70)
+*/
+class InputPath
+{
+private:
+	/* (step, virtual key) of every press, in step order */
+	std::set<std::pair<unsigned long long, int>> mPresses;
+	unsigned long long mStepCount;
+
+public:
+	InputPath()
+		: mStepCount(0) { }
+
+public:
+	unsigned long long GetStepCount() const { return mStepCount; }
+
+	void SetStepCount(unsigned long long stepCount) { mStepCount = stepCount; }
+
+	bool WasKeyPressed(unsigned long long step, int virtualKey) const
+	{
+		return mPresses.count(std::make_pair(step, virtualKey)) != 0;
+	}
+
+	void AddKeyPress(unsigned long long step, int virtualKey)
+	{
+		mPresses.insert(std::make_pair(step, virtualKey));
+		if (step >= mStepCount) { mStepCount = step + 1; }
+	}
+
+	/* Replaces the presses with the file's, false with a message in error if it could not be read or parsed */
+	bool Load(const char* path, std::string& error)
+	{
+		std::ifstream file(path);
+		if (!file)
+		{
+			error = std::string("could not open ") + path;
+			return false;
+		}
+
+		mPresses.clear();
+		mStepCount = 0;
+
+		std::string line;
+		for (unsigned int lineNumber = 1; std::getline(file, line); lineNumber++)
+		{
+			size_t comment = line.find('#');
+			if (comment != std::string::npos) { line.erase(comment); }
+
+			std::istringstream fields(line);
+			std::string first;
+			if (!(fields >> first)) { continue; }
+
+			if (first == "steps")
+			{
+				if (!(fields >> mStepCount))
+				{
+					error = std::string(path) + ":" + std::to_string(lineNumber) + ": expected the step count";
+					return false;
+				}
+				continue;
+			}
+
+			unsigned long long steps = 0;
+			std::string keyName;
+			int virtualKey = -1;
+			char* end = nullptr;
+			unsigned long long firstStep = strtoull(first.c_str(), &end, 10);
+			if (*end != '\0' || !(fields >> steps >> keyName) || (virtualKey = GetVirtualKey(keyName)) < 0)
+			{
+				error = std::string(path) + ":" + std::to_string(lineNumber) + ": expected <first step> <steps> <key>";
+				return false;
+			}
+
+			for (unsigned long long step = firstStep; step < firstStep + steps; step++)
+			{
+				AddKeyPress(step, virtualKey);
+			}
+		}
+		return true;
+	}
+
+	/* Writes the presses with every run of consecutive steps of a key on one line */
+	bool Save(const char* path) const
+	{
+		std::ofstream file(path);
+		if (!file) { return false; }
+
+		file << "# Recorded input path: <first step> <steps> <key>" << std::endl;
+		file << "steps " << mStepCount << std::endl;
+
+		for (const std::pair<unsigned long long, int>& press : mPresses)
+		{
+			// Only runs start a line
+			if (press.first > 0 && WasKeyPressed(press.first - 1, press.second)) { continue; }
+
+			unsigned long long steps = 1;
+			while (WasKeyPressed(press.first + steps, press.second)) { steps++; }
+
+			file << press.first << " " << steps << " " << GetKeyName(press.second) << std::endl;
+		}
+		return static_cast<bool>(file);
+	}
+
+private:
+	static std::string GetKeyName(int virtualKey)
+	{
+		switch (virtualKey)
+		{
+		case 0x09: return "TAB";
+		case 0x25: return "LEFT";
+		case 0x26: return "UP";
+		case 0x27: return "RIGHT";
+		case 0x28: return "DOWN";
+		}
+
+		if ((virtualKey >= '0' && virtualKey <= '9') || (virtualKey >= 'A' && virtualKey <= 'Z'))
+		{
+			return std::string(1, static_cast<char>(virtualKey));
+		}
+
+		char hex[8];
+		snprintf(hex, sizeof(hex), "0x%02X", virtualKey);
+		return hex;
+	}
+
+	/* -1 for names that are not a key */
+	static int GetVirtualKey(const std::string& name)
+	{
+		if (name == "TAB") { return 0x09; }
+		if (name == "LEFT") { return 0x25; }
+		if (name == "UP") { return 0x26; }
+		if (name == "RIGHT") { return 0x27; }
+		if (name == "DOWN") { return 0x28; }
+
+		if (name.size() == 1 && ((name[0] >= '0' && name[0] <= '9') || (name[0] >= 'A' && name[0] <= 'Z')))
+		{
+			return name[0];
+		}
+
+		if (name.size() > 2 && name[0] == '0' && (name[1] == 'x' || name[1] == 'X'))
+		{
+			char* end = nullptr;
+			long virtualKey = strtol(name.c_str() + 2, &end, 16);
+			if (*end == '\0' && virtualKey > 0 && virtualKey < 0x100) { return static_cast<int>(virtualKey); }
+		}
+		return -1;
+	}
+};
@@ -1,13 +1,69 @@
 #include "Application.h"
+#if defined(_MSC_VER)
 #include <crtdbg.h>
+#endif
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
 
-int main()
+/* Usage: Assignment4 [--y4m <file | - | "|command">] [--benchmark [frames, default 600]] [--trace <file.json>]
+*                     [--replay-input <path file> | --record-input <path file>]
+*                     [--scene-benchmark <path file> [--golden <file> [--record-golden]] [--timings <file.csv>]]
+*  The scene benchmark replays the input path (e.g. Benchmarks/StoneHenge.path) under every frame mode, textured frames with every texture filter,
+*  exits with 1 if the output does not match the golden hashes or there are none at the golden path (record them with --record-golden)
+*/
+int main(int argc, char** argv)
 {
+#if defined(_MSC_VER)
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 	_CrtSetReportMode(_CRT_WARN, _CRTDBG_MODE_DEBUG);
+#endif
 
 	//_CrtSetBreakAlloc(161);
 
+	ApplicationOptions options;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--y4m") == 0 && i + 1 < argc)
+		{
+			options.VideoOutputPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+		{
+			options.TracePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--replay-input") == 0 && i + 1 < argc)
+		{
+			options.ReplayInputPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--record-input") == 0 && i + 1 < argc)
+		{
+			options.RecordInputPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--scene-benchmark") == 0 && i + 1 < argc)
+		{
+			options.SceneBenchmarkPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc)
+		{
+			options.GoldenPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--record-golden") == 0)
+		{
+			options.bRecordGolden = true;
+		}
+		else if (strcmp(argv[i], "--timings") == 0 && i + 1 < argc)
+		{
+			options.TimingsPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--benchmark") == 0)
+		{
+			bool bFramesGiven = i + 1 < argc && isdigit(static_cast<unsigned char>(argv[i + 1][0]));
+			options.BenchmarkFrames = bFramesGiven ? static_cast<unsigned int>(strtoul(argv[++i], nullptr, 10)) : 600;
+		}
+	}
+
 	Application app;
-	app.Init();
+	app.Init(options);
+	return app.GetExitCode();
 }
\ No newline at end of file
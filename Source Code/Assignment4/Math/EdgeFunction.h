@@ -0,0 +1,90 @@
+#pragma once
+#include "IntPoint2D.h"
+
+/* Half-space edge function E(p) = A * p.X + B * p.Y + C of the directed edge start -> end.
+*  Evaluates to the same value as Math::ImplicitLine(start, end, p), stepping one pixel in X adds A and one pixel in Y adds B.
+*  64 bit so triangles reaching far outside the screen can not overflow the products.
+*/
+struct EdgeFunction
+{
+public:
+	long long A;
+	long long B;
+	long long C;
+
+	/* Added to E(p) before the inside test, 0 for top or left edges and -1 for every other edge */
+	long long Bias;
+
+public:
+	inline EdgeFunction(const IntPoint2D& start, const IntPoint2D& end);
+
+public:
+	inline long long Evaluate(int x, int y) const;
+
+	/* Negates the edge so the other side of it becomes the inside */
+	inline void Flip();
+
+	/* Top-left fill rule, call once the edge faces into the triangle.
+	*  A pixel exactly on an edge is only inside when the edge is a top edge (horizontal with the triangle below it)
+	*  or a left edge, so pixels on an edge shared by two triangles are drawn exactly once.
+	*/
+	inline void SetupFillRule();
+};
+
+inline EdgeFunction::EdgeFunction(const IntPoint2D& start, const IntPoint2D& end)
+	: A(static_cast<long long>(start.Y) - end.Y), B(static_cast<long long>(end.X) - start.X),
+	C(static_cast<long long>(start.X) * end.Y - static_cast<long long>(start.Y) * end.X), Bias(0) { }
+
+inline long long EdgeFunction::Evaluate(int x, int y) const
+{
+	return A * x + B * y + C;
+}
+
+inline void EdgeFunction::Flip()
+{
+	A = -A;
+	B = -B;
+	C = -C;
+}
+
+inline void EdgeFunction::SetupFillRule()
+{
+	bool bTopEdge = (A == 0 && B > 0);
+	bool bLeftEdge = (A > 0);
+
+	Bias = (bTopEdge || bLeftEdge) ? 0 : -1;
+}
+
+/* The three edge functions of a screen space triangle, all facing into the triangle with the fill rule set up.
+*  The edge opposite a vertex gives that vertex's barycentric weight (alpha = BC, beta = CA, gamma = AB) once divided by Area.
+*/
+struct TriangleEdges
+{
+public:
+	EdgeFunction BC;
+	EdgeFunction CA;
+	EdgeFunction AB;
+
+	/* Twice the triangle's area in pixels, 0 for degenerate triangles */
+	long long Area;
+
+public:
+	inline TriangleEdges(const IntPoint2D& a, const IntPoint2D& b, const IntPoint2D& c);
+};
+
+inline TriangleEdges::TriangleEdges(const IntPoint2D& a, const IntPoint2D& b, const IntPoint2D& c)
+	: BC(b, c), CA(c, a), AB(a, b), Area(BC.Evaluate(a.X, a.Y))
+{
+	// Make every edge face into the triangle regardless of winding
+	if (Area < 0)
+	{
+		BC.Flip();
+		CA.Flip();
+		AB.Flip();
+		Area = -Area;
+	}
+
+	BC.SetupFillRule();
+	CA.SetupFillRule();
+	AB.SetupFillRule();
+}
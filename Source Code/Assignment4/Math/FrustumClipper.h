@@ -0,0 +1,171 @@
+#pragma once
+#include "Math.h"
+
+/* Sutherland-Hodgman clipping of triangles against the view frustum in homogeneous clip space,
+*  a vertex is inside when -w <= x <= w, -w <= y <= w and 0 <= z <= w.
+*  x and y are clipped against a guard band GUARD_BAND_SCALE times the size of the screen instead of the screen edges,
+*  triangles that only poke out of the screen are left to the rasterizer's bounding box clip, which costs nothing,
+*  so only triangles crossing the near / far plane or the guard band ever gain vertices.
+*/
+struct FrustumClipper
+{
+public:
+	enum ClipPlane
+	{
+		CLIP_NEAR = 1 << 0,
+		CLIP_FAR = 1 << 1,
+		CLIP_LEFT = 1 << 2,
+		CLIP_RIGHT = 1 << 3,
+		CLIP_BOTTOM = 1 << 4,
+		CLIP_TOP = 1 << 5
+	};
+
+	static const int CLIP_PLANE_COUNT = 6;
+
+	/* Every plane adds at most one vertex to a convex polygon */
+	static const int MAX_VERTICES = 3 + CLIP_PLANE_COUNT;
+
+private:
+	/* Scratch polygons, each plane reads one and writes the other so nothing is allocated per triangle */
+	Vertex mPolygons[2][MAX_VERTICES];
+	int mOutputPolygon;
+
+	/* Planes the last triangle had to be clipped against */
+	unsigned int mClipPlanes;
+
+public:
+	inline FrustumClipper();
+
+public:
+	/* Clips triangle abc and returns the vertex count of the clipped convex polygon, 0 when the triangle is outside the screen.
+	*  The polygon is wound like abc, GetVertices()[0] with every following pair of vertices forms a fan of triangles
+	*/
+	inline int ClipTriangle(const Vertex& a, const Vertex& b, const Vertex& c);
+
+	inline const Vertex* GetVertices() const;
+
+	/* If the last ClipTriangle had to cut the triangle, trivially accepted and rejected ones were not clipped */
+	inline bool WasClipped() const;
+
+	/* Bitmask of the planes v is outside of, with the x / y planes scaled by xyScale */
+	inline static unsigned int GetOutCode(const Vertex& v, float xyScale);
+
+private:
+	/* Signed distance like value of v to the plane, negative outside of it */
+	inline static float GetPlaneDistance(const Vertex& v, ClipPlane plane);
+
+	inline static int ClipPolygonAgainstPlane(const Vertex* in, int inCount, Vertex* out, ClipPlane plane);
+};
+
+inline FrustumClipper::FrustumClipper()
+	: mOutputPolygon(0), mClipPlanes(0) { }
+
+inline int FrustumClipper::ClipTriangle(const Vertex& a, const Vertex& b, const Vertex& c)
+{
+	mClipPlanes = 0;
+
+	// All three vertices outside the same screen plane, nothing of the triangle can be on screen
+	if (GetOutCode(a, 1.0f) & GetOutCode(b, 1.0f) & GetOutCode(c, 1.0f)) { return 0; }
+
+	// Only the planes a vertex is outside of (near / far / guard band) have to be clipped against
+	unsigned int clipPlanes = GetOutCode(a, GUARD_BAND_SCALE) | GetOutCode(b, GUARD_BAND_SCALE) | GetOutCode(c, GUARD_BAND_SCALE);
+
+	mOutputPolygon = 0;
+	Vertex* polygon = mPolygons[0];
+	polygon[0] = a;
+	polygon[1] = b;
+	polygon[2] = c;
+
+	mClipPlanes = clipPlanes;
+
+	int count = 3;
+	for (int i = 0; i < CLIP_PLANE_COUNT && count > 0; i++)
+	{
+		ClipPlane plane = static_cast<ClipPlane>(1 << i);
+		if (!(clipPlanes & plane)) { continue; }
+
+		count = ClipPolygonAgainstPlane(mPolygons[mOutputPolygon], count, mPolygons[mOutputPolygon ^ 1], plane);
+		mOutputPolygon ^= 1;
+	}
+
+	return count >= 3 ? count : 0;
+}
+
+inline const Vertex* FrustumClipper::GetVertices() const
+{
+	return mPolygons[mOutputPolygon];
+}
+
+inline bool FrustumClipper::WasClipped() const
+{
+	return mClipPlanes != 0;
+}
+
+inline unsigned int FrustumClipper::GetOutCode(const Vertex& v, float xyScale)
+{
+	float w = v.W * xyScale;
+	unsigned int outCode = 0;
+
+	if (v.Z < 0.0f) { outCode |= CLIP_NEAR; }
+	if (v.Z > v.W) { outCode |= CLIP_FAR; }
+	if (v.X < -w) { outCode |= CLIP_LEFT; }
+	if (v.X > w) { outCode |= CLIP_RIGHT; }
+	if (v.Y < -w) { outCode |= CLIP_BOTTOM; }
+	if (v.Y > w) { outCode |= CLIP_TOP; }
+
+	return outCode;
+}
+
+inline float FrustumClipper::GetPlaneDistance(const Vertex& v, ClipPlane plane)
+{
+	switch (plane)
+	{
+	case CLIP_NEAR: return v.Z;
+	case CLIP_FAR: return v.W - v.Z;
+	case CLIP_LEFT: return v.X + v.W * GUARD_BAND_SCALE;
+	case CLIP_RIGHT: return v.W * GUARD_BAND_SCALE - v.X;
+	case CLIP_BOTTOM: return v.Y + v.W * GUARD_BAND_SCALE;
+	case CLIP_TOP: return v.W * GUARD_BAND_SCALE - v.Y;
+	}
+	return 0.0f;
+}
+
+inline int FrustumClipper::ClipPolygonAgainstPlane(const Vertex* in, int inCount, Vertex* out, ClipPlane plane)
+{
+	int outCount = 0;
+
+	const Vertex* previous = &in[inCount - 1];
+	float previousDistance = GetPlaneDistance(*previous, plane);
+
+	for (int i = 0; i < inCount; i++)
+	{
+		const Vertex* current = &in[i];
+		float currentDistance = GetPlaneDistance(*current, plane);
+
+		bool bPreviousInside = previousDistance >= 0.0f;
+		bool bCurrentInside = currentDistance >= 0.0f;
+
+		// Edge crosses the plane, always interpolate from the inside vertex so an edge shared by two triangles gets the same new vertex
+		if (bPreviousInside != bCurrentInside)
+		{
+			const Vertex& inside = bPreviousInside ? *previous : *current;
+			const Vertex& outside = bPreviousInside ? *current : *previous;
+			float insideDistance = bPreviousInside ? previousDistance : currentDistance;
+			float outsideDistance = bPreviousInside ? currentDistance : previousDistance;
+
+			Vertex& intersection = out[outCount++];
+			intersection = inside;
+			Math::LerpVerticesByRatio(intersection, outside, insideDistance / (insideDistance - outsideDistance));
+		}
+
+		if (bCurrentInside)
+		{
+			out[outCount++] = *current;
+		}
+
+		previous = current;
+		previousDistance = currentDistance;
+	}
+
+	return outCount;
+}
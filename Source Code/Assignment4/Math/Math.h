@@ -2,7 +2,7 @@
 #include "Graphics/Texel.h"
 #include "Matrix4D.h"
 #include "Graphics/Vertex.h"
-#include "Graphics/Texture.h"
+#include "EdgeFunction.h"
 
 struct Math
 {
@@ -53,7 +53,7 @@ public:
 		return static_cast<float>(end - start) * ratio + start;
 	}
 
-	inline static void LerpVerticesByRatio(Vertex& start, Vertex& end, float ratio)
+	inline static void LerpVerticesByRatio(Vertex& start, const Vertex& end, float ratio)
 	{
 		start.X = Math::Lerp(start.X, end.X, ratio);
 		start.Y = Math::Lerp(start.Y, end.Y, ratio);
@@ -313,19 +313,6 @@ public:
 		vertex.Z *= r;
 	}
 
-	/* Graphics Stuff*/
-	inline static unsigned int CalculateBilinearTextureFilter(float uRatio, float vRatio, unsigned int currentTexel, Texture& texture)
-	{
-		unsigned int nextPixel = (currentTexel + 1);
-		unsigned int bottomPixel = (currentTexel + texture.Width);
-		unsigned int diagonalPixel = (bottomPixel + 1);
-
-		unsigned int color1 = Math::LerpColor((texture.Pixels[currentTexel % texture.NumOfPixels]), (texture.Pixels[nextPixel % texture.NumOfPixels]), uRatio);
-		unsigned int color2 = Math::LerpColor((texture.Pixels[bottomPixel % texture.NumOfPixels]), (texture.Pixels[diagonalPixel % texture.NumOfPixels]), uRatio);
-
-		return static_cast<unsigned int>(Math::LerpColor(color1, color2, vRatio));
-	}
-
 	inline static bool ValidateLineInNDCSpace(Vertex& a, Vertex& b)
 	{
 		if (a.Y > 1.0f )
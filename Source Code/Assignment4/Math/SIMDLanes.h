@@ -0,0 +1,306 @@
+#pragma once
+
+/* Thin wrappers over SSE2 / AVX2 so the block rasterizer can be written once as a template over the lane width.
+*  SSE2 is part of every x86-64 (and our Win32 build) target, AVX2 is compiled in without changing the build's target,
+*  so the program still runs on any x86 cpu. Which one actually runs is chosen at runtime, see SIMD::IsAVX2Supported.
+*/
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_SSE2_AVAILABLE 1
+#else
+#define SIMD_SSE2_AVAILABLE 0
+#endif
+
+#if SIMD_SSE2_AVAILABLE && (defined(_MSC_VER) || defined(__GNUC__))
+#define SIMD_AVX2_AVAILABLE 1
+#else
+#define SIMD_AVX2_AVAILABLE 0
+#endif
+
+/* Fused multiply add ships with every AVX2 cpu, IsAVX2Supported checks for both */
+#define SIMD_FMA_AVAILABLE SIMD_AVX2_AVAILABLE
+
+/* MSVC compiles AVX2 intrinsics in any function. GCC and Clang only emit AVX2 / FMA code in functions that ask for it, the rest of
+*  the translation unit stays on the build's baseline target: AVX2Lanes' functions are SIMD_AVX2_FUNCTION, and code templated over
+*  AVX2Lanes is only called from a SIMD_AVX2_ENTRY function, which inlines everything it calls so the template is compiled for AVX2 too.
+*  Nothing compiled for AVX2 may be called before SIMD::IsAVX2Supported said so.
+*  Since those templates never stay out of line, GCC's -Wpsabi notes about passing AVX vectors without AVX enabled don't apply: build with -Wno-psabi
+*/
+#if SIMD_AVX2_AVAILABLE && !defined(_MSC_VER)
+#define SIMD_AVX2_FUNCTION __attribute__((target("avx2,fma")))
+#define SIMD_AVX2_ENTRY __attribute__((target("avx2,fma"), flatten))
+#else
+#define SIMD_AVX2_FUNCTION
+#define SIMD_AVX2_ENTRY
+#endif
+
+#if SIMD_SSE2_AVAILABLE
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+struct SIMD
+{
+public:
+	/* Returns if the cpu and os both support AVX2 and FMA (ymm state must be saved by the os) */
+	static bool IsAVX2Supported()
+	{
+#if SIMD_AVX2_AVAILABLE && defined(_MSC_VER)
+		int cpuInfo[4];
+		__cpuid(cpuInfo, 0);
+		if (cpuInfo[0] < 7) { return false; }
+
+		__cpuid(cpuInfo, 1);
+		bool bOSXSave = (cpuInfo[2] & (1 << 27)) != 0;
+		bool bAVX = (cpuInfo[2] & (1 << 28)) != 0;
+		bool bFMA = (cpuInfo[2] & (1 << 12)) != 0;
+		if (!bOSXSave || !bAVX || !bFMA) { return false; }
+
+		if ((_xgetbv(0) & 0x6) != 0x6) { return false; }
+
+		__cpuidex(cpuInfo, 7, 0);
+		return (cpuInfo[1] & (1 << 5)) != 0;
+#elif SIMD_AVX2_AVAILABLE
+		// Can run before main, from a static initializer
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+		return false;
+#endif
+	}
+
+	/* Number of lanes set in a lane bitmask */
+	inline static int CountLanes(int mask)
+	{
+		int count = 0;
+		for (; mask; mask &= mask - 1)
+		{
+			count++;
+		}
+		return count;
+	}
+};
+
+#if SIMD_SSE2_AVAILABLE
+/* 4 lanes of 32 bit ints / floats */
+struct SSE2Lanes
+{
+public:
+	typedef __m128 Float;
+	typedef __m128i Int;
+
+	static const int Width = 4;
+	static const int FullMask = 0xF;
+
+public:
+	inline static Float Set(float value) { return _mm_set1_ps(value); }
+	inline static Int SetInt(int value) { return _mm_set1_epi32(value); }
+
+	/* start, start + step, start + 2 * step ... */
+	inline static Int SetIntSequence(int start, int step) { return _mm_setr_epi32(start, start + step, start + step * 2, start + step * 3); }
+
+	inline static Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+	inline static Float Sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+	inline static Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+	inline static Float Div(Float a, Float b) { return _mm_div_ps(a, b); }
+	inline static Float Min(Float a, Float b) { return _mm_min_ps(a, b); }
+	inline static Float Max(Float a, Float b) { return _mm_max_ps(a, b); }
+	inline static Float Sqrt(Float a) { return _mm_sqrt_ps(a); }
+
+	/* a * b + c */
+	inline static Float MulAdd(Float a, Float b, Float c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+
+	inline static Int AddInt(Int a, Int b) { return _mm_add_epi32(a, b); }
+	inline static Int SubInt(Int a, Int b) { return _mm_sub_epi32(a, b); }
+	inline static Int And(Int a, Int b) { return _mm_and_si128(a, b); }
+	inline static Int Or(Int a, Int b) { return _mm_or_si128(a, b); }
+	inline static Int ShiftLeft(Int a, int bits) { return _mm_slli_epi32(a, bits); }
+	inline static Int ShiftRight(Int a, int bits) { return _mm_srli_epi32(a, bits); }
+
+	/* Multiplies the 16 bit halves of the lanes, keeping the low 16 bits of each product */
+	inline static Int Mul16(Int a, Int b) { return _mm_mullo_epi16(a, b); }
+
+	inline static Float ToFloat(Int a) { return _mm_cvtepi32_ps(a); }
+	inline static Int ToIntTruncate(Float a) { return _mm_cvttps_epi32(a); }
+
+	/* The bits of the floats, not converted */
+	inline static Int AsInt(Float a) { return _mm_castps_si128(a); }
+
+	/* Bitmask of lanes where a >= 0 */
+	inline static int NonNegativeMask(Int a) { return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(a, _mm_set1_epi32(-1)))); }
+
+	/* Bitmask of lanes where a <= b */
+	inline static int LessEqualMask(Float a, Float b) { return _mm_movemask_ps(_mm_cmple_ps(a, b)); }
+
+	/* Bitmask of lanes where (unsigned)a < (unsigned)b, b must be below 0x80000000 */
+	inline static int LessThanMaskUnsigned(Int a, Int b)
+	{
+		Int signFlip = _mm_set1_epi32(static_cast<int>(0x80000000));
+		return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(_mm_xor_si128(a, signFlip), _mm_xor_si128(b, signFlip))));
+	}
+
+	inline static Float Load(const float* in) { return _mm_loadu_ps(in); }
+	inline static void Store(float* out, Float a) { _mm_storeu_ps(out, a); }
+	inline static void StoreInt(unsigned int* out, Int a) { _mm_storeu_si128(reinterpret_cast<__m128i*>(out), a); }
+	inline static Int LoadInt(const unsigned int* in) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(in)); }
+
+	/* Loads only the lanes in mask, the others are 0. Memory outside of mask is never touched */
+	inline static Float MaskLoad(const float* in, int mask)
+	{
+		if (mask == FullMask) { return _mm_loadu_ps(in); }
+
+		alignas(16) float values[Width] = {};
+		for (int i = 0; i < Width; i++)
+		{
+			if (mask & (1 << i)) { values[i] = in[i]; }
+		}
+		return _mm_load_ps(values);
+	}
+
+	/* Writes only the lanes in mask. Memory outside of mask is never touched */
+	inline static void MaskStore(float* out, Float a, int mask)
+	{
+		if (mask == FullMask) { _mm_storeu_ps(out, a); return; }
+
+		alignas(16) float values[Width];
+		_mm_store_ps(values, a);
+		for (int i = 0; i < Width; i++)
+		{
+			if (mask & (1 << i)) { out[i] = values[i]; }
+		}
+	}
+
+	inline static void MaskStoreInt(unsigned int* out, Int a, int mask)
+	{
+		if (mask == FullMask) { _mm_storeu_si128(reinterpret_cast<__m128i*>(out), a); return; }
+
+		alignas(16) unsigned int values[Width];
+		_mm_store_si128(reinterpret_cast<__m128i*>(values), a);
+		for (int i = 0; i < Width; i++)
+		{
+			if (mask & (1 << i)) { out[i] = values[i]; }
+		}
+	}
+
+	/* No gather instruction, reads texels one lane at a time */
+	inline static Int MaskGather(const unsigned int* base, Int indices, int mask)
+	{
+		alignas(16) unsigned int index[Width];
+		alignas(16) unsigned int values[Width] = {};
+		_mm_store_si128(reinterpret_cast<__m128i*>(index), indices);
+		for (int i = 0; i < Width; i++)
+		{
+			if (mask & (1 << i)) { values[i] = base[index[i]]; }
+		}
+		return _mm_load_si128(reinterpret_cast<const __m128i*>(values));
+	}
+};
+#endif // SIMD_SSE2_AVAILABLE
+
+#if SIMD_AVX2_AVAILABLE
+/* 8 lanes of 32 bit ints / floats */
+struct AVX2Lanes
+{
+public:
+	typedef __m256 Float;
+	typedef __m256i Int;
+
+	static const int Width = 8;
+	static const int FullMask = 0xFF;
+
+public:
+	SIMD_AVX2_FUNCTION inline static Float Set(float value) { return _mm256_set1_ps(value); }
+	SIMD_AVX2_FUNCTION inline static Int SetInt(int value) { return _mm256_set1_epi32(value); }
+
+	/* start, start + step, start + 2 * step ... */
+	SIMD_AVX2_FUNCTION inline static Int SetIntSequence(int start, int step)
+	{
+		return _mm256_add_epi32(_mm256_set1_epi32(start), _mm256_mullo_epi32(_mm256_set1_epi32(step), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+	}
+
+	SIMD_AVX2_FUNCTION inline static Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+	SIMD_AVX2_FUNCTION inline static Float Sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+	SIMD_AVX2_FUNCTION inline static Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+	SIMD_AVX2_FUNCTION inline static Float Div(Float a, Float b) { return _mm256_div_ps(a, b); }
+	SIMD_AVX2_FUNCTION inline static Float Min(Float a, Float b) { return _mm256_min_ps(a, b); }
+	SIMD_AVX2_FUNCTION inline static Float Max(Float a, Float b) { return _mm256_max_ps(a, b); }
+	SIMD_AVX2_FUNCTION inline static Float Sqrt(Float a) { return _mm256_sqrt_ps(a); }
+
+	/* a * b + c, rounded once when FMA is available */
+	SIMD_AVX2_FUNCTION inline static Float MulAdd(Float a, Float b, Float c)
+	{
+#if SIMD_FMA_AVAILABLE
+		return _mm256_fmadd_ps(a, b, c);
+#else
+		return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+	}
+
+	SIMD_AVX2_FUNCTION inline static Int AddInt(Int a, Int b) { return _mm256_add_epi32(a, b); }
+	SIMD_AVX2_FUNCTION inline static Int SubInt(Int a, Int b) { return _mm256_sub_epi32(a, b); }
+	SIMD_AVX2_FUNCTION inline static Int And(Int a, Int b) { return _mm256_and_si256(a, b); }
+	SIMD_AVX2_FUNCTION inline static Int Or(Int a, Int b) { return _mm256_or_si256(a, b); }
+	SIMD_AVX2_FUNCTION inline static Int ShiftLeft(Int a, int bits) { return _mm256_slli_epi32(a, bits); }
+	SIMD_AVX2_FUNCTION inline static Int ShiftRight(Int a, int bits) { return _mm256_srli_epi32(a, bits); }
+
+	/* Multiplies the 16 bit halves of the lanes, keeping the low 16 bits of each product */
+	SIMD_AVX2_FUNCTION inline static Int Mul16(Int a, Int b) { return _mm256_mullo_epi16(a, b); }
+
+	SIMD_AVX2_FUNCTION inline static Float ToFloat(Int a) { return _mm256_cvtepi32_ps(a); }
+	SIMD_AVX2_FUNCTION inline static Int ToIntTruncate(Float a) { return _mm256_cvttps_epi32(a); }
+
+	/* The bits of the floats, not converted */
+	SIMD_AVX2_FUNCTION inline static Int AsInt(Float a) { return _mm256_castps_si256(a); }
+
+	/* Bitmask of lanes where a >= 0 */
+	SIMD_AVX2_FUNCTION inline static int NonNegativeMask(Int a) { return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(a, _mm256_set1_epi32(-1)))); }
+
+	/* Bitmask of lanes where a <= b */
+	SIMD_AVX2_FUNCTION inline static int LessEqualMask(Float a, Float b) { return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LE_OQ)); }
+
+	/* Bitmask of lanes where (unsigned)a < (unsigned)b, b must be below 0x80000000 */
+	SIMD_AVX2_FUNCTION inline static int LessThanMaskUnsigned(Int a, Int b)
+	{
+		Int signFlip = _mm256_set1_epi32(static_cast<int>(0x80000000));
+		return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_xor_si256(b, signFlip), _mm256_xor_si256(a, signFlip))));
+	}
+
+	SIMD_AVX2_FUNCTION inline static Float Load(const float* in) { return _mm256_loadu_ps(in); }
+	SIMD_AVX2_FUNCTION inline static void Store(float* out, Float a) { _mm256_storeu_ps(out, a); }
+	SIMD_AVX2_FUNCTION inline static void StoreInt(unsigned int* out, Int a) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), a); }
+	SIMD_AVX2_FUNCTION inline static Int LoadInt(const unsigned int* in) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in)); }
+
+	/* Expands a lane bitmask into a vector mask */
+	SIMD_AVX2_FUNCTION inline static Int ExpandMask(int mask)
+	{
+		Int bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+		return _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(mask), bits), bits);
+	}
+
+	/* Loads only the lanes in mask, the others are 0. Memory outside of mask is never touched */
+	SIMD_AVX2_FUNCTION inline static Float MaskLoad(const float* in, int mask)
+	{
+		if (mask == FullMask) { return _mm256_loadu_ps(in); }
+		return _mm256_maskload_ps(in, ExpandMask(mask));
+	}
+
+	/* Writes only the lanes in mask. Memory outside of mask is never touched */
+	SIMD_AVX2_FUNCTION inline static void MaskStore(float* out, Float a, int mask)
+	{
+		if (mask == FullMask) { _mm256_storeu_ps(out, a); return; }
+		_mm256_maskstore_ps(out, ExpandMask(mask), a);
+	}
+
+	SIMD_AVX2_FUNCTION inline static void MaskStoreInt(unsigned int* out, Int a, int mask)
+	{
+		if (mask == FullMask) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), a); return; }
+		_mm256_maskstore_epi32(reinterpret_cast<int*>(out), ExpandMask(mask), a);
+	}
+
+	SIMD_AVX2_FUNCTION inline static Int MaskGather(const unsigned int* base, Int indices, int mask)
+	{
+		return _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), reinterpret_cast<const int*>(base), indices, ExpandMask(mask), 4);
+	}
+};
+#endif // SIMD_AVX2_AVAILABLE
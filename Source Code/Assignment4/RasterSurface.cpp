@@ -2,13 +2,16 @@
 // Author: L.Norri CD GX1 & GX2, FullSail University
 
 #include "RasterSurface.h"// definitions
+#if !RS_HEADLESS
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 #include <wingdi.h>
 #include <thread>
 #include <future>
 #include <mutex>
+#include <condition_variable>
 #include <atomic>
+#include "SPSCQueue.h"
 
 // variables used by the RasterSurface
 HWND							window = nullptr;
@@ -24,6 +27,20 @@ std::mutex						bitmapMutex;
 std::condition_variable			bitmapRedraw;
 std::future<unsigned int*>		bitmapAllocator;
 std::atomic_bool				bitmapPresent; 
+// swap chain buffers, queued by the renderer for presentation and handed back once presented
+SPSCQueue<unsigned int*, RS_MAX_SWAP_CHAIN_LENGTH>	swapChainPresentQueue;
+SPSCQueue<unsigned int*, RS_MAX_SWAP_CHAIN_LENGTH>	swapChainFreeQueue;
+// RS_AcquireBackBuffer sleeps on these while every buffer is in flight
+std::mutex						swapChainFreeMutex;
+std::condition_variable			swapChainFreed;
+
+// Wakes a RS_AcquireBackBuffer waiting for a buffer, call after pushing one back or closing the window.
+// Taking the mutex orders this after the waiter last checked, so the wake up can not be missed.
+void NotifySwapChainFreed()
+{
+	{ std::lock_guard<std::mutex> freeLock(swapChainFreeMutex); }
+	swapChainFreed.notify_one();
+}
 
 // Handles all windows messages (Messages may arrive cross-thread without a valid HWND)
 // hWnd may be set artifically due to cross-thread message posting (NULL HWNDs are ignored)
@@ -35,6 +52,7 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 		{
 			windowClosed = true; // window closing, updates disabled
 			bitmapRedraw.notify_one(); // tell main to stop waiting for a redraw and exit
+			NotifySwapChainFreed(); // or for a back buffer
 			// close down the window
 			window = nullptr; // dont stall get message
 			PostQuitMessage(0);
@@ -44,8 +62,37 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 	return DefWindowProcW(hWnd, message, wParam, lParam);
 }
 
-// This function transfers the internal block of pixels to the screen
+// This function transfers a block of pixels to the screen
 // It will also update the title bar FPS once every second
+void DrawToWindow(const unsigned int* pixels)
+{
+	// SetDIBitsToDevice version
+	BITMAPINFO	toDraw;
+	ZeroMemory(&toDraw, sizeof(BITMAPINFO));
+	toDraw.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+	toDraw.bmiHeader.biWidth = bitmapWidth;
+	toDraw.bmiHeader.biHeight = -int(bitmapHeight); // flip
+	toDraw.bmiHeader.biPlanes = 1;
+	toDraw.bmiHeader.biBitCount = 32;
+	toDraw.bmiHeader.biCompression = BI_RGB;
+	// Draw to frontbuffer
+	SetDIBitsToDevice(windowDC, 0, 0, bitmapWidth, bitmapHeight, 0, 0, 0,
+		bitmapHeight, pixels, &toDraw, DIB_RGB_COLORS);
+	// Update visible frame rate every second
+	static ULONGLONG frameCount = 0; ++frameCount;
+	static ULONGLONG framesPast = frameCount;
+	static ULONGLONG prevCount = GetTickCount();
+	if (GetTickCount64() - prevCount > 1000) // only update every second
+	{
+		char buffer[256];
+		sprintf_s(buffer, "%s. FPS: %d", windowTitle, static_cast<int>(frameCount - framesPast));
+		SetWindowTextA(window, buffer);
+		framesPast = frameCount;
+		prevCount = GetTickCount64();
+	}
+}
+
+// This function transfers the internal block of pixels to the screen
 bool PresentFrame()
 {
 	// update screen contents & increment frame count
@@ -53,33 +100,24 @@ bool PresentFrame()
 	{
 		// lock down the bitmap object and use it to paint to the window surface
 		std::unique_lock<std::mutex> pixelLock(bitmapMutex);
-		// SetDIBitsToDevice version
-		BITMAPINFO	toDraw;
-		ZeroMemory(&toDraw, sizeof(BITMAPINFO));
-		toDraw.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
-		toDraw.bmiHeader.biWidth = bitmapWidth;
-		toDraw.bmiHeader.biHeight = -int(bitmapHeight); // flip
-		toDraw.bmiHeader.biPlanes = 1;
-		toDraw.bmiHeader.biBitCount = 32;
-		toDraw.bmiHeader.biCompression = BI_RGB;
-		// Draw to frontbuffer
-		SetDIBitsToDevice(windowDC, 0, 0, bitmapWidth, bitmapHeight, 0, 0, 0,
-			bitmapHeight, bitmap, &toDraw, DIB_RGB_COLORS);
+		DrawToWindow(bitmap);
 		// increase frame count and notify render thread to continue
 		bitmapPresent = false; // increase frame count
 		bitmapRedraw.notify_one(); // tell main thread to continue rendering
-		// Update visible frame rate every second
-		static ULONGLONG frameCount = 0; ++frameCount;
-		static ULONGLONG framesPast = frameCount;
-		static ULONGLONG prevCount = GetTickCount();
-		if (GetTickCount64() - prevCount > 1000) // only update every second
-		{
-			char buffer[256];
-			sprintf_s(buffer, "%s. FPS: %d", windowTitle, static_cast<int>(frameCount - framesPast));
-			SetWindowTextA(window, buffer);
-			framesPast = frameCount;
-			prevCount = GetTickCount64();
-		}
+		return true;
+	}
+	return false;
+}
+
+// Paints the oldest queued swap chain buffer straight from the renderer's memory, then hands it back
+bool PresentSwapChainBuffer()
+{
+	unsigned int* backBuffer = nullptr;
+	if (window && windowDC && swapChainPresentQueue.Pop(backBuffer))
+	{
+		DrawToWindow(backBuffer);
+		swapChainFreeQueue.Push(backBuffer); // can not fail, the queue holds every buffer of the swap chain
+		NotifySwapChainFreed();
 		return true;
 	}
 	return false;
@@ -137,12 +175,16 @@ void ProcessRasterSurface(	unsigned int _width, unsigned int _height,
 			// This operation is synchronized with "RS_Update"
 			if (bitmapPresent) 
 				PresentFrame();
+			// Swap chain buffers are presented as they are queued, without any lock
+			PresentSwapChainBuffer();
 		}
 	}
 	// delete the front buffer "aka: bitmap" (before thread shuts down)
 	VirtualFree(frontbuffer, 0, MEM_RELEASE); bitmap = nullptr;
 	// deallocate window
 	UnregisterClassW(L"RasterSurfaceApplication", GetModuleHandleW(0));
+	// nothing will be presented anymore, also covers a window that failed to open
+	windowClosed = true;
 }
 
 // Handles unexpected termination of the console window.
@@ -203,6 +245,40 @@ bool RS_Update(	_In_reads_(_numPixels) const unsigned int *_argbPixels,
 	return false;
 }
 
+// Hands the caller's buffers to the RasterSurface, they all start out free to draw into.
+// Called before the first RS_Present, so this thread is the only one touching the free queue.
+bool RS_CreateSwapChain(_In_reads_(_count) unsigned int* const* _buffers,
+						_In_range_(2, RS_MAX_SWAP_CHAIN_LENGTH) unsigned int _count)
+{
+	if (_count < 2 || _count > RS_MAX_SWAP_CHAIN_LENGTH) return false;
+	for (unsigned int i = 0; i < _count; ++i)
+		swapChainFreeQueue.Push(_buffers[i]);
+	return true;
+}
+
+// Returns a buffer that is neither queued nor being presented, waits only while every buffer is in flight.
+unsigned int* RS_AcquireBackBuffer()
+{
+	unsigned int* backBuffer = nullptr;
+	// lock-free when a buffer is free, which is every frame unless the renderer is a whole swap chain ahead
+	if (swapChainFreeQueue.Pop(backBuffer)) return backBuffer;
+	// otherwise sleep until the window thread hands one back
+	std::unique_lock<std::mutex> freeLock(swapChainFreeMutex);
+	swapChainFreed.wait(freeLock, [&]()
+	{
+		// if the window has been closed, its queued buffers never come back
+		return swapChainFreeQueue.Pop(backBuffer) || windowClosed;
+	});
+	return backBuffer;
+}
+
+// Queues a drawn buffer for the window thread, no copy and no wait on the previous present.
+bool RS_Present(_In_ unsigned int* _backBuffer)
+{
+	if (windowClosed) return false;
+	return swapChainPresentQueue.Push(_backBuffer);
+}
+
 // Deallocates the RasterSurface and cleans up any leftover memory.
 bool RS_Shutdown()
 {
@@ -225,4 +301,5 @@ BOOL WINAPI ConsoleCtrlHandler(DWORD ctrlCode)
 		RS_Shutdown(); // kill window and wait for shutdown
 	// allow other handlers to end process
 	return FALSE;
-}
\ No newline at end of file
+}
+#endif // !RS_HEADLESS
@@ -2,8 +2,28 @@
 // Author: L.Norri CD GX1 & GX2, FullSail University
 
 #pragma once
+
+// Presentation backend, picked at build time.
+// RS_HEADLESS 0 spawns a win32 window (RasterSurface.cpp), RS_HEADLESS 1 presents into memory with no window (RasterSurfaceHeadless.cpp).
+// Builds for anything but Windows are always headless.
+#if !defined(RS_HEADLESS)
+#if defined(_WIN32)
+#define RS_HEADLESS 0
+#else
+#define RS_HEADLESS 1
+#endif
+#endif
+
+#if defined(_MSC_VER)
 // Microsoft source-code annotation language (SAL)
 #include <sal.h> 
+#else
+#define _In_z_
+#define _In_range_(lb, ub)
+#define _In_reads_(size)
+#define _Out_writes_(size)
+#define _In_
+#endif
 
 // Spawns & manages a win32 window of the requested size. (the "RasterSurface") 
 bool RS_Initialize( _In_z_ const char* _studentName,
@@ -16,4 +36,43 @@ bool RS_Update(	_In_reads_(_numPixels) const unsigned int *_xrgbPixels,
 				_In_range_(1, 0xFFFFFFFF) unsigned int _numPixels);
 
 // Deallocates the RasterSurface and cleans up any leftover memory.
-bool RS_Shutdown();
\ No newline at end of file
+bool RS_Shutdown();
+
+// Swap chain presentation, an alternative to RS_Update that never copies a frame.
+// The caller owns up to RS_MAX_SWAP_CHAIN_LENGTH buffers of width * height XRGB pixels and draws straight into them,
+// buffers are passed to the presentation thread and back by pointer through lock-free queues.
+#define RS_MAX_SWAP_CHAIN_LENGTH 3
+
+// Hands the caller's buffers to the RasterSurface, call once after RS_Initialize and before the first RS_Present.
+// The buffers must stay alive until RS_Shutdown.
+bool RS_CreateSwapChain(_In_reads_(_count) unsigned int* const* _buffers,
+						_In_range_(2, RS_MAX_SWAP_CHAIN_LENGTH) unsigned int _count);
+
+// Returns a buffer that is neither queued nor being presented to draw the next frame into, nullptr once the surface was closed.
+// Only waits when every buffer is still queued for presentation.
+unsigned int* RS_AcquireBackBuffer();
+
+// Queues a buffer from RS_AcquireBackBuffer for presentation and returns right away, false once the surface was closed.
+// The buffer must not be touched again until RS_AcquireBackBuffer hands it back.
+bool RS_Present(_In_ unsigned int* _backBuffer);
+
+#if RS_HEADLESS
+// Number of presented frames the headless backend keeps around for RS_ReadFrame.
+#define RS_HEADLESS_RING_SIZE 3
+
+// The headless backend is configured from the environment when RS_Initialize runs:
+//   RS_FRAME_LIMIT     RS_Update returns false once this many frames were presented (unset or 0 runs until SIGINT / SIGTERM).
+//   RS_IMAGE_SEQUENCE  printf pattern of the frame number, every frame is also written there as a binary PPM, e.g. "frames/%05u.ppm".
+//                      Files are written on a separate thread, RS_Update only waits when that thread is a whole ring behind.
+//   RS_SHARED_MEMORY   name of a POSIX shared memory object, e.g. "/rs_frames", every frame is also published into it
+//                      for other processes to read in place. Linux only, see SharedFrameRing.h for the layout.
+
+// How many frames RS_Update has presented so far.
+unsigned int RS_GetFrameCount();
+
+// Copies frame number _frameIndex (0 based, in presentation order) out of the ring.
+// Returns false if that frame was not presented yet or has already been overwritten.
+bool RS_ReadFrame(	unsigned int _frameIndex,
+					_Out_writes_(_numPixels) unsigned int *_xrgbPixels,
+					_In_range_(1, 0xFFFFFFFF) unsigned int _numPixels);
+#endif
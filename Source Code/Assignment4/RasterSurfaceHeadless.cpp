@@ -0,0 +1,215 @@
+// Windowless RasterSurface for machines with no display, same contract as RasterSurface.cpp.
+// Presented frames go into an in-memory ring that can be read back with RS_ReadFrame,
+// and optionally out to an image sequence written by a dedicated thread.
+
+#include "RasterSurface.h"// definitions
+#if RS_HEADLESS
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include "SPSCQueue.h"
+#include "SharedFrameRing.h"
+
+// variables used by the headless RasterSurface
+std::vector<unsigned int>		ringFrames[RS_HEADLESS_RING_SIZE];
+unsigned int					ringWidth = 0;
+unsigned int					ringHeight = 0;
+unsigned int					presentedFrames = 0; // frames in the ring so far, guarded by ringMutex
+unsigned int					writtenFrames = 0; // frames the image sequence thread has taken, guarded by ringMutex
+unsigned int					frameLimit = 0;
+std::mutex						ringMutex;
+std::condition_variable			ringChanged;
+std::thread						imageSequenceWriter;
+std::string						imageSequencePattern;
+bool							writerStopping = false;
+volatile std::sig_atomic_t		interrupted = 0;
+// swap chain buffers free to draw into, only ever touched by the rendering thread
+SPSCQueue<unsigned int*, RS_MAX_SWAP_CHAIN_LENGTH>	swapChainFreeQueue;
+#if defined(__linux__)
+// frames published for other processes, only written by the rendering thread
+SharedFrameRingWriter			sharedFrames;
+#endif
+
+// SIGINT / SIGTERM stop the render loop the next time it presents, like closing the window would
+void InterruptHandler(int signal)
+{
+	interrupted = 1;
+}
+
+// Writes one XRGB frame as a binary PPM
+bool WriteImage(const char* fileName, const unsigned int* xrgbPixels, unsigned int width, unsigned int height)
+{
+	FILE* file = fopen(fileName, "wb");
+	if (!file) return false;
+
+	fprintf(file, "P6\n%u %u\n255\n", width, height);
+	std::vector<unsigned char> row(width * 3);
+	for (unsigned int y = 0; y < height; ++y)
+	{
+		const unsigned int* source = xrgbPixels + y * width;
+		for (unsigned int x = 0; x < width; ++x)
+		{
+			row[x * 3 + 0] = static_cast<unsigned char>(source[x] >> 16);
+			row[x * 3 + 1] = static_cast<unsigned char>(source[x] >> 8);
+			row[x * 3 + 2] = static_cast<unsigned char>(source[x]);
+		}
+		fwrite(row.data(), 1, row.size(), file);
+	}
+
+	fclose(file);
+	return true;
+}
+
+// This thread writes every presented frame of the ring to the image sequence, in order
+void ProcessImageSequence()
+{
+	std::vector<unsigned int> frame(ringWidth * ringHeight);
+	std::vector<char> fileName(imageSequencePattern.size() + 32);
+	for (;;)
+	{
+		unsigned int frameIndex;
+		{
+			std::unique_lock<std::mutex> ringLock(ringMutex);
+			// drain whatever is left before stopping
+			ringChanged.wait(ringLock, [&]() { return writtenFrames < presentedFrames || writerStopping; });
+			if (writtenFrames == presentedFrames) break;
+			// copy out so the file is written without holding up RS_Update
+			frameIndex = writtenFrames;
+			frame = ringFrames[frameIndex % RS_HEADLESS_RING_SIZE];
+			++writtenFrames;
+		}
+		ringChanged.notify_all(); // a ring slot just freed up
+
+		snprintf(fileName.data(), fileName.size(), imageSequencePattern.c_str(), frameIndex);
+		if (!WriteImage(fileName.data(), frame.data(), ringWidth, ringHeight))
+			fprintf(stderr, "RasterSurface: could not write %s\n", fileName.data());
+	}
+}
+
+// Sets up the frame ring of the requested size, there is no window to spawn
+bool RS_Initialize(	_In_z_ const char* _studentName,
+					_In_range_(1, 0xFFFF) unsigned int _width,
+					_In_range_(1, 0xFFFF) unsigned int _height)
+{
+	ringWidth = _width;
+	ringHeight = _height;
+	for (std::vector<unsigned int>& frame : ringFrames)
+		frame.assign(_width * _height, 0);
+	presentedFrames = writtenFrames = 0;
+	writerStopping = false;
+	interrupted = 0;
+	// configuration comes from the environment, see RasterSurface.h
+	const char* limit = getenv("RS_FRAME_LIMIT");
+	frameLimit = limit ? static_cast<unsigned int>(strtoul(limit, nullptr, 10)) : 0;
+	const char* pattern = getenv("RS_IMAGE_SEQUENCE");
+	imageSequencePattern = pattern ? pattern : "";
+	if (!imageSequencePattern.empty())
+		imageSequenceWriter = std::thread(ProcessImageSequence);
+	const char* sharedMemoryName = getenv("RS_SHARED_MEMORY");
+	if (sharedMemoryName)
+	{
+#if defined(__linux__)
+		if (!sharedFrames.Open(sharedMemoryName, _width, _height))
+			fprintf(stderr, "RasterSurface: could not create shared memory %s\n", sharedMemoryName);
+#else
+		fprintf(stderr, "RasterSurface: RS_SHARED_MEMORY is only supported on Linux\n");
+#endif
+	}
+	// allows graceful exit when the process is interrupted
+	signal(SIGINT, InterruptHandler);
+	signal(SIGTERM, InterruptHandler);
+	return true;
+}
+
+// Copies a block of raw XRGB pixel data into the next ring slot.
+// Incoming data must 32bit pixels 8 bits per channel.
+bool RS_Update(	_In_reads_(_numPixels) const unsigned int *_argbPixels,
+				_In_range_(1, 0xFFFFFFFF) unsigned int _numPixels)
+{
+	if (interrupted) return false;
+	if (_numPixels > ringWidth * ringHeight) return false;
+	{
+		std::unique_lock<std::mutex> ringLock(ringMutex);
+		if (frameLimit && presentedFrames >= frameLimit) return false;
+		// nobody is watching unless an image sequence is written, in which case only wait once it is a whole ring behind
+		if (imageSequenceWriter.joinable())
+			ringChanged.wait(ringLock, [&]() { return presentedFrames - writtenFrames < RS_HEADLESS_RING_SIZE; });
+		memcpy(ringFrames[presentedFrames % RS_HEADLESS_RING_SIZE].data(), _argbPixels, _numPixels << 2);
+		++presentedFrames;
+	}
+	ringChanged.notify_all();
+#if defined(__linux__)
+	// the shared slots only hold whole frames
+	if (_numPixels == ringWidth * ringHeight)
+		sharedFrames.Publish(_argbPixels);
+#endif
+	return true;
+}
+
+// Finishes writing the image sequence and releases the ring
+bool RS_Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> ringLock(ringMutex);
+		writerStopping = true;
+	}
+	ringChanged.notify_all();
+	if (imageSequenceWriter.joinable())
+		imageSequenceWriter.join();
+#if defined(__linux__)
+	sharedFrames.Close();
+#endif
+	for (std::vector<unsigned int>& frame : ringFrames)
+		std::vector<unsigned int>().swap(frame);
+	return true;
+}
+
+// Hands the caller's buffers to the RasterSurface, they all start out free to draw into.
+bool RS_CreateSwapChain(_In_reads_(_count) unsigned int* const* _buffers,
+						_In_range_(2, RS_MAX_SWAP_CHAIN_LENGTH) unsigned int _count)
+{
+	if (_count < 2 || _count > RS_MAX_SWAP_CHAIN_LENGTH) return false;
+	for (unsigned int i = 0; i < _count; ++i)
+		swapChainFreeQueue.Push(_buffers[i]);
+	return true;
+}
+
+unsigned int* RS_AcquireBackBuffer()
+{
+	unsigned int* backBuffer = nullptr;
+	if (interrupted || !swapChainFreeQueue.Pop(backBuffer)) return nullptr;
+	return backBuffer;
+}
+
+// Nothing is shown, so the frame goes into the read back ring like RS_Update and the buffer is free again right away
+bool RS_Present(_In_ unsigned int* _backBuffer)
+{
+	bool presented = RS_Update(_backBuffer, ringWidth * ringHeight);
+	swapChainFreeQueue.Push(_backBuffer);
+	return presented;
+}
+
+unsigned int RS_GetFrameCount()
+{
+	std::lock_guard<std::mutex> ringLock(ringMutex);
+	return presentedFrames;
+}
+
+bool RS_ReadFrame(	unsigned int _frameIndex,
+					_Out_writes_(_numPixels) unsigned int *_xrgbPixels,
+					_In_range_(1, 0xFFFFFFFF) unsigned int _numPixels)
+{
+	std::lock_guard<std::mutex> ringLock(ringMutex);
+	if (_frameIndex >= presentedFrames || presentedFrames - _frameIndex > RS_HEADLESS_RING_SIZE) return false;
+	if (_numPixels > ringWidth * ringHeight) return false;
+	memcpy(_xrgbPixels, ringFrames[_frameIndex % RS_HEADLESS_RING_SIZE].data(), _numPixels << 2);
+	return true;
+}
+#endif // RS_HEADLESS
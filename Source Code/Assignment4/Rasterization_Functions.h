@@ -1,54 +1,101 @@
 #pragma once
+#include "RenderContext.h"
+#include "FrameProfiler.h"
 #include "Graphics/Shaders.h"
+#include "Graphics/TexCoordGradients.h"
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <atomic>
 
-enum class RenderFrameMode
+Vertex* starsVertices = new Vertex[STARS_COUNT];
+
+Vertex* stoneHedgeVertices = new Vertex[1457];
+
+/* Shader pipeline of a draw fixed at compile time, every permutation of shaders, filter and mode gets its own fill loops
+*  with the shaders inlined and the mode / filter branches folded away
+*/
+template<VertexShaderFunction VS, PixelShaderFunction PS, TextureFilter Filter, RenderFrameMode Mode>
+struct StaticPipeline
 {
-	WireFrame,
-	Textured,
-	Shaded /* Lighting calculated color gets drawn */
-};
+	inline static bool HasVertexShader(const RenderContext& context) { return VS != nullptr; }
+	inline static void VertexShader(const RenderContext& context, Vertex& vertex) { VS(context, vertex); }
 
-unsigned int* pixels = new unsigned int[TOTAL_PIXELS];
-float* depthBuffer = new float[TOTAL_PIXELS];
+	inline static bool HasPixelShader(const RenderContext& context) { return PS != nullptr; }
 
-Vertex* starsVertices = new Vertex[STARS_COUNT];
+	/* PS_Texture is swapped for the variant of this pipeline's filter */
+	inline static void PixelShader(const RenderContext& context, const PixelShaderInput& input, unsigned int& pixel)
+	{
+		if (IsTextured(context)) { PS_TextureFiltered<Filter>(context, input, pixel); }
+		else { PS(context, input, pixel); }
+	}
 
-Vertex* stoneHedgeVertices = new Vertex[1457];
+	inline static bool IsTextured(const RenderContext& context) { return PS == PS_Texture; }
+	inline static bool IsShaded(const RenderContext& context) { return Mode == RenderFrameMode::Shaded; }
+	inline static TextureFilter GetTextureFilter(const RenderContext& context) { return Filter; }
+};
 
-Vector3D worldCameraFowardVector;
+/* Pipeline read from the context's shader state, used by draws without a StaticPipeline specialization */
+struct DynamicPipeline
+{
+	inline static bool HasVertexShader(const RenderContext& context) { return context.VertexShader != nullptr; }
+	inline static void VertexShader(const RenderContext& context, Vertex& vertex) { context.VertexShader(context, vertex); }
+
+	inline static bool HasPixelShader(const RenderContext& context) { return context.PixelShader != nullptr; }
+	inline static void PixelShader(const RenderContext& context, const PixelShaderInput& input, unsigned int& pixel) { context.PixelShader(context, input, pixel); }
 
-RenderFrameMode renderFrameMode;
+	inline static bool IsTextured(const RenderContext& context) { return context.PixelShader == PS_Texture; }
+	inline static bool IsShaded(const RenderContext& context) { return context.FrameMode == RenderFrameMode::Shaded; }
+	inline static TextureFilter GetTextureFilter(const RenderContext& context) { return context.SamplerFilter; }
+};
 
-bool bShowTriangleVertexNormals;
+const bool bAVX2Supported = SIMD::IsAVX2Supported();
 
 struct Rasterization
 {
 	/* Pixel Drawing*/
 private:
-	static void DrawPixel(unsigned int x, unsigned int y, float zDepthValue, unsigned int color)
+	/* Returns false if the pixel is off screen or fails the depth test */
+	static bool DrawPixel(RenderContext& context, unsigned int x, unsigned int y, float zDepthValue, unsigned int color)
 	{
 		unsigned int position = Math::Convert2DTo1D(x, y, RASTER_WIDTH);
-		if (position >= TOTAL_PIXELS) return;
-		if (zDepthValue > depthBuffer[position]) return;
+		if (position >= TOTAL_PIXELS) return false;
+		if (zDepthValue > context.DepthBuffer[position]) return false;
 
 		if ((color & ALPHA_CHANNEL) < ALPHA_CHANNEL)
 		{
-			color = Math::BlendColor(pixels[position], color);
+			color = Math::BlendColor(context.Pixels[position], color);
 		}
 
-		depthBuffer[position] = zDepthValue;
-		pixels[position] = color;
+		context.DepthBuffer[position] = zDepthValue;
+		context.Pixels[position] = color;
+		return true;
+	}
+
+	/* DrawPixel limited to the pixels of the rectangle minX, minY to maxX, maxY. The rectangle is tested where x and y land in the buffer,
+	*  so a tile fill writes exactly the pixels of its tile that DrawPixel would have written
+	*/
+	static bool DrawPixelInRect(RenderContext& context, unsigned int x, unsigned int y, float zDepthValue, unsigned int color, int minX, int minY, int maxX, int maxY)
+	{
+		unsigned int position = Math::Convert2DTo1D(x, y, RASTER_WIDTH);
+		if (position >= TOTAL_PIXELS) return false;
+
+		int positionX = static_cast<int>(position % RASTER_WIDTH);
+		int positionY = static_cast<int>(position / RASTER_WIDTH);
+		if (positionX < minX || positionX > maxX || positionY < minY || positionY > maxY) return false;
+
+		return DrawPixel(context, x, y, zDepthValue, color);
 	}
 
 public:
-	static void DrawPoint(Vertex& point)
+	static void DrawPoint(RenderContext& context, Vertex& point)
 	{
 		Vertex pointCopy = point;
 
-		if (VERTEX_SHADER)
+		if (context.VertexShader)
 		{
-			VERTEX_SHADER(pointCopy);
+			context.VertexShader(context, pointCopy);
 		}
 
 		pointCopy.PerspectiveDivide();
@@ -56,17 +103,17 @@ public:
 		IntPoint2D pointPos = Math::ConvertCartesianToScreen(pointCopy);
 
 		unsigned int colorCopy = point.Color;
-		if (PIXEL_SHADER)
+		if (context.PixelShader)
 		{
-			PIXEL_SHADER(colorCopy);
+			context.PixelShader(context, PixelShaderInput(), colorCopy);
 		}
 
-		DrawPixel(pointPos.X, pointPos.Y, pointCopy.Z, colorCopy);
+		DrawPixel(context, pointPos.X, pointPos.Y, pointCopy.Z, colorCopy);
 	}
 
 	/* Line Drawing */
 private:
-	static void DrawLineParametricX(Pixel3D& start, Pixel3D& end)
+	static void DrawLineParametricX(RenderContext& context, Pixel3D& start, Pixel3D& end, PixelShaderFunction pixelShader, int minX, int minY, int maxX, int maxY)
 	{
 		float ratio = 0.f;
 
@@ -81,21 +128,21 @@ private:
 		while (currentX != end.X)
 		{
 			unsigned int colorCopy = Math::LerpColor(start.Color, end.Color, ratio);
-			if (PIXEL_SHADER)
+			if (pixelShader)
 			{
-				PIXEL_SHADER(colorCopy);
+				pixelShader(context, PixelShaderInput(), colorCopy);
 			}
 
 			ratio = (static_cast<float>(currentX) - start.X) * deltaXRatioRecip;
 			currentY = Math::Lerp(start.Y, end.Y, ratio);
 
-			DrawPixel(currentX, std::floor(currentY + yIncrement), Math::Lerp(start.Z, end.Z, ratio), colorCopy);
+			DrawPixelInRect(context, currentX, std::floor(currentY + yIncrement), Math::Lerp(start.Z, end.Z, ratio), colorCopy, minX, minY, maxX, maxY);
 
 			currentX += xIncrement;
 		}
 	}
 
-	static void DrawLineParametricY(Pixel3D& start, Pixel3D& end)
+	static void DrawLineParametricY(RenderContext& context, Pixel3D& start, Pixel3D& end, PixelShaderFunction pixelShader, int minX, int minY, int maxX, int maxY)
 	{
 		float ratio = 0.f;
 
@@ -117,36 +164,37 @@ private:
 		while (currentY != end.Y)
 		{
 			unsigned int colorCopy = Math::LerpColor(start.Color, end.Color, ratio);
-			if (PIXEL_SHADER)
+			if (pixelShader)
 			{
-				PIXEL_SHADER(colorCopy);
+				pixelShader(context, PixelShaderInput(), colorCopy);
 			}
 
 			ratio = (static_cast<float>(currentY) - start.Y) * deltaYRatioRecip;
 			currentX = Math::Lerp(start.X, end.X, ratio);
 
-			DrawPixel(static_cast<unsigned int>(std::floor(currentX + xIncrement)), currentY, Math::Lerp(start.Z, end.Z, ratio), colorCopy);
+			DrawPixelInRect(context, static_cast<unsigned int>(std::floor(currentX + xIncrement)), currentY, Math::Lerp(start.Z, end.Z, ratio), colorCopy, minX, minY, maxX, maxY);
 
 			currentY += yIncrement;
 		}
 	}
 
-	static void DrawLineParametric(Pixel3D& start, Pixel3D& end)
+	/* Draws the pixels of the line inside minX, minY to maxX, maxY. DrawLineParametricY swaps the end points' Z, so pass copies to draw a line again */
+	static void DrawLineParametric(RenderContext& context, Pixel3D& start, Pixel3D& end, PixelShaderFunction pixelShader, int minX, int minY, int maxX, int maxY)
 	{
 		unsigned int deltaX = std::abs(static_cast<int>(end.X - start.X));
 		unsigned int deltaY = std::abs(static_cast<int>(end.Y - start.Y));
 
 		if (deltaX >= deltaY)
 		{
-			DrawLineParametricX(start, end);
+			DrawLineParametricX(context, start, end, pixelShader, minX, minY, maxX, maxY);
 		}
 		else
 		{
-			DrawLineParametricY(start, end);
+			DrawLineParametricY(context, start, end, pixelShader, minX, minY, maxX, maxY);
 		}
 	}
 
-	static void DrawLineInProjectionSpace(const Vertex& start, const Vertex& end)
+	static void DrawLineInProjectionSpace(RenderContext& context, const Vertex& start, const Vertex& end, PixelShaderFunction pixelShader)
 	{
 		Vertex startCopy = start;
 		Vertex endCopy = end;
@@ -166,10 +214,10 @@ private:
 		Pixel3D endPos = Pixel3D(Math::ConvertCartesianToScreen(endCopy), endCopy.Z, endCopy.Color);
 
 		// Draw line
-		DrawLineParametric(startPos, endPos);
+		DrawScreenLine(context, startPos, endPos, pixelShader);
 	}
 
-	static void DrawLineInNDCSpace(const Vertex& start, const Vertex& end)
+	static void DrawLineInNDCSpace(RenderContext& context, const Vertex& start, const Vertex& end, PixelShaderFunction pixelShader)
 	{
 		Vertex startCopy = start;
 		Vertex endCopy = end;
@@ -182,26 +230,38 @@ private:
 		Pixel3D endPos = Pixel3D(Math::ConvertCartesianToScreen(endCopy), endCopy.Z, endCopy.Color);
 
 		// Draw line
-		DrawLineParametric(startPos, endPos);
+		DrawScreenLine(context, startPos, endPos, pixelShader);
+	}
+
+	/* Draws a screen space line, or while triangles are being binned queues it behind them so it keeps its place in the draw order */
+	static void DrawScreenLine(RenderContext& context, Pixel3D& start, Pixel3D& end, PixelShaderFunction pixelShader)
+	{
+		if (context.bBinningTriangles)
+		{
+			BinLine(context, start, end, pixelShader);
+			return;
+		}
+
+		DrawLineParametric(context, start, end, pixelShader, 0, 0, RASTER_WIDTH - 1, RASTER_HEIGHT - 1);
 	}
 
 	/* Line Drawing */
 public:
 	/* Draws line in local space, argument vertices are in local space */
-	static void DrawLine(const Vertex& start, const Vertex& end)
+	static void DrawLine(RenderContext& context, const Vertex& start, const Vertex& end)
 	{
 		// Copy input data and send through shaders
 		Vertex startCopy = start;
 		Vertex endCopy = end;
 
 		// Use vertex shader to modify copies only
-		if (VERTEX_SHADER)
+		if (context.VertexShader)
 		{
-			VERTEX_SHADER(startCopy);
-			VERTEX_SHADER(endCopy);
+			context.VertexShader(context, startCopy);
+			context.VertexShader(context, endCopy);
 		}
 
-		DrawLineInProjectionSpace(startCopy, endCopy);
+		DrawLineInProjectionSpace(context, startCopy, endCopy, context.PixelShader);
 
 		/*// Clip Line In Projection Space -> discards the line if its behind the near plane
 		if (Math::ClipLineInProjectionSpace(startCopy, endCopy)) { return; }
@@ -218,226 +278,576 @@ public:
 		Pixel3D endPos = Pixel3D(Math::ConvertCartesianToScreen(endCopy), endCopy.Z, endCopy.Color);
 
 		// Draw line
-		DrawLineParametric(startPos, endPos);*/
+		DrawLineParametric(context, startPos, endPos, context.PixelShader);*/
 	}
 
+	/* Triangle Filling */
 private:
-	static void ReorderTexelsByAscendingY(Texel& a, Texel& b, Texel& c)
+	/* Depth testing before the pixel shader runs is only safe when the shader neither writes depth nor relies on alpha */
+	static bool IsEarlyDepthTestEnabled(RenderContext& context)
+	{
+		return (context.PixelShaderFlags & (PS_FLAGS_MODIFIES_DEPTH | PS_FLAGS_USES_ALPHA)) == 0;
+	}
+
+	static void AddFragmentStats(RenderContext& context, unsigned long long tested, unsigned long long depthTestFailed, unsigned long long shaded)
 	{
-		/* Reorder Vertices in Y Ascensing */
-		int minY = Math::Min(a.Y, Math::Min(b.Y, c.Y));
+		context.Stats.FragmentsTested += tested;
+		context.Stats.DepthTestFailed += depthTestFailed;
+		context.Stats.FragmentsShaded += shaded;
+	}
 
-		if (minY == b.Y) // b top
+	/* Shades the triangle pixel at x, y from its barycentric coordinates then draws it, false if it failed the (late) depth test */
+	template<class Pipeline>
+	static bool DrawTrianglePixel(RenderContext& context, Texel& a, Texel& b, Texel& c, int x, int y, float zDepthValue, Vector3D& alphaBetaGamma, Vector3D& linearZReciprocal, const TexCoordGradients& gradients)
+	{
+		if (Pipeline::IsShaded(context))
 		{
-			Texel aCopy(a.X, a.Y, a.Z, a.W, a.TexCoordU, a.TexCoordV, a.Color);
-			a = Texel(b.X, b.Y, b.Z, b.W, b.TexCoordU, b.TexCoordV, b.Color);
-			b = Texel(aCopy.X, aCopy.Y, aCopy.Z, aCopy.W, aCopy.TexCoordU, aCopy.TexCoordV, aCopy.Color);
+			unsigned int lightColor = Math::BlendColorsWithBarycentricCoordinates(a.Color, b.Color, c.Color, alphaBetaGamma);
+
+			return DrawPixel(context, x, y, zDepthValue, lightColor);
 		}
-		else if (minY == c.Y) // c top
+
+		unsigned int color = RED;
+		PixelShaderInput input;
+
+		if (!Pipeline::IsTextured(context))
 		{
-			Texel aCopy(a.X, a.Y, a.Z, a.W, a.TexCoordU, a.TexCoordV, a.Color);
-			a = Texel(c.X, c.Y, c.Z, c.W, c.TexCoordU, c.TexCoordV, c.Color);
-			c = Texel(aCopy.X, aCopy.Y, aCopy.Z, aCopy.W, aCopy.TexCoordU, aCopy.TexCoordV, aCopy.Color);
+			color = Math::BlendColorsWithBarycentricCoordinates(a.Color, b.Color, c.Color, alphaBetaGamma);
 		}
+		else
+		{
+			float recipLinearZ = Math::Berp(linearZReciprocal.X, linearZReciprocal.Y, linearZReciprocal.Z, alphaBetaGamma);
+			float interpolatedRecipLinearZ = (1.0f / recipLinearZ);
+
+			input.TexCoordU = Math::Berp(a.TexCoordU * linearZReciprocal.X, b.TexCoordU * linearZReciprocal.Y, c.TexCoordU * linearZReciprocal.Z, alphaBetaGamma);
+			input.TexCoordV = Math::Berp(a.TexCoordV * linearZReciprocal.X, b.TexCoordV * linearZReciprocal.Y, c.TexCoordV * linearZReciprocal.Z, alphaBetaGamma);
 
-		int maxY = Math::Max(b.Y, c.Y);
+			// Mipmap, from the texture coordinates of the pixel's quad
+			input.MipMapLod = gradients.GetLod(input.TexCoordU, input.TexCoordV, recipLinearZ, x, y);
 
-		if (maxY == b.Y) // b bottom
+			input.TexCoordU *= interpolatedRecipLinearZ;
+			input.TexCoordV *= interpolatedRecipLinearZ;
+		}
+
+		if (Pipeline::HasPixelShader(context))
 		{
-			Texel cCopy(c.X, c.Y, c.Z, c.W, c.TexCoordU, c.TexCoordV, c.Color);
-			c = Texel(b.X, b.Y, b.Z, b.W, b.TexCoordU, b.TexCoordV, b.Color);
-			b = Texel(cCopy.X, cCopy.Y, cCopy.Z, cCopy.W, cCopy.TexCoordU, cCopy.TexCoordV, cCopy.Color);
+			Pipeline::PixelShader(context, input, color);
 		}
+
+		unsigned int lightColor = Math::BlendColorsWithBarycentricCoordinates(a.Color, b.Color, c.Color, alphaBetaGamma);
+		color = Math::ModulateColors(color, lightColor);
+		//color = Math::ModulateColors(color, directionLightColor);
+
+		return DrawPixel(context, x, y, zDepthValue, color);
 	}
 
-	/* Triangle Filling */
-private:
-	/* All Triangle vertices should be in a clockwise ordering */
-	static void DrawFillTriangleBetterBrute(Texel& a, Texel& b, Texel& c)
+	/* Fills triangle abc with incremental half-space edge functions, only pixels inside [minX, maxX] x [minY, maxY] are written.
+	* The edge functions are set up once and stepped by addition per pixel and per row,
+	* so each tile of the binned rasterizer can be filled on its own thread without locking the color or depth buffer
+	*/
+	template<class Pipeline>
+	static void DrawFillTriangleHalfSpace(RenderContext& context, Texel& a, Texel& b, Texel& c, int minX, int minY, int maxX, int maxY)
 	{
-		int startX = Math::Min(Math::Min(a.X, b.X), c.X);
-		int startY = Math::Min(Math::Min(a.Y, b.Y), c.Y);
+		// Triangle bounding box clipped to the fill rect
+		int startX = Math::Max(minX, Math::Min(Math::Min(a.X, b.X), c.X));
+		int startY = Math::Max(minY, Math::Min(Math::Min(a.Y, b.Y), c.Y));
+
+		int endX = Math::Min(maxX, Math::Max(Math::Max(a.X, b.X), c.X));
+		int endY = Math::Min(maxY, Math::Max(Math::Max(a.Y, b.Y), c.Y));
+
+		if (startX > endX || startY > endY) { return; }
+
+		TriangleEdges edges(a, b, c);
+		if (edges.Area == 0) { return; } // degenerate triangle
+
+		EdgeFunction edgeBC = edges.BC;
+		EdgeFunction edgeCA = edges.CA;
+		EdgeFunction edgeAB = edges.AB;
+
+		float areaReciprocal = 1.0f / static_cast<float>(edges.Area);
+
+		/* Reciprocal linear Z */
+		Vector3D linearZReciprocal((1.0f / a.W), (1.0f / b.W), (1.0f / c.W));
 
-		int endX = Math::Max(Math::Max(a.X, b.X), c.X);
-		int endY = Math::Max(Math::Max(a.Y, b.Y), c.Y);
+		TexCoordGradients gradients(a, b, c, edges, context.TextureSampler);
 
-		Vector3D barycentricDistances = Math::CalculateBarycentricDistances(a, b, c);
-		Vector3D alphaBetaGamma;
-		float zValue = 1.0f;
+		bool bEarlyDepthTest = IsEarlyDepthTestEnabled(context);
+		unsigned long long tested = 0;
+		unsigned long long depthTestFailed = 0;
+		unsigned long long shaded = 0;
 
-		Vector3D recipLinearZ((1.0f / a.W), (1.0f / b.W), (1.0f / c.W));
+		/* Biased edge values at the start of the row, a pixel is inside when all three are >= 0 */
+		long long rowW0 = edgeBC.Evaluate(startX, startY) + edgeBC.Bias;
+		long long rowW1 = edgeCA.Evaluate(startX, startY) + edgeCA.Bias;
+		long long rowW2 = edgeAB.Evaluate(startX, startY) + edgeAB.Bias;
 
-		for (; startY < endY; startY++)
+		for (int y = startY; y <= endY; y++)
 		{
-			for (int x = startX; x < endX; x++)
+			long long w0 = rowW0;
+			long long w1 = rowW1;
+			long long w2 = rowW2;
+
+			bool bInsideRow = false;
+
+			for (int x = startX; x <= endX; x++)
 			{
-				if (Math::CalculateAndCheckBarycentricCoordsAndDistances(alphaBetaGamma, a, b, c, IntPoint2D(x, startY), barycentricDistances))
+				if ((w0 | w1 | w2) >= 0)
 				{
-					if (Math::IsBarycentricCoordsInTriangle(alphaBetaGamma))
+					// Barycentric coordinates come from the exact edge values so every tile produces identical pixels
+					Vector3D alphaBetaGamma((w0 - edgeBC.Bias) * areaReciprocal, (w1 - edgeCA.Bias) * areaReciprocal, (w2 - edgeAB.Bias) * areaReciprocal);
+
+					/* Pixel depth value for depth buffer */
+					float zDepthValue = Math::CalculateZDepthValueFromBarycentricCoords(a, b, c, alphaBetaGamma);
+					bInsideRow = true;
+					tested++;
+
+					// Early depth test, occluded pixels are thrown away before any attribute interpolation or shading
+					if (bEarlyDepthTest && zDepthValue > context.DepthBuffer[Math::Convert2DTo1D(x, y, RASTER_WIDTH)])
+					{
+						depthTestFailed++;
+					}
+					else
 					{
-						unsigned int color = RED;
-						if (PIXEL_SHADER != PS_Texture)
+						shaded++;
+						if (!DrawTrianglePixel<Pipeline>(context, a, b, c, x, y, zDepthValue, alphaBetaGamma, linearZReciprocal, gradients))
 						{
-							color = Math::BlendColorsWithBarycentricCoordinates(a.Color, b.Color, c.Color, alphaBetaGamma);
+							depthTestFailed++;
 						}
-						else
-						{
-							float interpolatedRecipLinearZ = (1.0f / Math::Berp(recipLinearZ.X, recipLinearZ.Y, recipLinearZ.Z, alphaBetaGamma));
+					}
+				}
+				else if (bInsideRow) // triangles are convex, nothing left on this row
+				{
+					break;
+				}
 
-							SV_TexCoordU = Math::Berp(a.TexCoordU * recipLinearZ.X, b.TexCoordU * recipLinearZ.Y, c.TexCoordU * recipLinearZ.Z, alphaBetaGamma);
-							SV_TexCoordV = Math::Berp(a.TexCoordV * recipLinearZ.X, b.TexCoordV * recipLinearZ.Y, c.TexCoordV * recipLinearZ.Z, alphaBetaGamma);
+				w0 += edgeBC.A;
+				w1 += edgeCA.A;
+				w2 += edgeAB.A;
+			}
 
-							SV_TexCoordU *= interpolatedRecipLinearZ;
-							SV_TexCoordV *= interpolatedRecipLinearZ;
-						}
+			rowW0 += edgeBC.B;
+			rowW1 += edgeCA.B;
+			rowW2 += edgeAB.B;
+		}
 
-						// Mipmap
-						float wDepthValue = Math::Berp(a.W, b.W, c.W, alphaBetaGamma);
-						float r = (wDepthValue - 0.1f) / (9.9f);
-						SV_MipMapLevel = (abs(r) * 9.0f);
+		AddFragmentStats(context, tested, depthTestFailed, shaded);
+	}
 
-						if (PIXEL_SHADER)
-						{
-							PIXEL_SHADER(color);
-						}
+#if SIMD_SSE2_AVAILABLE
+	/* Vertices further than this from the screen origin could overflow the 32 bit lanes of the block fill */
+	static const int BLOCK_FILL_COORDINATE_LIMIT = 8192;
 
-						zValue = Math::CalculateZDepthValueFromBarycentricCoords(a, b, c, alphaBetaGamma);
-						DrawPixel(x, startY, zValue, color);
-					}
-				}
-			}
+	/* Packs the per lane colors the same way Math::ModulateColors does for one color */
+	template<class Lanes>
+	static typename Lanes::Int ModulateColorBlock(typename Lanes::Int color1, typename Lanes::Int color2)
+	{
+		typedef typename Lanes::Float Float;
+		typedef typename Lanes::Int Int;
+
+		Float r = Lanes::Set(1.0f / 255.0f);
+		Float zero = Lanes::Set(0.0f);
+		Float one = Lanes::Set(1.0f);
+		Float scale = Lanes::Set(255.0f);
+		Int channelMask = Lanes::SetInt(0xff);
+
+		Int result = Lanes::SetInt(0);
+		for (int shift = 0; shift < 32; shift += 8)
+		{
+			Float channel1 = Lanes::Mul(Lanes::ToFloat(Lanes::And(Lanes::ShiftRight(color1, shift), channelMask)), r);
+			Float channel2 = Lanes::Mul(Lanes::ToFloat(Lanes::And(Lanes::ShiftRight(color2, shift), channelMask)), r);
+
+			Float channel = Lanes::Min(one, Lanes::Max(zero, Lanes::Mul(channel1, channel2)));
+			result = Lanes::Or(result, Lanes::ShiftLeft(Lanes::ToIntTruncate(Lanes::Mul(channel, scale)), shift));
 		}
+
+		return result;
 	}
 
-	static void DrawFillTriangleLariAlgorithm(Texel& a, Texel& b, Texel& c)
+	/* Barycentric interpolation of one value per vertex for every lane */
+	template<class Lanes>
+	static typename Lanes::Float BerpBlock(float inA, float inB, float inC, typename Lanes::Float alpha, typename Lanes::Float beta, typename Lanes::Float gamma)
 	{
-		ReorderTexelsByAscendingY(a, b, c);
+		return Lanes::Add(Lanes::Add(Lanes::Mul(Lanes::Set(inA), alpha), Lanes::Mul(Lanes::Set(inB), beta)), Lanes::Mul(Lanes::Set(inC), gamma));
+	}
 
-		/* Algorithm Variables*/
-		IntPoint2D currentPixel(a.X, a.Y);
+	/* Same as Math::BlendColorsWithBarycentricCoordinates for every lane */
+	template<class Lanes>
+	static typename Lanes::Int BlendColorsBlock(unsigned int color1, unsigned int color2, unsigned int color3, typename Lanes::Float alpha, typename Lanes::Float beta, typename Lanes::Float gamma)
+	{
+		typename Lanes::Int result = Lanes::SetInt(static_cast<int>(ALPHA_CHANNEL));
+		for (int shift = 0; shift < 24; shift += 8)
+		{
+			typename Lanes::Float channel = BerpBlock<Lanes>(static_cast<float>((color1 >> shift) & 0xff), static_cast<float>((color2 >> shift) & 0xff), static_cast<float>((color3 >> shift) & 0xff), alpha, beta, gamma);
+			result = Lanes::Or(result, Lanes::ShiftLeft(Lanes::ToIntTruncate(channel), shift));
+		}
 
-		/* Parametric line algorithm Variables*/
-		float ratio = 0.f;
-		float deltaYReciprocal_CA = 1.0f / (c.Y - a.Y); // Reciprocal of line ca's delta Y
+		return result;
+	}
 
-		/* calculate the line direction*/
-		int lineDirection = Math::ImplicitLine(c, a, b) > 0.0f ? 1 : -1;
+	/* Fills triangle abc Lanes::Width pixels at a time, produces the same pixels as DrawFillTriangleHalfSpace.
+	* Coverage, barycentrics, depth, the depth test, perspective correct UVs and lighting run for the whole block,
+	* textures are filtered for the whole block when it shares one mip level, everything else is shaded per pixel
+	*/
+	template<class Lanes, class Pipeline>
+	static void DrawFillTriangleBlocks(RenderContext& context, Texel& a, Texel& b, Texel& c, int minX, int minY, int maxX, int maxY)
+	{
+		typedef typename Lanes::Float Float;
+		typedef typename Lanes::Int Int;
+
+		// Triangle bounding box clipped to the fill rect
+		int startX = Math::Max(minX, Math::Min(Math::Min(a.X, b.X), c.X));
+		int startY = Math::Max(minY, Math::Min(Math::Min(a.Y, b.Y), c.Y));
+
+		int endX = Math::Min(maxX, Math::Max(Math::Max(a.X, b.X), c.X));
+		int endY = Math::Min(maxY, Math::Max(Math::Max(a.Y, b.Y), c.Y));
+
+		if (startX > endX || startY > endY) { return; }
+
+		TriangleEdges edges(a, b, c);
+		if (edges.Area == 0) { return; } // degenerate triangle
+
+		Float areaReciprocal = Lanes::Set(1.0f / static_cast<float>(edges.Area));
 
-		/* Calculate the barycentric distances */
-		Vector3D bDistances = Math::CalculateBarycentricDistances(a, b, c);
-		Vector3D alphaBetaGamma;
+		Int biasBC = Lanes::SetInt(static_cast<int>(edges.BC.Bias));
+		Int biasCA = Lanes::SetInt(static_cast<int>(edges.CA.Bias));
+		Int biasAB = Lanes::SetInt(static_cast<int>(edges.AB.Bias));
+
+		Int blockStepBC = Lanes::SetInt(static_cast<int>(edges.BC.A) * Lanes::Width);
+		Int blockStepCA = Lanes::SetInt(static_cast<int>(edges.CA.A) * Lanes::Width);
+		Int blockStepAB = Lanes::SetInt(static_cast<int>(edges.AB.A) * Lanes::Width);
 
 		/* Reciprocal linear Z */
 		Vector3D linearZReciprocal((1.0f / a.W), (1.0f / b.W), (1.0f / c.W));
 
-		float deltaNearFarPlanesReciprocal = (1.0f / (SV_FarPlane - SV_NearPlane));
+		TexCoordGradients gradients(a, b, c, edges, context.TextureSampler);
+
+		bool bShaded = Pipeline::IsShaded(context);
+		bool bTextured = Pipeline::IsTextured(context);
+
+		bool bEarlyDepthTest = IsEarlyDepthTestEnabled(context);
+		unsigned long long tested = 0;
+		unsigned long long depthTestFailed = 0;
+		unsigned long long shaded = 0;
 
-		// Clamp Triangle if outside NDC/Screen Space
-		currentPixel.Y = Math::Clamp(0, RASTER_HEIGHT, a.Y);
+		alignas(32) float texCoordU[Lanes::Width];
+		alignas(32) float texCoordV[Lanes::Width];
+		alignas(32) float zDepthValues[Lanes::Width];
+		alignas(32) float mipMapLods[Lanes::Width];
+		alignas(32) unsigned int mipMapLevels[Lanes::Width];
+		alignas(32) unsigned int colors[Lanes::Width];
 
-		while (currentPixel.Y != c.Y)
+		for (int y = startY; y <= endY; y++)
 		{
-			if (currentPixel.Y > RASTER_HEIGHT) { return; }
+			Int w0 = Lanes::SetIntSequence(static_cast<int>(edges.BC.Evaluate(startX, y) + edges.BC.Bias), static_cast<int>(edges.BC.A));
+			Int w1 = Lanes::SetIntSequence(static_cast<int>(edges.CA.Evaluate(startX, y) + edges.CA.Bias), static_cast<int>(edges.CA.A));
+			Int w2 = Lanes::SetIntSequence(static_cast<int>(edges.AB.Evaluate(startX, y) + edges.AB.Bias), static_cast<int>(edges.AB.A));
 
-			// Clamp X so it stays inside screen space
-			if (lineDirection > 0)
+			unsigned int rowPosition = Math::Convert2DTo1D(0, y, RASTER_WIDTH);
+			bool bInsideRow = false;
+
+			for (int x = startX; x <= endX; x += Lanes::Width)
 			{
-				if (currentPixel.X > (RASTER_WIDTH - 1))
+				int mask = Lanes::NonNegativeMask(Lanes::Or(Lanes::Or(w0, w1), w2));
+
+				int lanesLeft = endX - x + 1;
+				if (lanesLeft < Lanes::Width)
 				{
-					currentPixel.Y++;
-					ratio = static_cast<float>(currentPixel.Y - a.Y) * deltaYReciprocal_CA;
-					currentPixel.X = static_cast<unsigned int>(Math::Lerp(a.X, c.X, ratio));
+					mask &= (1 << lanesLeft) - 1;
+				}
 
+				w0 = Lanes::AddInt(w0, blockStepBC);
+				w1 = Lanes::AddInt(w1, blockStepCA);
+				w2 = Lanes::AddInt(w2, blockStepAB);
+
+				if (!mask)
+				{
+					if (bInsideRow) { break; } // triangles are convex, nothing left on this row
 					continue;
 				}
-				else if (currentPixel.X < 0.0f)
+				bInsideRow = true;
+
+				// Undo the step above, the edge values of this block are needed for its barycentric coordinates
+				Float alpha = Lanes::Mul(Lanes::ToFloat(Lanes::SubInt(Lanes::SubInt(w0, blockStepBC), biasBC)), areaReciprocal);
+				Float beta = Lanes::Mul(Lanes::ToFloat(Lanes::SubInt(Lanes::SubInt(w1, blockStepCA), biasCA)), areaReciprocal);
+				Float gamma = Lanes::Mul(Lanes::ToFloat(Lanes::SubInt(Lanes::SubInt(w2, blockStepAB), biasAB)), areaReciprocal);
+
+				Float zDepth = BerpBlock<Lanes>(a.Z, b.Z, c.Z, alpha, beta, gamma);
+				float* depth = &context.DepthBuffer[rowPosition + x];
+				tested += SIMD::CountLanes(mask);
+
+				// Early depth test, occluded pixels are thrown away before any attribute interpolation or shading
+				if (bEarlyDepthTest)
 				{
-					currentPixel.X = 0.0;
+					int visibleMask = mask & Lanes::LessEqualMask(zDepth, Lanes::MaskLoad(depth, mask));
+					depthTestFailed += SIMD::CountLanes(mask & ~visibleMask);
+
+					mask = visibleMask;
+					if (!mask) { continue; }
+				}
+				shaded += SIMD::CountLanes(mask);
+
+				Int lightColor = BlendColorsBlock<Lanes>(a.Color, b.Color, c.Color, alpha, beta, gamma);
+				Int color = lightColor;
+
+				if (!bShaded)
+				{
+					if (bTextured)
+					{
+						Float recipLinearZ = BerpBlock<Lanes>(linearZReciprocal.X, linearZReciprocal.Y, linearZReciprocal.Z, alpha, beta, gamma);
+						Float interpolatedRecipLinearZ = Lanes::Div(Lanes::Set(1.0f), recipLinearZ);
+
+						Float uOverW = BerpBlock<Lanes>(a.TexCoordU * linearZReciprocal.X, b.TexCoordU * linearZReciprocal.Y, c.TexCoordU * linearZReciprocal.Z, alpha, beta, gamma);
+						Float vOverW = BerpBlock<Lanes>(a.TexCoordV * linearZReciprocal.X, b.TexCoordV * linearZReciprocal.Y, c.TexCoordV * linearZReciprocal.Z, alpha, beta, gamma);
+
+						// Mipmap, from the texture coordinates of each pixel's quad
+						Float lod = gradients.GetLodBlock<Lanes>(uOverW, vOverW, recipLinearZ, x, y);
+
+						Float u = Lanes::Mul(uOverW, interpolatedRecipLinearZ);
+						Float v = Lanes::Mul(vOverW, interpolatedRecipLinearZ);
+
+						// Trilinear filtering blends the level below the lod with the one above, the others sample the closest level
+						bool bTrilinear = (Pipeline::GetTextureFilter(context) == TextureFilter::TRILINEAR);
+						Lanes::Store(mipMapLods, lod);
+						Lanes::StoreInt(mipMapLevels, Lanes::ToIntTruncate(bTrilinear ? lod : Lanes::Add(lod, Lanes::Set(0.5f))));
+
+						bool bSharedLevel = true;
+						unsigned int blockMipMapLevel = 0;
+						for (int i = 0; i < Lanes::Width && bSharedLevel; i++)
+						{
+							if (!(mask & (1 << i))) { continue; }
+
+							if (blockMipMapLevel == 0) { blockMipMapLevel = mipMapLevels[i] + 1; }
+							bSharedLevel = (mipMapLevels[i] + 1 == blockMipMapLevel);
+						}
+
+						if (bSharedLevel && (blockMipMapLevel - 1) <= context.TextureSampler.MaxLevel)
+						{
+							const MipLevel& level = context.TextureSampler.GetLevel(blockMipMapLevel - 1);
+
+							if (Pipeline::GetTextureFilter(context) == TextureFilter::NEAREST)
+							{
+								color = Sampler::SampleNearestBlock<Lanes>(level, u, v, mask);
+							}
+							else if (!bTrilinear || blockMipMapLevel - 1 == context.TextureSampler.MaxLevel)
+							{
+								// The lod never goes past the last level, so there is nothing above it to blend in
+								color = Sampler::SampleBilinearBlock<Lanes>(level, u, v, mask);
+							}
+							else
+							{
+								Float ratio = Lanes::Sub(lod, Lanes::Set(static_cast<float>(blockMipMapLevel - 1)));
+								color = Sampler::SampleTrilinearBlock<Lanes>(level, context.TextureSampler.GetLevel(blockMipMapLevel), u, v, ratio, mask);
+							}
+						}
+						else
+						{
+							Lanes::Store(texCoordU, u);
+							Lanes::Store(texCoordV, v);
+
+							for (int i = 0; i < Lanes::Width; i++)
+							{
+								if (!(mask & (1 << i))) { continue; }
+
+								PixelShaderInput input;
+								input.TexCoordU = texCoordU[i];
+								input.TexCoordV = texCoordV[i];
+								input.MipMapLod = mipMapLods[i];
+
+								colors[i] = RED;
+								Pipeline::PixelShader(context, input, colors[i]);
+							}
+
+							color = Lanes::LoadInt(colors);
+						}
+					}
+					else if (Pipeline::HasPixelShader(context))
+					{
+						Lanes::StoreInt(colors, color);
+						for (int i = 0; i < Lanes::Width; i++)
+						{
+							if (mask & (1 << i)) { Pipeline::PixelShader(context, PixelShaderInput(), colors[i]); }
+						}
+						color = Lanes::LoadInt(colors);
+					}
+
+					color = ModulateColorBlock<Lanes>(color, lightColor);
+				}
+
+				// Translucent pixels have to blend with what is already there, leave those to DrawPixel
+				int blendMask = mask & Lanes::LessThanMaskUnsigned(Lanes::ShiftRight(color, 24), Lanes::SetInt(0xff));
+				if (blendMask)
+				{
+					Lanes::Store(zDepthValues, zDepth);
+					Lanes::StoreInt(colors, color);
+
+					for (int i = 0; i < Lanes::Width; i++)
+					{
+						if ((blendMask & (1 << i)) && !DrawPixel(context, x + i, y, zDepthValues[i], colors[i])) { depthTestFailed++; }
+					}
+					mask &= ~blendMask;
+				}
+
+				// Late depth test, a pixel is kept when it is not further away than what is in the depth buffer
+				if (!bEarlyDepthTest)
+				{
+					int visibleMask = mask & Lanes::LessEqualMask(zDepth, Lanes::MaskLoad(depth, mask));
+					depthTestFailed += SIMD::CountLanes(mask & ~visibleMask);
+					mask = visibleMask;
+				}
+
+				if (mask)
+				{
+					Lanes::MaskStore(depth, zDepth, mask);
+					Lanes::MaskStoreInt(&context.Pixels[rowPosition + x], color, mask);
 				}
 			}
-			else if (currentPixel.X >= RASTER_WIDTH)
+		}
+
+		AddFragmentStats(context, tested, depthTestFailed, shaded);
+	}
+
+#if SIMD_AVX2_AVAILABLE
+	/* DrawFillTriangleBlocks<AVX2Lanes>, compiled for AVX2 */
+	template<class Pipeline>
+	SIMD_AVX2_ENTRY static void DrawFillTriangleBlocksAVX2(RenderContext& context, Texel& a, Texel& b, Texel& c, int minX, int minY, int maxX, int maxY)
+	{
+		DrawFillTriangleBlocks<AVX2Lanes, Pipeline>(context, a, b, c, minX, minY, maxX, maxY);
+	}
+#endif
+#endif // SIMD_SSE2_AVAILABLE
+
+	/* Fills triangle abc inside [minX, maxX] x [minY, maxY] with the selected fill path */
+	template<class Pipeline>
+	static void DrawFillTriangleRect(RenderContext& context, Texel& a, Texel& b, Texel& c, int minX, int minY, int maxX, int maxY)
+	{
+#if SIMD_SSE2_AVAILABLE
+		int limit = BLOCK_FILL_COORDINATE_LIMIT;
+		bool bInBlockRange = std::abs(a.X) <= limit && std::abs(a.Y) <= limit && std::abs(b.X) <= limit
+			&& std::abs(b.Y) <= limit && std::abs(c.X) <= limit && std::abs(c.Y) <= limit;
+
+		if (bInBlockRange)
+		{
+#if SIMD_AVX2_AVAILABLE
+			if (context.TriangleFillPath == FillPath::AVX2 && bAVX2Supported)
 			{
-				currentPixel.X = RASTER_WIDTH - 1;
+				DrawFillTriangleBlocksAVX2<Pipeline>(context, a, b, c, minX, minY, maxX, maxY);
+				return;
 			}
-			else if (currentPixel.X < 0.0f)
+#endif
+			if (context.TriangleFillPath != FillPath::Scalar)
 			{
-				currentPixel.Y++;
-				ratio = static_cast<float>(currentPixel.Y - a.Y) * deltaYReciprocal_CA;
-				currentPixel.X = Math::Clamp(0, RASTER_WIDTH - 1, static_cast<int>(Math::Lerp(a.X, c.X, ratio)));
-
-				continue;
+				DrawFillTriangleBlocks<SSE2Lanes, Pipeline>(context, a, b, c, minX, minY, maxX, maxY);
+				return;
 			}
+		}
+#endif // SIMD_SSE2_AVAILABLE
 
-			alphaBetaGamma = Math::CalculateBarycentricCoords(a, b, c, currentPixel);
-			alphaBetaGamma /= bDistances;
+		DrawFillTriangleHalfSpace<Pipeline>(context, a, b, c, minX, minY, maxX, maxY);
+	}
 
-			if (alphaBetaGamma.Y < 0.0f) // out side line ab 
+	/* Hierarchical Z only rejects pixels the per pixel depth test would reject, which no longer holds once the shader writes depth */
+	static bool IsHierarchicalDepthTestEnabled(RenderContext& context)
+	{
+		return context.bHierarchicalDepthTest && (context.PixelShaderFlags & PS_FLAGS_MODIFIES_DEPTH) == 0;
+	}
+
+	/* Furthest depth in the depth tile, recomputed from the depth buffer if the tile was written to since last time */
+	static float GetHierarchicalMaxDepth(RenderContext& context, int tileX, int tileY)
+	{
+		unsigned int tile = Math::Convert2DTo1D(tileX, tileY, HIZ_TILE_COUNT_X);
+		if (!context.HiZDirty[tile]) { return context.HiZMaxDepth[tile]; }
+
+		int startX = tileX * HIZ_TILE_SIZE;
+		int startY = tileY * HIZ_TILE_SIZE;
+		int endX = Math::Min(startX + HIZ_TILE_SIZE, RASTER_WIDTH);
+		int endY = Math::Min(startY + HIZ_TILE_SIZE, RASTER_HEIGHT);
+
+		float maxDepth = 0.0f;
+		for (int y = startY; y < endY; y++)
+		{
+			const float* depth = &context.DepthBuffer[Math::Convert2DTo1D(0, y, RASTER_WIDTH)];
+			for (int x = startX; x < endX; x++)
 			{
-				currentPixel.X += lineDirection;
+				maxDepth = Math::Max(maxDepth, depth[x]);
 			}
-			else if ((alphaBetaGamma.X >= 0.0f && alphaBetaGamma.X <= 1.0f)
-				&& (alphaBetaGamma.Y >= 0.0f && alphaBetaGamma.Y <= 1.0f)
-				&& (alphaBetaGamma.Z >= 0.0f && alphaBetaGamma.Z <= 1.0f)) // draw pixel since point is in the triangle
-			{
-				if (renderFrameMode == RenderFrameMode::Shaded)
-				{
-					float zDepthValue = Math::CalculateZDepthValueFromBarycentricCoords(a, b, c, alphaBetaGamma);
-					unsigned int lightColor = Math::BlendColorsWithBarycentricCoordinates(a.Color, b.Color, c.Color, alphaBetaGamma);
+		}
 
-					DrawPixel(currentPixel.X, currentPixel.Y, zDepthValue, lightColor);
-					currentPixel.X += lineDirection;
+		context.HiZMaxDepth[tile] = maxDepth;
+		context.HiZDirty[tile] = false;
+		return maxDepth;
+	}
 
-					continue;
-				}
+	/* Fills triangle abc inside [minX, maxX] x [minY, maxY].
+	* The rect is walked one row of depth tiles at a time, tiles the triangle's nearest vertex is still behind are skipped
+	* and each run of remaining tiles is filled in one go, a triangle hidden behind earlier geometry never visits a pixel.
+	* A screen tile of the binned rasterizer holds whole depth tiles, so workers never share hierarchical Z entries
+	*/
+	template<class Pipeline>
+	static void DrawFillTriangle(RenderContext& context, Texel& a, Texel& b, Texel& c, int minX, int minY, int maxX, int maxY)
+	{
+		// Triangle bounding box clipped to the fill rect
+		int startX = Math::Max(minX, Math::Min(Math::Min(a.X, b.X), c.X));
+		int startY = Math::Max(minY, Math::Min(Math::Min(a.Y, b.Y), c.Y));
 
-				unsigned int color = RED;
-				if (PIXEL_SHADER != PS_Texture)
-				{
-					color = Math::BlendColorsWithBarycentricCoordinates(a.Color, b.Color, c.Color, alphaBetaGamma);
-				}
-				else
-				{
-					float interpolatedRecipLinearZ = (1.0f / Math::Berp(linearZReciprocal.X, linearZReciprocal.Y, linearZReciprocal.Z, alphaBetaGamma));
+		int endX = Math::Min(maxX, Math::Max(Math::Max(a.X, b.X), c.X));
+		int endY = Math::Min(maxY, Math::Max(Math::Max(a.Y, b.Y), c.Y));
+
+		if (startX > endX || startY > endY) { return; }
 
-					SV_TexCoordU = Math::Berp(a.TexCoordU * linearZReciprocal.X, b.TexCoordU * linearZReciprocal.Y, c.TexCoordU * linearZReciprocal.Z, alphaBetaGamma);
-					SV_TexCoordV = Math::Berp(a.TexCoordV * linearZReciprocal.X, b.TexCoordV * linearZReciprocal.Y, c.TexCoordV * linearZReciprocal.Z, alphaBetaGamma);
+		if (!IsHierarchicalDepthTestEnabled(context))
+		{
+			DrawFillTriangleRect<Pipeline>(context, a, b, c, startX, startY, endX, endY);
+			return;
+		}
 
-					SV_TexCoordU *= interpolatedRecipLinearZ;
-					SV_TexCoordV *= interpolatedRecipLinearZ;
+		/* Depth is interpolated linearly in screen space, no pixel of the triangle is nearer than its nearest vertex */
+		float nearestZ = Math::Min(Math::Min(a.Z, b.Z), c.Z);
+		unsigned long long killedTiles = 0;
 
-					// Mipmap
-					float wDepthValue = Math::Berp(a.W, b.W, c.W, alphaBetaGamma);
-					float r = (wDepthValue - 0.1f) * deltaNearFarPlanesReciprocal;
-					SV_MipMapLevel = static_cast<unsigned int>(r * static_cast<float>(SV_MaxMipMapLevel));
-				}
+		int firstTileX = startX / HIZ_TILE_SIZE;
+		int lastTileX = endX / HIZ_TILE_SIZE;
 
-				/* Pixel depth value for depth buffer */
-				float zDepthValue = Math::CalculateZDepthValueFromBarycentricCoords(a, b, c, alphaBetaGamma);
+		for (int tileY = startY / HIZ_TILE_SIZE; tileY <= endY / HIZ_TILE_SIZE; tileY++)
+		{
+			int rowStartY = Math::Max(startY, tileY * HIZ_TILE_SIZE);
+			int rowEndY = Math::Min(endY, tileY * HIZ_TILE_SIZE + HIZ_TILE_SIZE - 1);
 
-				if (PIXEL_SHADER)
+			int runStartTileX = -1;
+			for (int tileX = firstTileX; tileX <= lastTileX + 1; tileX++)
+			{
+				// One past the last tile closes the final run
+				bool bVisible = (tileX <= lastTileX) && nearestZ <= GetHierarchicalMaxDepth(context, tileX, tileY);
+				if (bVisible)
 				{
-					PIXEL_SHADER(color);
+					if (runStartTileX < 0) { runStartTileX = tileX; }
+					continue;
 				}
 
-				unsigned int lightColor = Math::BlendColorsWithBarycentricCoordinates(a.Color, b.Color, c.Color, alphaBetaGamma);
-				color = Math::ModulateColors(color, lightColor);
-				//color = Math::ModulateColors(color, directionLightColor);
+				if (tileX <= lastTileX) { killedTiles++; }
+				if (runStartTileX < 0) { continue; }
 
-				DrawPixel(currentPixel.X, currentPixel.Y, zDepthValue, color);
-				currentPixel.X += lineDirection;
-			}
-			else
-			{
-				currentPixel.Y++;
-				ratio = static_cast<float>(currentPixel.Y - a.Y) * deltaYReciprocal_CA;
-				currentPixel.X = static_cast<unsigned int>(Math::Lerp(a.X, c.X, ratio));
+				int runStartX = Math::Max(startX, runStartTileX * HIZ_TILE_SIZE);
+				int runEndX = Math::Min(endX, tileX * HIZ_TILE_SIZE - 1);
+				DrawFillTriangleRect<Pipeline>(context, a, b, c, runStartX, rowStartY, runEndX, rowEndY);
+
+				for (int i = runStartTileX; i < tileX; i++)
+				{
+					context.HiZDirty[Math::Convert2DTo1D(i, tileY, HIZ_TILE_COUNT_X)] = true;
+				}
+				runStartTileX = -1;
 			}
 		}
+
+		if (killedTiles)
+		{
+			context.Stats.HierarchicalDepthKilledTiles += killedTiles;
+		}
 	}
 
 	/* Triangle Drawing */
 private:
-	static void DrawTriangleInProjectionSpace(const Vertex& a, const Vertex& b, const Vertex& c)
+	template<class Pipeline>
+	static void DrawTriangleInProjectionSpace(RenderContext& context, const Vertex& a, const Vertex& b, const Vertex& c)
 	{
 		Vertex aCopy = a;
 		Vertex bCopy = b;
@@ -454,53 +864,54 @@ private:
 
 		Vector3D perpVec = Vector3D::CrossProduct((vecA - vecB), (vecA - vecC));
 		perpVec.Normalize();
-		if (Vector3D::DotProduct(perpVec, worldCameraFowardVector) >= 0) { return; }
+		if (Vector3D::DotProduct(perpVec, context.CameraForwardVector) >= 0)
+		{
+			context.Stats.TrianglesBackFaceCulled++;
+			return;
+		}
 
 		// Convert 2D cartesian coordinates to screen coordinates
 		Texel aPos = Texel(Math::ConvertCartesianToScreen(aCopy), aCopy.Z, aCopy.W, a.TexCoordU, a.TexCoordV, a.Color);
 		Texel bPos = Texel(Math::ConvertCartesianToScreen(bCopy), bCopy.Z, bCopy.W, b.TexCoordU, b.TexCoordV, b.Color);
 		Texel cPos = Texel(Math::ConvertCartesianToScreen(cCopy), cCopy.Z, cCopy.W, c.TexCoordU, c.TexCoordV, c.Color);
 
-		// Fill Triangle
-		DrawFillTriangleLariAlgorithm(aPos, bPos, cPos);
+		// Fill Triangle, or defer it to the tiles it touches
+		if (context.bBinningTriangles)
+		{
+			BinTriangle(context, aPos, bPos, cPos);
+		}
+		else
+		{
+			DrawFillTriangle<Pipeline>(context, aPos, bPos, cPos, 0, 0, RASTER_WIDTH - 1, RASTER_HEIGHT - 1);
+		}
 
 		// Outline the triangles being drawn
 #if SHOW_TRIANGLE_OUTLINES
-		auto pixelShaderTemp = PIXEL_SHADER;
-		PIXEL_SHADER = PS_GreenColor;
-
 		/* Move lines Z position 25% closer so depth buffer will allow them to be drawn infront of triangle*/
 		aCopy.Z -= aCopy.Z * 0.25f;
 		bCopy.Z -= bCopy.Z * 0.25f;
 		cCopy.Z -= cCopy.Z * 0.25f;
 
 		// Draw Triangle outline
-		DrawLineInNDCSpace(aCopy, bCopy);
-		DrawLineInNDCSpace(bCopy, cCopy);
-		DrawLineInNDCSpace(aCopy, cCopy);
-
-		PIXEL_SHADER = pixelShaderTemp;
+		DrawLineInNDCSpace(context, aCopy, bCopy, PS_GreenColor);
+		DrawLineInNDCSpace(context, bCopy, cCopy, PS_GreenColor);
+		DrawLineInNDCSpace(context, aCopy, cCopy, PS_GreenColor);
 #endif // SHOW_TRIANGLE_OUTLINES
 
-		if (bShowTriangleVertexNormals)
+		if (context.bShowTriangleVertexNormals)
 		{
-			auto pixelShaderTemp = PIXEL_SHADER;
-			PIXEL_SHADER = PS_RedColor;
-
 			float normalLengthScale = 0.15f;
 			aCopy = a + (a.Normal * normalLengthScale);
 			bCopy = b + (b.Normal * normalLengthScale);
 			cCopy = c + (c.Normal * normalLengthScale);
 
-			DrawLineInProjectionSpace(a, aCopy);
-			DrawLineInProjectionSpace(b, bCopy);
-			DrawLineInProjectionSpace(c, cCopy);
-
-			PIXEL_SHADER = pixelShaderTemp;
+			DrawLineInProjectionSpace(context, a, aCopy, PS_RedColor);
+			DrawLineInProjectionSpace(context, b, bCopy, PS_RedColor);
+			DrawLineInProjectionSpace(context, c, cCopy, PS_RedColor);
 		}
 	}
 
-	static void DrawTriangleOutlineInProjectionSpace(const Vertex& a, const Vertex& b, const Vertex& c)
+	static void DrawTriangleOutlineInProjectionSpace(RenderContext& context, const Vertex& a, const Vertex& b, const Vertex& c)
 	{
 		Vertex aCopy = a;
 		Vertex bCopy = b;
@@ -517,35 +928,34 @@ private:
 
 		Vector3D perpVec = Vector3D::CrossProduct((vecA - vecB), (vecA - vecC));
 		perpVec.Normalize();
-		if (Vector3D::DotProduct(perpVec, worldCameraFowardVector) >= 0) { return; }
+		if (Vector3D::DotProduct(perpVec, context.CameraForwardVector) >= 0)
+		{
+			context.Stats.TrianglesBackFaceCulled++;
+			return;
+		}
 
 		// Draw Triangle
-		DrawLineInNDCSpace(aCopy, bCopy);
-		DrawLineInNDCSpace(bCopy, cCopy);
-		DrawLineInNDCSpace(aCopy, cCopy);
+		DrawLineInNDCSpace(context, aCopy, bCopy, context.PixelShader);
+		DrawLineInNDCSpace(context, bCopy, cCopy, context.PixelShader);
+		DrawLineInNDCSpace(context, aCopy, cCopy, context.PixelShader);
 
 		/* Shows the vertex normals of the triangles vertices */
-		if (bShowTriangleVertexNormals)
+		if (context.bShowTriangleVertexNormals)
 		{
-			auto pixelShaderTemp = PIXEL_SHADER;
-			PIXEL_SHADER = PS_RedColor;
-
 			float normalLengthScale = 0.15f;
 			aCopy = a + (a.Normal * normalLengthScale);
 			bCopy = b + (b.Normal * normalLengthScale);
 			cCopy = c + (c.Normal * normalLengthScale);
 
-			DrawLineInProjectionSpace(a, aCopy);
-			DrawLineInProjectionSpace(b, bCopy);
-			DrawLineInProjectionSpace(c, cCopy);
-
-			PIXEL_SHADER = pixelShaderTemp;
+			DrawLineInProjectionSpace(context, a, aCopy, PS_RedColor);
+			DrawLineInProjectionSpace(context, b, bCopy, PS_RedColor);
+			DrawLineInProjectionSpace(context, c, cCopy, PS_RedColor);
 		}
 	}
 
 	/* Triangle Drawing */
 public:
-	static void DrawTriangleOutline(const Vertex& a, const Vertex& b, const Vertex& c)
+	static void DrawTriangleOutline(RenderContext& context, const Vertex& a, const Vertex& b, const Vertex& c)
 	{
 		// Copy input data and send through shaders
 		Vertex aCopy = a;
@@ -553,11 +963,11 @@ public:
 		Vertex cCopy = c;
 
 		// Use vertex shader to modify copies only
-		if (VERTEX_SHADER)
+		if (context.VertexShader)
 		{
-			VERTEX_SHADER(aCopy);
-			VERTEX_SHADER(bCopy);
-			VERTEX_SHADER(cCopy);
+			context.VertexShader(context, aCopy);
+			context.VertexShader(context, bCopy);
+			context.VertexShader(context, cCopy);
 		}
 
 		// Triangle clipping in projection space
@@ -586,8 +996,8 @@ public:
 				Math::ClipLineZByParametricRatio(bCopy, aCopy);
 				Math::ClipLineZByParametricRatio(cCopy, splitA);
 
-				//DrawTriangleInProjectionSpace(aCopy, bCopy, cCopy);
-				DrawTriangleOutlineInProjectionSpace(aCopy, cCopy, splitA);
+				//DrawTriangleInProjectionSpace(context, aCopy, bCopy, cCopy);
+				DrawTriangleOutlineInProjectionSpace(context, aCopy, cCopy, splitA);
 			}
 		}
 		else if (vertBClipCheck) // vert B is behind near plane, split both lines cb, ab
@@ -605,8 +1015,8 @@ public:
 				Math::ClipLineZByParametricRatio(cCopy, bCopy);
 				Math::ClipLineZByParametricRatio(aCopy, splitB);
 
-				//DrawTriangleInProjectionSpace(bCopy, cCopy, aCopy);
-				DrawTriangleOutlineInProjectionSpace(bCopy, aCopy, splitB);
+				//DrawTriangleInProjectionSpace(context, bCopy, cCopy, aCopy);
+				DrawTriangleOutlineInProjectionSpace(context, bCopy, aCopy, splitB);
 			}
 		}
 		else if (vertCClipCheck) // vert C is behind near plane, split both lines ac, bc
@@ -617,122 +1027,493 @@ public:
 			Math::ClipLineZByParametricRatio(aCopy, cCopy);
 			Math::ClipLineZByParametricRatio(bCopy, splitC);
 
-			//DrawTriangleInProjectionSpace(cCopy, aCopy, bCopy);
-			DrawTriangleOutlineInProjectionSpace(cCopy, bCopy, splitC);
+			//DrawTriangleInProjectionSpace(context, cCopy, aCopy, bCopy);
+			DrawTriangleOutlineInProjectionSpace(context, cCopy, bCopy, splitC);
 		}
 
 		//PIXEL_SHADER = PS_GreenColor;
-		DrawTriangleOutlineInProjectionSpace(aCopy, bCopy, cCopy);
+		DrawTriangleOutlineInProjectionSpace(context, aCopy, bCopy, cCopy);
 	}
 
-	static void DrawTriangle(const Vertex& a, const Vertex& b, const Vertex& c)
+private:
+	/* Clips a triangle whose vertices already went through the vertex shader against the frustum then draws it as a fan */
+	template<class Pipeline>
+	static void DrawTriangleInClipSpace(RenderContext& context, const Vertex& a, const Vertex& b, const Vertex& c)
 	{
-		// Copy input data and send through shaders
-		Vertex aCopy = a;
-		Vertex bCopy = b;
-		Vertex cCopy = c;
+		int count = context.TriangleClipper.ClipTriangle(a, b, c);
+		const Vertex* polygon = context.TriangleClipper.GetVertices();
 
-		// Use vertex shader to modify copies only
-		if (VERTEX_SHADER)
+		if (context.TriangleClipper.WasClipped())
 		{
-			VERTEX_SHADER(aCopy);
-			VERTEX_SHADER(bCopy);
-			VERTEX_SHADER(cCopy);
+			context.Stats.TrianglesClipped++;
 		}
 
-		// Triangle clipping in projection space
-		bool vertAClipCheck = aCopy.Z < 0.0f;
-		bool vertBClipCheck = bCopy.Z < 0.0f;
-		bool vertCClipCheck = cCopy.Z < 0.0f;
+		for (int i = 2; i < count; i++)
+		{
+			DrawTriangleInProjectionSpace<Pipeline>(context, polygon[0], polygon[i - 1], polygon[i]);
+		}
+	}
 
-		if (vertAClipCheck)
+	/* Vertex shaded copy of vertices[index] for the current indexed draw, the shader only runs the first time an index is seen */
+	template<class Pipeline>
+	static const Vertex& GetTransformedVertex(RenderContext& context, const Vertex* vertices, unsigned int index)
+	{
+		if (context.TransformedVertexDrawIds[index] == context.VertexCacheDrawId)
 		{
-			if (vertBClipCheck) // edge ab is behind near plane
+			context.Stats.VertexCacheHits++;
+			return context.TransformedVertices[index];
+		}
+
+		Vertex& transformed = context.TransformedVertices[index];
+		transformed = vertices[index];
+
+		if (Pipeline::HasVertexShader(context))
+		{
+			Pipeline::VertexShader(context, transformed);
+			context.Stats.VerticesShaded++;
+		}
+
+		context.TransformedVertexDrawIds[index] = context.VertexCacheDrawId;
+		return transformed;
+	}
+
+	template<class Pipeline>
+	static void DrawTrianglesWithIndexBuffer(RenderContext& context, const Vertex* vertices, const unsigned int* indexBuffer, const unsigned int indicesCount)
+	{
+		context.bBinningTriangles = context.bTiledRasterization;
+
+		{
+			// Vertices are shaded as the triangles reach them, so this includes the vertex shading
+			PROFILE_SCOPE("Triangle Setup");
+			for (unsigned int i = 0; i < indicesCount; i += 3)
 			{
-				if (vertCClipCheck) { return; }
+				const Vertex& a = GetTransformedVertex<Pipeline>(context, vertices, indexBuffer[i]);
+				const Vertex& b = GetTransformedVertex<Pipeline>(context, vertices, indexBuffer[i + 1]);
+				const Vertex& c = GetTransformedVertex<Pipeline>(context, vertices, indexBuffer[i + 2]);
 
-				Math::ClipLineZByParametricRatio(cCopy, aCopy);
-				Math::ClipLineZByParametricRatio(cCopy, bCopy);
+				DrawTriangleInClipSpace<Pipeline>(context, a, b, c);
 			}
-			else if (vertCClipCheck)// edge ca is behind near plane
+		}
+
+		if (context.bBinningTriangles)
+		{
+			context.bBinningTriangles = false;
+			FlushTileBins<Pipeline>(context);
+		}
+	}
+
+	/* Makes room for verticesCount vertices in the vertex cache and starts a new draw in it */
+	static void BeginIndexedDraw(RenderContext& context, unsigned int verticesCount)
+	{
+		if (context.TransformedVertices.size() < verticesCount)
+		{
+			context.TransformedVertices.resize(verticesCount);
+			context.TransformedVertexDrawIds.resize(verticesCount, 0);
+		}
+
+		// Start a new draw, on wrap around the stale ids could match again so forget them
+		if (++context.VertexCacheDrawId == 0)
+		{
+			std::fill(context.TransformedVertexDrawIds.begin(), context.TransformedVertexDrawIds.end(), 0);
+			context.VertexCacheDrawId = 1;
+		}
+	}
+
+	/* Calls draw with the pipeline for the context's state, picked once for the whole draw.
+	*  Anything without a specialization runs through the shader pointers
+	*/
+	template<class DrawFunction>
+	static void DispatchTrianglePipeline(const RenderContext& context, DrawFunction draw)
+	{
+		if (context.VertexShader == VS_World && context.PixelShader == PS_Texture)
+		{
+			if (context.FrameMode == RenderFrameMode::Shaded)
 			{
-				Math::ClipLineZByParametricRatio(bCopy, cCopy);
-				Math::ClipLineZByParametricRatio(bCopy, aCopy);
+				draw(StaticPipeline<VS_World, PS_Texture, TextureFilter::NEAREST, RenderFrameMode::Shaded>());
+				return;
 			}
-			else
+
+			if (context.FrameMode == RenderFrameMode::Textured)
 			{
-				Vertex splitA = aCopy;
+				switch (context.SamplerFilter)
+				{
+				case TextureFilter::NEAREST:
+					draw(StaticPipeline<VS_World, PS_Texture, TextureFilter::NEAREST, RenderFrameMode::Textured>());
+					return;
+				case TextureFilter::BILINEAR:
+					draw(StaticPipeline<VS_World, PS_Texture, TextureFilter::BILINEAR, RenderFrameMode::Textured>());
+					return;
+				case TextureFilter::TRILINEAR:
+					draw(StaticPipeline<VS_World, PS_Texture, TextureFilter::TRILINEAR, RenderFrameMode::Textured>());
+					return;
+				}
+			}
+		}
 
-				Math::ClipLineZByParametricRatio(bCopy, aCopy);
-				Math::ClipLineZByParametricRatio(cCopy, splitA);
+		draw(DynamicPipeline());
+	}
+
+	/* Runs the vertex shader over every vertex of vertexBuffer into the vertex cache and marks all of them valid for the current draw */
+	static void ShadeVertexBuffer(RenderContext& context, const VertexBuffer& vertexBuffer)
+	{
+		PROFILE_SCOPE("Vertex Shading");
+
+		Vertex* transformed = context.TransformedVertices.data();
 
-				//DrawTriangleInProjectionSpace(aCopy, bCopy, cCopy);
-				DrawTriangleInProjectionSpace(aCopy, cCopy, splitA);
+		if (context.VertexShader == VS_World)
+		{
+#if SIMD_AVX2_AVAILABLE
+			if (bAVX2Supported) { VS_WorldBatchAVX2(context, vertexBuffer, transformed); }
+			else { VS_WorldBatch<SSE2Lanes>(context, vertexBuffer, transformed); }
+#elif SIMD_SSE2_AVAILABLE
+			VS_WorldBatch<SSE2Lanes>(context, vertexBuffer, transformed);
+#else
+			for (unsigned int i = 0; i < vertexBuffer.Count; i++)
+			{
+				transformed[i] = vertexBuffer.GetVertex(i);
+				VS_World(context, transformed[i]);
 			}
+#endif
 		}
-		else if (vertBClipCheck) // vert B is behind near plane, split both lines cb, ab
+		else
 		{
-			if (vertCClipCheck)// edge bc is behind near plane
+			for (unsigned int i = 0; i < vertexBuffer.Count; i++)
 			{
-				Math::ClipLineZByParametricRatio(aCopy, bCopy);
-				Math::ClipLineZByParametricRatio(aCopy, cCopy);
+				transformed[i] = vertexBuffer.GetVertex(i);
+				if (context.VertexShader) { context.VertexShader(context, transformed[i]); }
 			}
-			else
-			{
-				Vertex splitB = bCopy;
+		}
 
-				// Split cb, ab
-				Math::ClipLineZByParametricRatio(cCopy, bCopy);
-				Math::ClipLineZByParametricRatio(aCopy, splitB);
+		std::fill(context.TransformedVertexDrawIds.begin(), context.TransformedVertexDrawIds.begin() + vertexBuffer.Count, context.VertexCacheDrawId);
+	}
 
-				//DrawTriangleInProjectionSpace(bCopy, cCopy, aCopy);
-				DrawTriangleInProjectionSpace(bCopy, aCopy, splitB);
+	/* DrawTrianglesWithIndexBuffer for a draw whose vertices are all in the vertex cache already */
+	template<class Pipeline>
+	static void DrawShadedTrianglesWithIndexBuffer(RenderContext& context, const unsigned int* indexBuffer, const unsigned int indicesCount)
+	{
+		context.bBinningTriangles = context.bTiledRasterization;
+
+		const Vertex* transformed = context.TransformedVertices.data();
+		{
+			PROFILE_SCOPE("Triangle Setup");
+			for (unsigned int i = 0; i < indicesCount; i += 3)
+			{
+				DrawTriangleInClipSpace<Pipeline>(context, transformed[indexBuffer[i]], transformed[indexBuffer[i + 1]], transformed[indexBuffer[i + 2]]);
 			}
 		}
-		else if (vertCClipCheck) // vert C is behind near plane, split both lines ac, bc
+
+		if (context.bBinningTriangles)
 		{
-			Vertex splitC = cCopy;
+			context.bBinningTriangles = false;
+			FlushTileBins<Pipeline>(context);
+		}
+	}
 
-			// Split cb, ab
-			Math::ClipLineZByParametricRatio(aCopy, cCopy);
-			Math::ClipLineZByParametricRatio(bCopy, splitC);
+	/* Triangle Drawing */
+public:
+	static void DrawTriangle(RenderContext& context, const Vertex& a, const Vertex& b, const Vertex& c)
+	{
+		// Copy input data and send through shaders
+		Vertex aCopy = a;
+		Vertex bCopy = b;
+		Vertex cCopy = c;
 
-			//DrawTriangleInProjectionSpace(cCopy, aCopy, bCopy);
-			DrawTriangleInProjectionSpace(cCopy, bCopy, splitC);
+		// Use vertex shader to modify copies only
+		if (context.VertexShader)
+		{
+			context.VertexShader(context, aCopy);
+			context.VertexShader(context, bCopy);
+			context.VertexShader(context, cCopy);
 		}
 
-		//PIXEL_SHADER = PS_GreenColor;
-		DrawTriangleInProjectionSpace(aCopy, bCopy, cCopy);
+		DrawTriangleInClipSpace<DynamicPipeline>(context, aCopy, bCopy, cCopy);
 	}
 
-	static void DrawTriangleWithIndexBuffer(const Vertex* vertices, const unsigned int* indexBuffer, const unsigned int indicesCount)
+	/* Shades every vertex the index buffer references once into the vertex cache, then assembles the triangles from it */
+	static void DrawTriangleWithIndexBuffer(RenderContext& context, const Vertex* vertices, const unsigned int* indexBuffer, const unsigned int indicesCount)
 	{
-		for (unsigned int i = 0; i < indicesCount; i += 3)
+		unsigned int verticesCount = 0;
+		for (unsigned int i = 0; i < indicesCount; i++)
 		{
-			DrawTriangle(vertices[indexBuffer[i]], vertices[indexBuffer[i + 1]], vertices[indexBuffer[i + 2]]);
+			verticesCount = Math::Max(verticesCount, indexBuffer[i] + 1);
 		}
+
+		BeginIndexedDraw(context, verticesCount);
+
+		DispatchTrianglePipeline(context, [&](auto pipeline)
+		{
+			DrawTrianglesWithIndexBuffer<decltype(pipeline)>(context, vertices, indexBuffer, indicesCount);
+		});
 	}
 
-	static void DrawTriangleOutlinesWithIndexBuffer(const Vertex* vertices, const unsigned int* indexBuffer, const unsigned int indicesCount)
+	/* Shades the whole vertex buffer up front, VS_World runs batched over its streams Lanes::Width vertices at a time,
+	*  then assembles the triangles of the index buffer from the vertex cache
+	*/
+	static void DrawTriangleWithIndexBuffer(RenderContext& context, const VertexBuffer& vertexBuffer, const unsigned int* indexBuffer, const unsigned int indicesCount)
+	{
+		BeginIndexedDraw(context, vertexBuffer.Count);
+
+		// The stats count the vertices the index buffer references, as the draw of a Vertex array does, though the batch shades
+		// every vertex of the buffer. The draw ids mark the ones already seen, ShadeVertexBuffer marks all of them afterwards
+		unsigned int referencedCount = 0;
+		for (unsigned int i = 0; i < indicesCount; i++)
+		{
+			unsigned int& drawId = context.TransformedVertexDrawIds[indexBuffer[i]];
+			if (drawId != context.VertexCacheDrawId)
+			{
+				drawId = context.VertexCacheDrawId;
+				referencedCount++;
+			}
+		}
+
+		ShadeVertexBuffer(context, vertexBuffer);
+
+		if (context.VertexShader)
+		{
+			context.Stats.VerticesShaded += referencedCount;
+		}
+		context.Stats.VertexCacheHits += indicesCount - referencedCount;
+
+		DispatchTrianglePipeline(context, [&](auto pipeline)
+		{
+			DrawShadedTrianglesWithIndexBuffer<decltype(pipeline)>(context, indexBuffer, indicesCount);
+		});
+	}
+
+	static void DrawTriangleOutlinesWithIndexBuffer(RenderContext& context, const Vertex* vertices, const unsigned int* indexBuffer, const unsigned int indicesCount)
 	{
 		for (unsigned int i = 0; i < indicesCount; i += 3)
 		{
-			DrawTriangleOutline(vertices[indexBuffer[i]], vertices[indexBuffer[i + 1]], vertices[indexBuffer[i + 2]]);
+			DrawTriangleOutline(context, vertices[indexBuffer[i]], vertices[indexBuffer[i + 1]], vertices[indexBuffer[i + 2]]);
 		}
 		/*for (unsigned int i = 2; i < indicesCount; i += 3)
 		{
-			DrawTriangleOutline(vertices[indexBuffer[i - 2]], vertices[indexBuffer[i - 1]], vertices[indexBuffer[i]]);
+			DrawTriangleOutline(context, vertices[indexBuffer[i - 2]], vertices[indexBuffer[i - 1]], vertices[indexBuffer[i]]);
 		}*/
 	}
 
+	/* Tile Binning */
+private:
+	/* Stores the screen space triangle and adds it to the bin of every tile its bounding box overlaps */
+	static void BinTriangle(RenderContext& context, Texel& a, Texel& b, Texel& c)
+	{
+		int minX = Math::Max(0, Math::Min(Math::Min(a.X, b.X), c.X));
+		int minY = Math::Max(0, Math::Min(Math::Min(a.Y, b.Y), c.Y));
+
+		int maxX = Math::Min(RASTER_WIDTH - 1, Math::Max(Math::Max(a.X, b.X), c.X));
+		int maxY = Math::Min(RASTER_HEIGHT - 1, Math::Max(Math::Max(a.Y, b.Y), c.Y));
+
+		if (minX > maxX || minY > maxY) { return; } // fully off screen
+
+		unsigned int triangleIndex = static_cast<unsigned int>(context.BinnedTriangles.size());
+		context.BinnedTriangles.push_back({ a, b, c });
+
+		for (int tileY = minY / TILE_SIZE; tileY <= maxY / TILE_SIZE; tileY++)
+		{
+			for (int tileX = minX / TILE_SIZE; tileX <= maxX / TILE_SIZE; tileX++)
+			{
+				context.TileBins[Math::Convert2DTo1D(tileX, tileY, TILE_COUNT_X)].push_back(triangleIndex);
+			}
+		}
+	}
+
+	/* Stores the screen space line and adds it to the bin of every tile it can write to. The line's pixels are at most a row above
+	*  or below its end points, and those just past the left or right edge wrap into the row above or below that, so every tile
+	*  of the rows two above to two below the line gets it
+	*/
+	static void BinLine(RenderContext& context, const Pixel3D& start, const Pixel3D& end, PixelShaderFunction pixelShader)
+	{
+		int minY = Math::Max(0, Math::Min(start.Y, end.Y) - 2);
+		int maxY = Math::Min(RASTER_HEIGHT - 1, Math::Max(start.Y, end.Y) + 2);
+
+		if (minY > maxY) { return; } // fully off screen
+
+		unsigned int lineEntry = static_cast<unsigned int>(context.BinnedLines.size()) | BinnedLine::BIN_ENTRY_BIT;
+		context.BinnedLines.push_back({ start, end, pixelShader });
+
+		for (int tileY = minY / TILE_SIZE; tileY <= maxY / TILE_SIZE; tileY++)
+		{
+			for (int tileX = 0; tileX < TILE_COUNT_X; tileX++)
+			{
+				context.TileBins[Math::Convert2DTo1D(tileX, tileY, TILE_COUNT_X)].push_back(lineEntry);
+			}
+		}
+	}
+
+	/* Fills every binned triangle and draws every binned line, each tile is owned by exactly one worker and walks its bin in submission order.
+	*  Every thread runs one job that pulls tiles until none are left, so a flush records one Tile Fill scope per thread rather than per tile
+	*/
+	template<class Pipeline>
+	static void FlushTileBins(RenderContext& context)
+	{
+		std::atomic<unsigned int> nextTile(0);
+		context.Workers->ParallelFor(context.Workers->GetThreadCount(), [&context, &nextTile](unsigned int)
+		{
+			PROFILE_SCOPE("Tile Fill");
+
+			for (unsigned int tile = nextTile++; tile < TILE_COUNT; tile = nextTile++)
+			{
+				std::vector<unsigned int>& bin = context.TileBins[tile];
+
+				int tileMinX = (tile % TILE_COUNT_X) * TILE_SIZE;
+				int tileMinY = (tile / TILE_COUNT_X) * TILE_SIZE;
+				int tileMaxX = Math::Min(tileMinX + TILE_SIZE, RASTER_WIDTH) - 1;
+				int tileMaxY = Math::Min(tileMinY + TILE_SIZE, RASTER_HEIGHT) - 1;
+
+				for (unsigned int i = 0; i < bin.size(); i++)
+				{
+					if (bin[i] & BinnedLine::BIN_ENTRY_BIT)
+					{
+						BinnedLine line = context.BinnedLines[bin[i] & ~BinnedLine::BIN_ENTRY_BIT];
+						DrawLineParametric(context, line.Start, line.End, line.PixelShader, tileMinX, tileMinY, tileMaxX, tileMaxY);
+						continue;
+					}
+
+					BinnedTriangle& triangle = context.BinnedTriangles[bin[i]];
+					DrawFillTriangle<Pipeline>(context, triangle.A, triangle.B, triangle.C, tileMinX, tileMinY, tileMaxX, tileMaxY);
+				}
+
+				bin.clear();
+			}
+		});
+
+		context.BinnedTriangles.clear();
+		context.BinnedLines.clear();
+	}
+
+	/* Stats */
+public:
+	static void ResetPipelineStats(RenderContext& context)
+	{
+		context.Stats.VerticesShaded = 0;
+		context.Stats.VertexCacheHits = 0;
+		context.Stats.TrianglesBackFaceCulled = 0;
+		context.Stats.TrianglesClipped = 0;
+
+		context.Stats.FragmentsTested = 0;
+		context.Stats.DepthTestFailed = 0;
+		context.Stats.FragmentsShaded = 0;
+		context.Stats.HierarchicalDepthKilledTiles = 0;
+	}
+
+	/* Hands the stats gathered since the last reset to the profiler as this frame's counters */
+	static void RecordPipelineStats(const RenderContext& context)
+	{
+		PROFILE_COUNTER("Vertices Shaded", context.Stats.VerticesShaded);
+		PROFILE_COUNTER("Vertex Cache Hits", context.Stats.VertexCacheHits);
+		PROFILE_COUNTER("Triangles Back Face Culled", context.Stats.TrianglesBackFaceCulled);
+		PROFILE_COUNTER("Triangles Clipped", context.Stats.TrianglesClipped);
+		PROFILE_COUNTER("Fragments Tested", context.Stats.FragmentsTested.load());
+		PROFILE_COUNTER("Depth Test Failed", context.Stats.DepthTestFailed.load());
+		PROFILE_COUNTER("Fragments Shaded", context.Stats.FragmentsShaded.load());
+		PROFILE_COUNTER("HiZ Tiles Killed", context.Stats.HierarchicalDepthKilledTiles.load());
+	}
+
 	/* Color / Depth Buffer stuff */
 public:
-	static void ClearBuffers(unsigned int color)
+	/* Hash of everything in the context that decides what a frame looks like: shaders, pipeline toggles, shader constants, lights,
+	*  the bound texture's generation and the context's FrameStateGeneration.
+	*  Two frames with the same hash drawn by the same draw calls are identical, so the older one can be presented again
+	*/
+	static unsigned long long HashFrameState(const RenderContext& context)
+	{
+		// FNV-1a over the values, never over the bytes of a struct, which would take in its padding
+		unsigned long long hash = 14695981039346656037ull;
+		auto addInteger = [&hash](unsigned long long value)
+		{
+			for (int i = 0; i < 8; i++)
+			{
+				hash ^= (value >> (i * 8)) & 0xFF;
+				hash *= 1099511628211ull;
+			}
+		};
+		auto addFloat = [&addInteger](float value)
+		{
+			// -0 and 0 draw the same
+			value = value == 0.0f ? 0.0f : value;
+			unsigned int bits;
+			memcpy(&bits, &value, sizeof(bits));
+			addInteger(bits);
+		};
+		auto addVector = [&addFloat](const Vector3D& vector)
+		{
+			addFloat(vector.X);
+			addFloat(vector.Y);
+			addFloat(vector.Z);
+		};
+		auto addMatrix = [&addFloat](const Matrix4D& matrix)
+		{
+			for (int row = 0; row < 4; row++)
+			{
+				for (int column = 0; column < 4; column++) { addFloat(matrix(row, column)); }
+			}
+		};
+
+		addInteger(context.FrameStateGeneration);
+
+		addInteger(reinterpret_cast<uintptr_t>(context.VertexShader));
+		addInteger(reinterpret_cast<uintptr_t>(context.PixelShader));
+		addInteger(context.PixelShaderFlags);
+
+		addInteger(static_cast<unsigned long long>(context.FrameMode));
+		addInteger(static_cast<unsigned long long>(context.SamplerFilter));
+		addInteger(context.bShowTriangleVertexNormals);
+		addInteger(context.bTiledRasterization);
+		addInteger(context.bHierarchicalDepthTest);
+		addInteger(static_cast<unsigned long long>(context.TriangleFillPath));
+
+		addMatrix(context.WorldMatrix);
+		addMatrix(context.ViewMatrix);
+		addMatrix(context.ProjectionMatrix);
+		addFloat(context.NearPlane);
+		addFloat(context.FarPlane);
+		addVector(context.CameraForwardVector);
+
+		addVector(context.DirectionLightDirection);
+		addInteger(context.DirectionalLightColor);
+		addVector(context.PointLightPosition);
+		addInteger(context.PointLightColor);
+		addFloat(context.PointLightRadius);
+		addFloat(context.AmbientTerm);
+
+		addInteger(context.TextureSampler.GetGeneration());
+		addInteger(context.TextureSampler.MaxLevel);
+
+		// 0 marks a color buffer with nothing reusable in it
+		return hash ? hash : 1;
+	}
+
+	/* Call when anything HashFrameState can't see changes what the next frame looks like, e.g. vertices the frame draws were moved.
+	*  No frame drawn before is reused after this
+	*/
+	static void InvalidateFrameState(RenderContext& context)
+	{
+		context.FrameStateGeneration++;
+	}
+
+	/* Index of buffer in context.ColorBuffers, SWAP_CHAIN_LENGTH if it is not one of them */
+	static unsigned int GetColorBufferIndex(const RenderContext& context, const unsigned int* buffer)
+	{
+		unsigned int index = 0;
+		while (index < SWAP_CHAIN_LENGTH && context.ColorBuffers[index] != buffer)
+		{
+			index++;
+		}
+		return index;
+	}
+
+	static void ClearBuffers(RenderContext& context, unsigned int color)
 	{
 		for (int i = 0; i < TOTAL_PIXELS; i++)
 		{
-			pixels[i] = color;
-			depthBuffer[i] = 1.0f;
+			context.Pixels[i] = color;
+			context.DepthBuffer[i] = 1.0f;
+		}
+
+		for (unsigned int i = 0; i < HIZ_TILE_COUNT; i++)
+		{
+			context.HiZMaxDepth[i] = 1.0f;
+			context.HiZDirty[i] = false;
 		}
 	}
 };
@@ -0,0 +1,233 @@
+#pragma once
+#include "Math/Math.h"
+#include "Math/SIMDLanes.h"
+#include "Math/FrustumClipper.h"
+#include "Graphics/Sampler.h"
+#include "WorkerPool.h"
+#include <vector>
+#include <atomic>
+
+enum class TextureFilter
+{
+	NEAREST,
+	BILINEAR,
+	TRILINEAR
+};
+
+enum class RenderFrameMode
+{
+	WireFrame,
+	Textured,
+	Shaded /* Lighting calculated color gets drawn */
+};
+
+/* Which routine fills triangles, selectable at runtime to A/B the SIMD block paths against the scalar one */
+enum class FillPath
+{
+	Scalar,
+	SSE2, /* 4 pixels per block */
+	AVX2 /* 8 pixels per block */
+};
+
+/* What the pixel shader does besides producing a color, set together with the pixel shader.
+*  Shaders that write depth or rely on alpha get a late depth test, every other shader is depth tested before it runs
+*/
+enum PixelShaderFlags
+{
+	PS_FLAGS_NONE = 0,
+	PS_FLAGS_MODIFIES_DEPTH = (1 << 0),
+	PS_FLAGS_USES_ALPHA = (1 << 1)
+};
+
+/* Interpolated inputs of one pixel, filled in by the rasterizer for every pixel it shades */
+struct PixelShaderInput
+{
+	float TexCoordU;
+	float TexCoordV;
+
+	/* Mip level with its fraction, see TexCoordGradients */
+	float MipMapLod;
+
+public:
+	inline PixelShaderInput()
+		: TexCoordU(0.0f), TexCoordV(0.0f), MipMapLod(0.0f) { }
+};
+
+struct RenderContext;
+
+typedef void (*VertexShaderFunction)(const RenderContext& context, Vertex& vertex);
+typedef void (*PixelShaderFunction)(const RenderContext& context, const PixelShaderInput& input, unsigned int& pixel);
+
+/* What the pipeline did since the last Rasterization::ResetPipelineStats.
+*  The fragment counters are added to by the Workers filling tiles, the rest only by the thread drawing with the context
+*/
+struct PipelineStats
+{
+	/* Vertices an indexed draw references, shaded once each, versus the references the vertex cache served.
+	*  A VertexBuffer draw shades its whole buffer in batches but counts the same way, so both kinds of draw report alike
+	*/
+	unsigned long long VerticesShaded;
+	unsigned long long VertexCacheHits;
+
+	unsigned long long TrianglesBackFaceCulled;
+
+	/* Triangles that crossed a clip plane (near, far or the guard band) and had to be cut */
+	unsigned long long TrianglesClipped;
+
+	/* Covered fragments that reached the depth test, the ones that failed it (early or late) and the ones that were shaded */
+	std::atomic<unsigned long long> FragmentsTested;
+	std::atomic<unsigned long long> DepthTestFailed;
+	std::atomic<unsigned long long> FragmentsShaded;
+
+	/* Depth tiles a triangle overlapped but was entirely behind, none of their pixels were visited */
+	std::atomic<unsigned long long> HierarchicalDepthKilledTiles;
+
+public:
+	inline PipelineStats()
+		: VerticesShaded(0), VertexCacheHits(0), TrianglesBackFaceCulled(0), TrianglesClipped(0),
+		FragmentsTested(0), DepthTestFailed(0), FragmentsShaded(0), HierarchicalDepthKilledTiles(0) { }
+};
+
+/* A triangle that has been set up in screen space and is waiting in the tile bins */
+struct BinnedTriangle
+{
+	Texel A;
+	Texel B;
+	Texel C;
+};
+
+/* A line that has been set up in screen space and is waiting in the tile bins behind the triangle it belongs to */
+struct BinnedLine
+{
+	/* Set in the bin entries of lines, the rest of the entry is the line's index */
+	static const unsigned int BIN_ENTRY_BIT = 0x80000000u;
+
+	Pixel3D Start;
+	Pixel3D End;
+	PixelShaderFunction PixelShader;
+};
+
+/* Everything one view needs to render: its render targets, the pipeline state, the shader constants and the rasterizer's scratch memory.
+*  Every Rasterization call takes the context it draws with, so separate contexts can render different views or frames on different threads.
+*  A context itself is only ever drawn with from one thread at a time, its tiles are filled by Workers
+*/
+struct RenderContext
+{
+public:
+	/* Render targets, Pixels is the color buffer being drawn into.
+	*  It is one of ColorBuffers, which rotate when frames are presented through a swap chain
+	*/
+	unsigned int* Pixels;
+	unsigned int* ColorBuffers[SWAP_CHAIN_LENGTH];
+
+	/* Rasterization::HashFrameState of the frame each color buffer holds, 0 if it holds nothing reusable */
+	unsigned long long ColorBufferStates[SWAP_CHAIN_LENGTH];
+
+	/* Bumped by Rasterization::InvalidateFrameState when something the hash can't see changes, like the vertices being drawn */
+	unsigned long long FrameStateGeneration;
+	float* DepthBuffer;
+
+	/* Hierarchical Z, the furthest depth of every HIZ_TILE_SIZE square of the depth buffer.
+	*  Depth only ever gets closer between clears, so a stale max is still a valid upper bound,
+	*  dirty tiles are written to since their max was taken and get tightened the next time they are tested
+	*/
+	float* HiZMaxDepth;
+	bool* HiZDirty;
+
+	/* Pipeline state */
+	VertexShaderFunction VertexShader;
+	PixelShaderFunction PixelShader;
+	unsigned int PixelShaderFlags;
+
+	RenderFrameMode FrameMode;
+	TextureFilter SamplerFilter;
+	bool bShowTriangleVertexNormals;
+
+	/* Sort-middle rasterization, indexed triangles are set up once, binned into screen tiles then filled by Workers */
+	bool bTiledRasterization;
+
+	/* Coarse rejection of whole depth tiles against hierarchical Z */
+	bool bHierarchicalDepthTest;
+
+	FillPath TriangleFillPath;
+
+	/* Shader constants */
+	Matrix4D WorldMatrix;
+	Matrix4D ViewMatrix;
+	Matrix4D ProjectionMatrix;
+
+	float NearPlane;
+	float FarPlane;
+
+	Vector3D CameraForwardVector;
+
+	/* Lighting */
+	Vector3D DirectionLightDirection;
+	unsigned int DirectionalLightColor;
+
+	Vector3D PointLightPosition;
+	unsigned int PointLightColor;
+	float PointLightRadius;
+
+	float AmbientTerm;
+
+	/* Texture the pixel shaders sample, bound before drawing. The MipChain it points into is not owned by the context */
+	Sampler TextureSampler;
+
+	/* Post-transform vertex cache of the indexed draw in flight, each referenced vertex is shaded once and shared by all of its triangles.
+	*  A vertex is valid for the current draw when its draw id matches, so the cache never has to be cleared
+	*/
+	std::vector<Vertex> TransformedVertices;
+	std::vector<unsigned int> TransformedVertexDrawIds;
+	unsigned int VertexCacheDrawId;
+
+	/* Scratch buffers of the triangle clipper */
+	FrustumClipper TriangleClipper;
+
+	/* Tile bins of the draw in flight, an entry is an index into BinnedTriangles or, with BinnedLine::BIN_ENTRY_BIT set, into BinnedLines */
+	bool bBinningTriangles;
+	std::vector<BinnedTriangle> BinnedTriangles;
+	std::vector<BinnedLine> BinnedLines;
+	std::vector<unsigned int> TileBins[TILE_COUNT];
+
+	WorkerPool* Workers;
+
+	PipelineStats Stats;
+
+public:
+	inline RenderContext();
+	inline ~RenderContext();
+
+	RenderContext(const RenderContext&) = delete;
+	RenderContext& operator=(const RenderContext&) = delete;
+};
+
+inline RenderContext::RenderContext()
+	: Pixels(nullptr), FrameStateGeneration(0), DepthBuffer(new float[TOTAL_PIXELS]),
+	HiZMaxDepth(new float[HIZ_TILE_COUNT]), HiZDirty(new bool[HIZ_TILE_COUNT]),
+	VertexShader(nullptr), PixelShader(nullptr), PixelShaderFlags(PS_FLAGS_NONE),
+	FrameMode(RenderFrameMode::WireFrame), SamplerFilter(TextureFilter::NEAREST), bShowTriangleVertexNormals(false),
+	bTiledRasterization(true), bHierarchicalDepthTest(true),
+	TriangleFillPath(SIMD::IsAVX2Supported() ? FillPath::AVX2 : (SIMD_SSE2_AVAILABLE ? FillPath::SSE2 : FillPath::Scalar)),
+	NearPlane(0.1f), FarPlane(100.0f),
+	DirectionalLightColor(0), PointLightColor(0), PointLightRadius(0.0f), AmbientTerm(0.0f),
+	VertexCacheDrawId(0), bBinningTriangles(false), Workers(&WorkerPool::GetShared())
+{
+	for (unsigned int i = 0; i < SWAP_CHAIN_LENGTH; i++)
+	{
+		ColorBuffers[i] = new unsigned int[TOTAL_PIXELS];
+		ColorBufferStates[i] = 0;
+	}
+	Pixels = ColorBuffers[0];
+}
+
+inline RenderContext::~RenderContext()
+{
+	for (unsigned int i = 0; i < SWAP_CHAIN_LENGTH; i++)
+	{
+		delete[] ColorBuffers[i];
+	}
+	delete[] DepthBuffer;
+	delete[] HiZMaxDepth;
+	delete[] HiZDirty;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+
+/* Bounded lock-free queue between exactly one producer thread and one consumer thread.
+*  Push and Pop never block, they fail when the queue is full / empty.
+*  Head and tail sit on their own cache lines so the two threads do not invalidate each other's line on every operation.
+*/
+template<class T, unsigned int Capacity>
+class SPSCQueue
+{
+private:
+	/* One slot stays empty so a full queue can be told apart from an empty one */
+	static const unsigned int SLOT_COUNT = Capacity + 1;
+
+	T mItems[SLOT_COUNT];
+
+	/* Next slot to pop, only written by the consumer */
+	alignas(64) std::atomic<unsigned int> mHead;
+
+	/* Next slot to push, only written by the producer */
+	alignas(64) std::atomic<unsigned int> mTail;
+
+public:
+	SPSCQueue()
+		: mHead(0), mTail(0) { }
+
+	SPSCQueue(const SPSCQueue&) = delete;
+	SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+public:
+	/* Producer only, false if the queue is full */
+	bool Push(const T& item)
+	{
+		unsigned int tail = mTail.load(std::memory_order_relaxed);
+		unsigned int next = (tail + 1) % SLOT_COUNT;
+		if (next == mHead.load(std::memory_order_acquire)) { return false; }
+
+		mItems[tail] = item;
+		mTail.store(next, std::memory_order_release);
+		return true;
+	}
+
+	/* Consumer only, false if the queue is empty */
+	bool Pop(T& item)
+	{
+		unsigned int head = mHead.load(std::memory_order_relaxed);
+		if (head == mTail.load(std::memory_order_acquire)) { return false; }
+
+		item = mItems[head];
+		mHead.store((head + 1) % SLOT_COUNT, std::memory_order_release);
+		return true;
+	}
+};
@@ -0,0 +1,222 @@
+#pragma once
+#include "RenderContext.h"
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+
+/* Frame times and output hashes of one replay of the scene benchmark's input path */
+struct SceneBenchmarkRun
+{
+	RenderFrameMode FrameMode;
+	TextureFilter SamplerFilter;
+
+	/* Nanoseconds from the end of one frame to the end of the next */
+	std::vector<long long> FrameTimes;
+
+	/* SceneBenchmark::HashPixels of every presented frame */
+	std::vector<unsigned long long> FrameHashes;
+
+public:
+	SceneBenchmarkRun(RenderFrameMode frameMode, TextureFilter samplerFilter)
+		: FrameMode(frameMode), SamplerFilter(samplerFilter) { }
+
+	/* Hash of all the frame hashes, what gets compared with the golden one */
+	unsigned long long GetHash() const
+	{
+		unsigned long long hash = 14695981039346656037ull;
+		for (unsigned long long frameHash : FrameHashes)
+		{
+			hash ^= frameHash;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+};
+
+/* Runs of the scene benchmark (see Application::RunSceneBenchmark), one per texture filter for textured frames and one for every other frame mode,
+*  with their timing report, a per frame CSV and golden hashes to check the output against.
+*
+*  A golden file holds one line per run: <frame mode> <texture filter> <frames> <hash>, '#' starts a comment.
+*  Modes that don't sample the texture run with NEAREST.
+*  Floating point results differ between compilers and fill paths, so goldens are recorded per build and machine
+*  and then guard every later change against altering the output
+*/
+class SceneBenchmark
+{
+private:
+	std::vector<SceneBenchmarkRun> mRuns;
+
+public:
+	SceneBenchmarkRun& AddRun(RenderFrameMode frameMode, TextureFilter samplerFilter)
+	{
+		mRuns.push_back(SceneBenchmarkRun(frameMode, samplerFilter));
+		return mRuns.back();
+	}
+
+	/* FNV-1a over the pixels */
+	static unsigned long long HashPixels(const unsigned int* pixels, unsigned int count)
+	{
+		unsigned long long hash = 14695981039346656037ull;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			hash ^= pixels[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	static const char* GetName(RenderFrameMode frameMode)
+	{
+		switch (frameMode)
+		{
+		case RenderFrameMode::WireFrame: return "WireFrame";
+		case RenderFrameMode::Textured: return "Textured";
+		case RenderFrameMode::Shaded: return "Shaded";
+		}
+		return "?";
+	}
+
+	static const char* GetName(TextureFilter samplerFilter)
+	{
+		switch (samplerFilter)
+		{
+		case TextureFilter::NEAREST: return "NEAREST";
+		case TextureFilter::BILINEAR: return "BILINEAR";
+		case TextureFilter::TRILINEAR: return "TRILINEAR";
+		}
+		return "?";
+	}
+
+	/* Frame time percentiles, frames per second and output hash of every run */
+	void PrintReport(std::ostream& stream) const
+	{
+		std::ios::fmtflags flags = stream.flags();
+		std::streamsize precision = stream.precision();
+
+		stream << std::fixed << std::setprecision(3) << "Scene benchmark, frame times in ms" << std::endl;
+		stream << std::left << std::setw(24) << "" << std::right << std::setw(8) << "frames" << std::setw(10) << "mean"
+			<< std::setw(10) << "p50" << std::setw(10) << "p95" << std::setw(10) << "max" << std::setw(10) << "fps" << "  hash" << std::endl;
+
+		for (const SceneBenchmarkRun& run : mRuns)
+		{
+			std::vector<long long> times = run.FrameTimes;
+			std::sort(times.begin(), times.end());
+
+			double total = 0.0;
+			for (long long time : times) { total += time * 1e-6; }
+			double mean = times.empty() ? 0.0 : total / times.size();
+
+			std::string name = std::string(GetName(run.FrameMode)) + " " + GetName(run.SamplerFilter);
+			stream << std::left << std::setw(24) << name << std::right << std::setw(8) << times.size() << std::setw(10) << mean
+				<< std::setw(10) << Percentile(times, 0.50) * 1e-6 << std::setw(10) << Percentile(times, 0.95) * 1e-6
+				<< std::setw(10) << (times.empty() ? 0.0 : times.back() * 1e-6) << std::setw(10) << (mean > 0.0 ? 1000.0 / mean : 0.0)
+				<< "  " << std::hex << std::setw(16) << std::setfill('0') << run.GetHash() << std::dec << std::setfill(' ') << std::endl;
+		}
+
+		stream.flags(flags);
+		stream.precision(precision);
+	}
+
+	/* One row per frame: frame mode, texture filter, frame, ms, frame hash */
+	bool WriteTimings(const char* path) const
+	{
+		std::ofstream file(path);
+		if (!file) { return false; }
+
+		file << "frame_mode,texture_filter,frame,milliseconds,hash" << std::endl;
+		for (const SceneBenchmarkRun& run : mRuns)
+		{
+			for (size_t i = 0; i < run.FrameTimes.size(); i++)
+			{
+				file << GetName(run.FrameMode) << "," << GetName(run.SamplerFilter) << "," << i << ","
+					<< run.FrameTimes[i] * 1e-6 << "," << std::hex << std::setw(16) << std::setfill('0') << run.FrameHashes[i]
+					<< std::dec << std::setfill(' ') << std::endl;
+			}
+		}
+		return static_cast<bool>(file);
+	}
+
+	bool WriteGolden(const char* path) const
+	{
+		std::ofstream file(path);
+		if (!file) { return false; }
+
+		file << "# Scene benchmark golden hashes: <frame mode> <texture filter> <frames> <hash of every frame>" << std::endl;
+		for (const SceneBenchmarkRun& run : mRuns)
+		{
+			file << GetName(run.FrameMode) << " " << GetName(run.SamplerFilter) << " " << run.FrameHashes.size() << " "
+				<< std::hex << std::setw(16) << std::setfill('0') << run.GetHash() << std::dec << std::setfill(' ') << std::endl;
+		}
+		return static_cast<bool>(file);
+	}
+
+	static bool HasGolden(const char* path)
+	{
+		std::ifstream file(path);
+		return static_cast<bool>(file);
+	}
+
+	/* Prints every run that differs from or is missing in the golden file, true if all of them match */
+	bool CompareGolden(const char* path, std::ostream& stream) const
+	{
+		std::ifstream file(path);
+		if (!file)
+		{
+			stream << "Could not open golden hashes " << path << std::endl;
+			return false;
+		}
+
+		// "<frame mode> <texture filter>" -> (frames, hash)
+		std::map<std::string, std::pair<size_t, unsigned long long>> goldens;
+		std::string line;
+		while (std::getline(file, line))
+		{
+			size_t comment = line.find('#');
+			if (comment != std::string::npos) { line.erase(comment); }
+
+			std::istringstream fields(line);
+			std::string frameMode, samplerFilter, hash;
+			size_t frames = 0;
+			if (fields >> frameMode >> samplerFilter >> frames >> hash)
+			{
+				goldens[frameMode + " " + samplerFilter] = std::make_pair(frames, strtoull(hash.c_str(), nullptr, 16));
+			}
+		}
+
+		bool bMatched = true;
+		for (const SceneBenchmarkRun& run : mRuns)
+		{
+			std::string name = std::string(GetName(run.FrameMode)) + " " + GetName(run.SamplerFilter);
+			auto golden = goldens.find(name);
+			if (golden == goldens.end())
+			{
+				stream << name << ": no golden hash" << std::endl;
+				bMatched = false;
+			}
+			else if (golden->second.first != run.FrameHashes.size() || golden->second.second != run.GetHash())
+			{
+				stream << name << ": " << run.FrameHashes.size() << " frames hashed to " << std::hex << std::setw(16) << std::setfill('0') << run.GetHash()
+					<< ", golden is " << std::dec << golden->second.first << " frames hashed to " << std::hex << std::setw(16) << golden->second.second
+					<< std::dec << std::setfill(' ') << std::endl;
+				bMatched = false;
+			}
+		}
+
+		stream << (bMatched ? "Output matches the golden hashes" : "Output does NOT match the golden hashes") << std::endl;
+		return bMatched;
+	}
+
+private:
+	static long long Percentile(const std::vector<long long>& sorted, double percentile)
+	{
+		if (sorted.empty()) { return 0; }
+		size_t rank = static_cast<size_t>(percentile * sorted.size() + 0.5);
+		return sorted[(std::min)((std::max)(rank, static_cast<size_t>(1)), sorted.size()) - 1];
+	}
+};
@@ -0,0 +1,206 @@
+#pragma once
+
+/* Frame ring in POSIX shared memory, the headless RasterSurface publishes every presented frame into it
+*  so encoders and QA tools in other processes can read the pixels in place.
+*
+*  Layout of the shared object: a SharedFrameRingHeader followed by SlotCount slots of SlotStride bytes pixels each.
+*  Every slot is guarded by a sequence lock, Sequence is odd while the producer writes it and 2 * (FrameIndex + 1) once complete.
+*  A reader copies or checks the pixels and only trusts them if Sequence was the same even value before and after.
+*  PublishedFrames counts the frames written so far and doubles as a futex word, readers sleep on it with FUTEX_WAIT
+*  and the producer wakes them after every frame.
+*/
+#if defined(__linux__)
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define SHARED_FRAME_RING_MAGIC 0x52465352u /* "RSFR" */
+#define SHARED_FRAME_RING_VERSION 1u
+#define SHARED_FRAME_RING_SLOTS 4u
+
+enum SharedFrameFormat : uint32_t
+{
+	SHARED_FRAME_FORMAT_XRGB8888 = 1 /* 32 bit pixels, blue in the low byte, same as RS_Update takes */
+};
+
+struct SharedFrameSlot
+{
+	std::atomic<uint64_t> Sequence;
+
+	uint64_t FrameIndex;
+	uint64_t TimestampNanoseconds; /* CLOCK_MONOTONIC at publication */
+	uint64_t Checksum; /* SharedFrameRing::Checksum of the pixels */
+};
+
+struct SharedFrameRingHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t Format;
+
+	uint32_t SlotCount;
+	uint64_t SlotStride; /* bytes between the pixels of consecutive slots */
+	uint64_t PixelsOffset; /* bytes from the start of the object to the pixels of slot 0 */
+
+	/* Set once the producer shut down, no more frames will come */
+	std::atomic<uint32_t> ProducerClosed;
+
+	/* Frames published so far (wraps at 2^32), the futex word readers wait on */
+	alignas(64) std::atomic<uint32_t> PublishedFrames;
+
+	alignas(64) SharedFrameSlot Slots[SHARED_FRAME_RING_SLOTS];
+};
+
+struct SharedFrameRing
+{
+public:
+	/* FNV-1a over the 32 bit pixels, producer and consumers have to agree on it */
+	inline static uint64_t Checksum(const uint32_t* pixels, uint64_t count)
+	{
+		uint64_t hash = 1469598103934665603ull;
+		for (uint64_t i = 0; i < count; i++)
+		{
+			hash ^= pixels[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	inline static uint64_t TimestampNanoseconds()
+	{
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return static_cast<uint64_t>(now.tv_sec) * 1000000000ull + static_cast<uint64_t>(now.tv_nsec);
+	}
+
+	/* Size of the shared object for a width x height ring */
+	inline static uint64_t GetObjectSize(uint32_t width, uint32_t height)
+	{
+		return GetPixelsOffset() + static_cast<uint64_t>(width) * height * 4 * SHARED_FRAME_RING_SLOTS;
+	}
+
+	inline static uint64_t GetPixelsOffset()
+	{
+		return (sizeof(SharedFrameRingHeader) + 4095) & ~static_cast<uint64_t>(4095);
+	}
+
+	/* Sleeps until PublishedFrames differs from expected or timeoutNanoseconds pass */
+	inline static void WaitForFrame(std::atomic<uint32_t>& publishedFrames, uint32_t expected, long long timeoutNanoseconds)
+	{
+		timespec timeout = { static_cast<time_t>(timeoutNanoseconds / 1000000000), static_cast<long>(timeoutNanoseconds % 1000000000) };
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(&publishedFrames), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+	}
+
+	inline static void WakeAll(std::atomic<uint32_t>& publishedFrames)
+	{
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(&publishedFrames), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+	}
+};
+
+/* Producer side, creates the shared object and publishes frames into it */
+class SharedFrameRingWriter
+{
+private:
+	std::string mName;
+	SharedFrameRingHeader* mHeader;
+	uint64_t mSize;
+	uint64_t mFrameIndex;
+
+public:
+	SharedFrameRingWriter()
+		: mHeader(nullptr), mSize(0), mFrameIndex(0) { }
+
+	~SharedFrameRingWriter() { Close(); }
+
+	SharedFrameRingWriter(const SharedFrameRingWriter&) = delete;
+	SharedFrameRingWriter& operator=(const SharedFrameRingWriter&) = delete;
+
+public:
+	bool IsOpen() const { return mHeader != nullptr; }
+
+	/* Creates (or replaces) the shared object name, e.g. "/rs_frames" */
+	bool Open(const char* name, uint32_t width, uint32_t height)
+	{
+		Close();
+
+		int file = shm_open(name, O_CREAT | O_RDWR, 0644);
+		if (file < 0) { return false; }
+
+		uint64_t size = SharedFrameRing::GetObjectSize(width, height);
+		if (ftruncate(file, static_cast<off_t>(size)) != 0)
+		{
+			close(file);
+			return false;
+		}
+
+		void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+		close(file);
+		if (memory == MAP_FAILED) { return false; }
+
+		mName = name;
+		mSize = size;
+		mFrameIndex = 0;
+		mHeader = static_cast<SharedFrameRingHeader*>(memory);
+
+		// Readers check Magic last, fill everything else in first
+		memset(memory, 0, sizeof(SharedFrameRingHeader));
+		mHeader->Version = SHARED_FRAME_RING_VERSION;
+		mHeader->Width = width;
+		mHeader->Height = height;
+		mHeader->Format = SHARED_FRAME_FORMAT_XRGB8888;
+		mHeader->SlotCount = SHARED_FRAME_RING_SLOTS;
+		mHeader->SlotStride = static_cast<uint64_t>(width) * height * 4;
+		mHeader->PixelsOffset = SharedFrameRing::GetPixelsOffset();
+		std::atomic_thread_fence(std::memory_order_release);
+		mHeader->Magic = SHARED_FRAME_RING_MAGIC;
+		return true;
+	}
+
+	/* Copies a Width x Height frame into the next slot and wakes every waiting reader */
+	void Publish(const uint32_t* pixels)
+	{
+		if (!mHeader) { return; }
+
+		SharedFrameSlot& slot = mHeader->Slots[mFrameIndex % SHARED_FRAME_RING_SLOTS];
+		uint8_t* slotPixels = reinterpret_cast<uint8_t*>(mHeader) + mHeader->PixelsOffset + (mFrameIndex % SHARED_FRAME_RING_SLOTS) * mHeader->SlotStride;
+
+		slot.Sequence.store(2 * mFrameIndex + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		memcpy(slotPixels, pixels, mHeader->SlotStride);
+		slot.FrameIndex = mFrameIndex;
+		slot.TimestampNanoseconds = SharedFrameRing::TimestampNanoseconds();
+		slot.Checksum = SharedFrameRing::Checksum(pixels, mHeader->SlotStride / 4);
+
+		slot.Sequence.store(2 * mFrameIndex + 2, std::memory_order_release);
+		mFrameIndex++;
+
+		mHeader->PublishedFrames.store(static_cast<uint32_t>(mFrameIndex), std::memory_order_release);
+		SharedFrameRing::WakeAll(mHeader->PublishedFrames);
+	}
+
+	/* Tells readers no more frames will come and removes the name, attached readers keep their mapping */
+	void Close()
+	{
+		if (!mHeader) { return; }
+
+		mHeader->ProducerClosed.store(1, std::memory_order_release);
+		SharedFrameRing::WakeAll(mHeader->PublishedFrames);
+
+		munmap(mHeader, mSize);
+		shm_unlink(mName.c_str());
+		mHeader = nullptr;
+	}
+};
+#endif // __linux__
@@ -0,0 +1,136 @@
+#pragma once
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+/* A fixed pool of worker threads that cooperatively run an indexed job.
+*  The thread calling ParallelFor also pulls work and only returns once every index has been run.
+*  Several threads may submit to the same pool, their jobs run one after the other.
+*/
+class WorkerPool
+{
+private:
+	std::vector<std::thread> mThreads;
+
+	/* Held for the whole of a ParallelFor so jobs from different submitting threads never interleave */
+	std::mutex mSubmitMutex;
+
+	std::mutex mMutex;
+	std::condition_variable mJobReady;
+	std::condition_variable mJobDone;
+
+	std::function<void(unsigned int)> mJob;
+	unsigned int mJobCount;
+	std::atomic<unsigned int> mNextJobIndex;
+
+	unsigned int mActiveWorkers;
+	unsigned int mGeneration;
+	bool mShutdown;
+
+public:
+	WorkerPool()
+		: mJobCount(0), mNextJobIndex(0), mActiveWorkers(0), mGeneration(0), mShutdown(false) { }
+
+	~WorkerPool()
+	{
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mShutdown = true;
+		}
+		mJobReady.notify_all();
+
+		for (unsigned int i = 0; i < mThreads.size(); i++)
+		{
+			mThreads[i].join();
+		}
+	}
+
+public:
+	/* Pool shared by every render context, created on first use */
+	static WorkerPool& GetShared()
+	{
+		static WorkerPool sharedPool;
+		return sharedPool;
+	}
+
+	/* Number of threads that run jobs, including the calling thread */
+	unsigned int GetThreadCount()
+	{
+		std::lock_guard<std::mutex> submitLock(mSubmitMutex);
+		Start();
+		return static_cast<unsigned int>(mThreads.size()) + 1;
+	}
+
+	/* Runs job(0) ... job(count - 1) across all threads, blocks until all of them have finished */
+	void ParallelFor(unsigned int count, const std::function<void(unsigned int)>& job)
+	{
+		std::lock_guard<std::mutex> submitLock(mSubmitMutex);
+		Start();
+
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mJob = job;
+			mJobCount = count;
+			mNextJobIndex = 0;
+			mActiveWorkers = static_cast<unsigned int>(mThreads.size());
+			mGeneration++;
+		}
+		mJobReady.notify_all();
+
+		RunJobs();
+
+		std::unique_lock<std::mutex> lock(mMutex);
+		mJobDone.wait(lock, [&]() { return mActiveWorkers == 0; });
+		mJob = nullptr;
+	}
+
+private:
+	/* Threads are spawned on first use so including this header never starts threads during static initialization */
+	void Start()
+	{
+		if (!mThreads.empty()) { return; }
+
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		unsigned int numWorkers = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+
+		for (unsigned int i = 0; i < numWorkers; i++)
+		{
+			mThreads.emplace_back(&WorkerPool::WorkerLoop, this);
+		}
+	}
+
+	void RunJobs()
+	{
+		for (unsigned int i = mNextJobIndex++; i < mJobCount; i = mNextJobIndex++)
+		{
+			mJob(i);
+		}
+	}
+
+	void WorkerLoop()
+	{
+		unsigned int seenGeneration = 0;
+
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				mJobReady.wait(lock, [&]() { return mShutdown || mGeneration != seenGeneration; });
+
+				if (mShutdown) { return; }
+				seenGeneration = mGeneration;
+			}
+
+			RunJobs();
+
+			std::unique_lock<std::mutex> lock(mMutex);
+			if (--mActiveWorkers == 0)
+			{
+				mJobDone.notify_one();
+			}
+		}
+	}
+};
@@ -0,0 +1,215 @@
+#pragma once
+#include "Graphics/ColorConversion.h"
+#include "FrameProfiler.h"
+#include <cstdio>
+#include <csignal>
+#include <algorithm>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#if defined(_WIN32)
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+/* Frames handed to the writer that are not converted yet, the render thread only waits once all of them are taken */
+#define Y4M_STAGING_FRAMES 2
+
+/* Streams presented frames as an uncompressed YUV4MPEG2 (4:2:0) video.
+*  WriteFrame only copies the pixels into a staging frame, the color conversion and the write happen on the writer's own thread
+*  so they overlap with drawing the next frame.
+*
+*  Open takes a file name, "-" for stdout or "|command" to pipe into a program, e.g.
+*  "|ffmpeg -y -i - -c:v libx264 flythrough.mp4"
+*/
+class Y4MWriter
+{
+private:
+	FILE* mFile;
+	bool mPipe;
+
+	unsigned int mWidth;
+	unsigned int mHeight;
+
+	std::vector<unsigned int> mStagingFrames[Y4M_STAGING_FRAMES];
+	std::vector<unsigned char> mYUVFrame;
+
+	/* Both count up forever, guarded by mMutex */
+	unsigned int mSubmittedFrames;
+	unsigned int mConvertedFrames;
+	bool mStopping;
+	bool mWriteFailed;
+
+	std::mutex mMutex;
+	std::condition_variable mFramesChanged;
+	std::thread mThread;
+
+public:
+	Y4MWriter()
+		: mFile(nullptr), mPipe(false), mWidth(0), mHeight(0),
+		mSubmittedFrames(0), mConvertedFrames(0), mStopping(false), mWriteFailed(false) { }
+
+	~Y4MWriter() { Close(); }
+
+	Y4MWriter(const Y4MWriter&) = delete;
+	Y4MWriter& operator=(const Y4MWriter&) = delete;
+
+public:
+	bool IsOpen() const { return mFile != nullptr; }
+
+	/* Opens the output, writes the stream header and starts the writer thread */
+	bool Open(const char* path, unsigned int width, unsigned int height, unsigned int framesPerSecond)
+	{
+		Close();
+
+		mPipe = path[0] == '|';
+		if (mPipe)
+		{
+#if defined(_WIN32)
+			mFile = _popen(path + 1, "wb");
+#else
+			mFile = popen(path + 1, "w");
+#endif
+		}
+		else if (path[0] == '-' && path[1] == '\0')
+		{
+#if defined(_WIN32)
+			_setmode(_fileno(stdout), _O_BINARY);
+#endif
+			mFile = stdout;
+		}
+		else
+		{
+#if defined(_MSC_VER)
+			if (fopen_s(&mFile, path, "wb") != 0) { mFile = nullptr; }
+#else
+			mFile = fopen(path, "wb");
+#endif
+		}
+		if (!mFile) { return false; }
+
+#if !defined(_WIN32)
+		// A reader that goes away should fail the write, not kill the renderer
+		if (mPipe || mFile == stdout) { signal(SIGPIPE, SIG_IGN); }
+#endif
+
+		fprintf(mFile, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", width, height, framesPerSecond);
+
+		mWidth = width;
+		mHeight = height;
+		for (std::vector<unsigned int>& frame : mStagingFrames)
+		{
+			frame.assign(width * height, 0);
+		}
+		mYUVFrame.assign(width * height + 2 * ((width + 1) / 2) * ((height + 1) / 2), 0);
+
+		mSubmittedFrames = 0;
+		mConvertedFrames = 0;
+		mStopping = false;
+		mWriteFailed = false;
+		mThread = std::thread(&Y4MWriter::ProcessFrames, this);
+		return true;
+	}
+
+	/* Queues a Width x Height XRGB frame, false once the output stopped taking data (e.g. the piped program exited) */
+	bool WriteFrame(const unsigned int* xrgbPixels)
+	{
+		if (!mFile) { return false; }
+
+		PROFILE_SCOPE("Y4M Submit");
+
+		std::unique_lock<std::mutex> lock(mMutex);
+		mFramesChanged.wait(lock, [&]() { return mSubmittedFrames - mConvertedFrames < Y4M_STAGING_FRAMES || mWriteFailed; });
+		if (mWriteFailed) { return false; }
+
+		// The writer thread never touches a staging frame it has not been handed yet, copying outside the lock is safe
+		std::vector<unsigned int>& frame = mStagingFrames[mSubmittedFrames % Y4M_STAGING_FRAMES];
+		lock.unlock();
+		std::copy(xrgbPixels, xrgbPixels + frame.size(), frame.begin());
+		lock.lock();
+
+		mSubmittedFrames++;
+		lock.unlock();
+		mFramesChanged.notify_all();
+		return true;
+	}
+
+	/* Writes out every queued frame, then closes the output */
+	void Close()
+	{
+		if (!mFile) { return; }
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mStopping = true;
+		}
+		mFramesChanged.notify_all();
+		mThread.join();
+
+		if (mFile == stdout)
+		{
+			fflush(mFile);
+		}
+		else if (mPipe)
+		{
+#if defined(_WIN32)
+			_pclose(mFile);
+#else
+			pclose(mFile);
+#endif
+		}
+		else
+		{
+			fclose(mFile);
+		}
+		mFile = nullptr;
+	}
+
+private:
+	/* Writer thread, converts and writes the staging frames in submission order */
+	void ProcessFrames()
+	{
+		const unsigned int lumaSize = mWidth * mHeight;
+		const unsigned int chromaSize = ((mWidth + 1) / 2) * ((mHeight + 1) / 2);
+		unsigned char* yPlane = mYUVFrame.data();
+		unsigned char* uPlane = yPlane + lumaSize;
+		unsigned char* vPlane = uPlane + chromaSize;
+
+		for (;;)
+		{
+			unsigned int frameIndex;
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				// Drain whatever is queued before stopping
+				mFramesChanged.wait(lock, [&]() { return mConvertedFrames < mSubmittedFrames || mStopping; });
+				if (mConvertedFrames == mSubmittedFrames) { break; }
+				frameIndex = mConvertedFrames;
+			}
+
+			{
+				PROFILE_SCOPE("Y4M Convert");
+				ColorConversion::XRGBToYUV420(mStagingFrames[frameIndex % Y4M_STAGING_FRAMES].data(), mWidth, mHeight, yPlane, uPlane, vPlane);
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				// The staging frame is free again as soon as it is converted, the write below only reads mYUVFrame
+				mConvertedFrames++;
+			}
+			mFramesChanged.notify_all();
+
+			PROFILE_SCOPE("Y4M Write");
+			bool bWritten = fputs("FRAME\n", mFile) >= 0 && fwrite(mYUVFrame.data(), 1, mYUVFrame.size(), mFile) == mYUVFrame.size();
+			if (!bWritten)
+			{
+				{
+					std::lock_guard<std::mutex> lock(mMutex);
+					mWriteFailed = true;
+				}
+				mFramesChanged.notify_all();
+				break;
+			}
+		}
+	}
+};
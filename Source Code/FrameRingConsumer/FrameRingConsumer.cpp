@@ -0,0 +1,154 @@
+/* Sample consumer of the headless RasterSurface's shared memory frame ring (see Assignment4/SharedFrameRing.h).
+*  Attaches to the ring, waits for frames on its futex and verifies every frame's checksum in place without copying it,
+*  then prints how many frames matched, mismatched or were overwritten before it got to them.
+*  Exits with 0 only if at least one frame was verified and none mismatched, so it can stand in as a local test.
+*
+*  Linux only:  g++ -O2 -std=c++14 -I"../Assignment4" FrameRingConsumer.cpp -o FrameRingConsumer -lrt
+*  Usage:       FrameRingConsumer /rs_frames [frames to verify, default until the producer closes]
+*  Producer:    RS_SHARED_MEMORY=/rs_frames ./Assignment4
+*/
+#include "SharedFrameRing.h"
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <chrono>
+
+#if !defined(__linux__)
+int main()
+{
+	fprintf(stderr, "FrameRingConsumer needs Linux shared memory and futexes\n");
+	return 1;
+}
+#else
+
+/* Maps the ring read only, waits up to timeoutSeconds for the producer to create it */
+const SharedFrameRingHeader* AttachToRing(const char* name, int timeoutSeconds)
+{
+	for (int attempt = 0; attempt < timeoutSeconds * 10; attempt++)
+	{
+		int file = shm_open(name, O_RDONLY, 0);
+		if (file >= 0)
+		{
+			struct stat status;
+			if (fstat(file, &status) == 0 && static_cast<uint64_t>(status.st_size) >= sizeof(SharedFrameRingHeader))
+			{
+				void* memory = mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, file, 0);
+				close(file);
+				if (memory == MAP_FAILED) { return nullptr; }
+
+				const SharedFrameRingHeader* header = static_cast<const SharedFrameRingHeader*>(memory);
+				if (header->Magic == SHARED_FRAME_RING_MAGIC && header->Version == SHARED_FRAME_RING_VERSION &&
+					SharedFrameRing::GetObjectSize(header->Width, header->Height) <= static_cast<uint64_t>(status.st_size))
+				{
+					std::atomic_thread_fence(std::memory_order_acquire);
+					return header;
+				}
+				munmap(memory, status.st_size);
+			}
+			else
+			{
+				close(file);
+			}
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+	return nullptr;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s <shared memory name> [frames to verify]\n", argv[0]);
+		return 1;
+	}
+
+	unsigned long long frameTarget = argc > 2 ? strtoull(argv[2], nullptr, 10) : 0;
+
+	const SharedFrameRingHeader* header = AttachToRing(argv[1], 10);
+	if (!header)
+	{
+		fprintf(stderr, "could not attach to %s\n", argv[1]);
+		return 1;
+	}
+
+	printf("attached to %s: %ux%u, format %u, %u slots\n", argv[1], header->Width, header->Height, header->Format, header->SlotCount);
+
+	// The futex word lives in memory mapped read only, FUTEX_WAIT only ever reads it
+	std::atomic<uint32_t>& publishedFrames = const_cast<std::atomic<uint32_t>&>(header->PublishedFrames);
+	const uint8_t* pixels = reinterpret_cast<const uint8_t*>(header) + header->PixelsOffset;
+
+	unsigned long long verified = 0;
+	unsigned long long mismatched = 0;
+	unsigned long long dropped = 0;
+	double totalLatencyMilliseconds = 0.0;
+
+	// Start with the newest frame, anything published before attaching is not ours to count
+	uint64_t nextFrame = publishedFrames.load(std::memory_order_acquire);
+	uint64_t published = nextFrame;
+
+	while (!frameTarget || verified + mismatched < frameTarget)
+	{
+		uint32_t seen = publishedFrames.load(std::memory_order_acquire);
+		if (seen == static_cast<uint32_t>(published))
+		{
+			if (header->ProducerClosed.load(std::memory_order_acquire)) { break; }
+			SharedFrameRing::WaitForFrame(publishedFrames, seen, 1000000000);
+			continue;
+		}
+
+		// Extend the 32 bit counter, it never advances by 2^32 between two looks
+		published += static_cast<uint32_t>(seen - static_cast<uint32_t>(published));
+
+		// Frames more than a ring behind were overwritten already
+		if (published - nextFrame > header->SlotCount)
+		{
+			dropped += published - header->SlotCount - nextFrame;
+			nextFrame = published - header->SlotCount;
+		}
+
+		for (; nextFrame < published; nextFrame++)
+		{
+			const SharedFrameSlot& slot = header->Slots[nextFrame % header->SlotCount];
+			const uint32_t* slotPixels = reinterpret_cast<const uint32_t*>(pixels + (nextFrame % header->SlotCount) * header->SlotStride);
+
+			uint64_t sequence = slot.Sequence.load(std::memory_order_acquire);
+			if (sequence != 2 * nextFrame + 2)
+			{
+				dropped++;
+				continue;
+			}
+
+			uint64_t expectedChecksum = slot.Checksum;
+			uint64_t timestamp = slot.TimestampNanoseconds;
+			uint64_t checksum = SharedFrameRing::Checksum(slotPixels, header->SlotStride / 4);
+
+			// Overwritten while we were reading it, the checksum means nothing
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.Sequence.load(std::memory_order_relaxed) != sequence)
+			{
+				dropped++;
+				continue;
+			}
+
+			if (checksum == expectedChecksum)
+			{
+				verified++;
+				totalLatencyMilliseconds += (SharedFrameRing::TimestampNanoseconds() - timestamp) / 1000000.0;
+			}
+			else
+			{
+				mismatched++;
+				fprintf(stderr, "frame %llu: checksum %016llx, expected %016llx\n",
+					static_cast<unsigned long long>(nextFrame), static_cast<unsigned long long>(checksum), static_cast<unsigned long long>(expectedChecksum));
+			}
+		}
+	}
+
+	printf("verified %llu, mismatched %llu, dropped %llu", verified, mismatched, dropped);
+	if (verified) { printf(", average latency %.3f ms", totalLatencyMilliseconds / verified); }
+	printf("\n");
+
+	return (verified > 0 && mismatched == 0) ? 0 : 1;
+}
+#endif // __linux__
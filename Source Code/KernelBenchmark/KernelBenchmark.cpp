@@ -0,0 +1,483 @@
+/* Microbenchmarks of the renderer's hot kernels: the color math, texture filtering, matrix transforms,
+*  PS_Texture for every TextureFilter, texture fetches in every TextureLayout and format and single triangle fills of several sizes with every fill path.
+*  Every kernel runs in batches sized to take at least the minimum repetition time, then is repeated and reported as
+*  ns per operation (median, min and relative standard deviation over the repetitions) and throughput.
+*
+*  Build the KernelBenchmark project of the solution in Release, or on Linux:
+*               g++ -O2 -std=c++14 -Wno-psabi -I"../Assignment4" KernelBenchmark.cpp -o KernelBenchmark -lpthread
+*               (no -mavx2 / -march: the AVX2 kernels are compiled for AVX2 on their own and only run when the cpu has it)
+*  Usage:       KernelBenchmark [--filter <name substring>] [--repetitions N, default 10] [--min-time <ms per repetition, default 50>]
+*/
+
+// Scopes in the rasterizer would be timed along with the kernels
+#define PROFILING_ENABLED 0
+
+#include "Rasterization_Functions.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+/* Inputs are read from tables this big, indexed by the iteration, so no call can be hoisted out of a loop */
+const unsigned int INPUT_COUNT = 1024;
+const unsigned int INPUT_MASK = INPUT_COUNT - 1;
+const unsigned int MATRIX_COUNT = 64;
+
+const unsigned int TEXTURE_SIZE = 256;
+
+/* Texture the layout benchmarks walk, far bigger than the caches */
+const unsigned int LARGE_TEXTURE_SIZE = 2048;
+
+/* Every kernel's checksum ends up here, so the compiler has to compute them */
+volatile unsigned int gBenchmarkSink = 0;
+
+struct BenchmarkOptions
+{
+	const char* Filter = nullptr;
+	unsigned int Repetitions = 10;
+	double MinRepetitionSeconds = 0.05;
+};
+
+/* Runs iterations operations of a kernel and returns a value that depends on every one of their results */
+typedef std::function<unsigned int(unsigned int iterations)> KernelFunction;
+
+/* Deterministic inputs, the same on every run and every machine */
+struct BenchmarkInputs
+{
+	unsigned int Colors[INPUT_COUNT];
+	float Ratios[INPUT_COUNT];
+	Vector3D Barycentrics[INPUT_COUNT];
+	Vertex Vertices[INPUT_COUNT];
+	PixelShaderInput PixelInputs[INPUT_COUNT];
+	float TexCoordsU[INPUT_COUNT];
+	float TexCoordsV[INPUT_COUNT];
+	Matrix4D Matrices[MATRIX_COUNT];
+};
+
+/* xorshift32, rand() differs between C runtimes */
+unsigned int NextRandom(unsigned int& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+float NextRandomRatio(unsigned int& state)
+{
+	return (NextRandom(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+void InitializeInputs(BenchmarkInputs& inputs, unsigned int maxMipMapLevel)
+{
+	unsigned int state = 0x9E3779B9u;
+	for (unsigned int i = 0; i < INPUT_COUNT; i++)
+	{
+		inputs.Colors[i] = NextRandom(state);
+		inputs.Ratios[i] = NextRandomRatio(state);
+
+		float alpha = NextRandomRatio(state);
+		float beta = NextRandomRatio(state) * (1.0f - alpha);
+		inputs.Barycentrics[i] = Vector3D(alpha, beta, 1.0f - alpha - beta);
+
+		inputs.Vertices[i] = Vertex(NextRandomRatio(state) * 2.0f - 1.0f, NextRandomRatio(state) * 2.0f - 1.0f, NextRandomRatio(state), 1.0f);
+
+		inputs.PixelInputs[i].TexCoordU = NextRandomRatio(state);
+		inputs.PixelInputs[i].TexCoordV = NextRandomRatio(state);
+		inputs.PixelInputs[i].MipMapLod = NextRandomRatio(state) * maxMipMapLevel;
+
+		inputs.TexCoordsU[i] = inputs.PixelInputs[i].TexCoordU;
+		inputs.TexCoordsV[i] = inputs.PixelInputs[i].TexCoordV;
+	}
+
+	for (unsigned int i = 0; i < MATRIX_COUNT; i++)
+	{
+		Matrix4D& matrix = inputs.Matrices[i];
+		for (int row = 0; row < 4; row++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				matrix(row, column) = NextRandomRatio(state) * 2.0f - 1.0f;
+			}
+		}
+	}
+}
+
+/* A size square of noisy gradients and its mip chain down to 1x1 */
+void CreateMipChain(MipChain& mipChain, unsigned int size, TextureLayout layout, TextureFormat format)
+{
+	std::vector<unsigned int> pixels(size * size);
+
+	unsigned int state = 0x2545F491u;
+	for (unsigned int y = 0; y < size; y++)
+	{
+		for (unsigned int x = 0; x < size; x++)
+		{
+			unsigned int noise = NextRandom(state) & 0x3F;
+			pixels[Math::Convert2DTo1D(x, y, size)] = ALPHA_CHANNEL | ((x + noise) & 0xFF) << 16 | ((y + noise) & 0xFF) << 8 | ((x ^ y) & 0xFF);
+		}
+	}
+
+	mipChain.Build(pixels.data(), size, size, layout, format);
+}
+
+/* Seconds one call of kernel with iterations operations takes */
+double TimeKernel(const KernelFunction& kernel, unsigned int iterations)
+{
+	long long start = ProfileClock::Now();
+	gBenchmarkSink ^= kernel(iterations);
+	return (ProfileClock::Now() - start) / 1e9;
+}
+
+/* Calibrates the batch size to options.MinRepetitionSeconds, times options.Repetitions batches and prints one row.
+*  itemsPerOperation scales the throughput column, e.g. the pixels each triangle fill covers
+*/
+void RunBenchmark(const BenchmarkOptions& options, const char* name, const char* itemName, double itemsPerOperation, const KernelFunction& kernel)
+{
+	if (options.Filter && !strstr(name, options.Filter)) { return; }
+
+	// Doubling also warms up the caches and the branch predictors
+	unsigned int iterations = 1;
+	double seconds = TimeKernel(kernel, iterations);
+	while (seconds < options.MinRepetitionSeconds && iterations < (1u << 30))
+	{
+		double scale = seconds > 0.0 ? (std::min)(options.MinRepetitionSeconds * 1.2 / seconds, 100.0) : 100.0;
+		iterations = static_cast<unsigned int>((std::min)(iterations * (std::max)(scale, 2.0), static_cast<double>(1u << 30)));
+		seconds = TimeKernel(kernel, iterations);
+	}
+
+	std::vector<double> nanosecondsPerOperation;
+	for (unsigned int i = 0; i < options.Repetitions; i++)
+	{
+		nanosecondsPerOperation.push_back(TimeKernel(kernel, iterations) * 1e9 / iterations);
+	}
+	std::sort(nanosecondsPerOperation.begin(), nanosecondsPerOperation.end());
+
+	double mean = 0.0;
+	for (double value : nanosecondsPerOperation) { mean += value; }
+	mean /= nanosecondsPerOperation.size();
+
+	double variance = 0.0;
+	for (double value : nanosecondsPerOperation) { variance += (value - mean) * (value - mean); }
+	double deviation = nanosecondsPerOperation.size() > 1 ? sqrt(variance / (nanosecondsPerOperation.size() - 1)) : 0.0;
+
+	double median = nanosecondsPerOperation[nanosecondsPerOperation.size() / 2];
+	if (nanosecondsPerOperation.size() % 2 == 0)
+	{
+		median = (median + nanosecondsPerOperation[nanosecondsPerOperation.size() / 2 - 1]) * 0.5;
+	}
+
+	printf("%-40s %12.3f %12.3f %8.2f%% %12.2f M%s/s\n", name, median, nanosecondsPerOperation.front(),
+		mean > 0.0 ? deviation * 100.0 / mean : 0.0, median > 0.0 ? itemsPerOperation * 1e3 / median : 0.0, itemName);
+}
+
+void RunColorBenchmarks(const BenchmarkOptions& options, BenchmarkInputs& inputs)
+{
+	RunBenchmark(options, "Math::LerpColor", "op", 1.0, [&](unsigned int iterations)
+	{
+		unsigned int checksum = 0;
+		for (unsigned int i = 0; i < iterations; i++)
+		{
+			unsigned int j = i & INPUT_MASK;
+			checksum += Math::LerpColor(inputs.Colors[j], inputs.Colors[(j + 1) & INPUT_MASK], inputs.Ratios[j]);
+		}
+		return checksum;
+	});
+
+	RunBenchmark(options, "Math::BlendColor", "op", 1.0, [&](unsigned int iterations)
+	{
+		unsigned int checksum = 0;
+		for (unsigned int i = 0; i < iterations; i++)
+		{
+			unsigned int j = i & INPUT_MASK;
+			checksum += Math::BlendColor(inputs.Colors[j], inputs.Colors[(j + 1) & INPUT_MASK]);
+		}
+		return checksum;
+	});
+
+	RunBenchmark(options, "Math::ModulateColors", "op", 1.0, [&](unsigned int iterations)
+	{
+		unsigned int checksum = 0;
+		for (unsigned int i = 0; i < iterations; i++)
+		{
+			unsigned int j = i & INPUT_MASK;
+			checksum += Math::ModulateColors(inputs.Colors[j], inputs.Colors[(j + 1) & INPUT_MASK]);
+		}
+		return checksum;
+	});
+
+	RunBenchmark(options, "Math::BlendColorsWithBarycentricCoords", "op", 1.0, [&](unsigned int iterations)
+	{
+		unsigned int checksum = 0;
+		for (unsigned int i = 0; i < iterations; i++)
+		{
+			unsigned int j = i & INPUT_MASK;
+			checksum += Math::BlendColorsWithBarycentricCoordinates(inputs.Colors[j], inputs.Colors[(j + 1) & INPUT_MASK],
+				inputs.Colors[(j + 2) & INPUT_MASK], inputs.Barycentrics[j]);
+		}
+		return checksum;
+	});
+}
+
+void RunTransformBenchmarks(const BenchmarkOptions& options, BenchmarkInputs& inputs)
+{
+	RunBenchmark(options, "Matrix4D::operator*(Matrix4D)", "op", 1.0, [&](unsigned int iterations)
+	{
+		float checksum = 0.0f;
+		for (unsigned int i = 0; i < iterations; i++)
+		{
+			unsigned int j = i & (MATRIX_COUNT - 1);
+			Matrix4D product = inputs.Matrices[j] * inputs.Matrices[(j + 1) & (MATRIX_COUNT - 1)];
+			for (int row = 0; row < 4; row++)
+			{
+				checksum += product(row, 0) + product(row, 1) + product(row, 2) + product(row, 3);
+			}
+		}
+		return static_cast<unsigned int>(checksum);
+	});
+
+	RunBenchmark(options, "Math::MultiplyVertexByMatrix", "vertex", 1.0, [&](unsigned int iterations)
+	{
+		float checksum = 0.0f;
+		for (unsigned int i = 0; i < iterations; i++)
+		{
+			unsigned int j = i & INPUT_MASK;
+			Vertex vertex = inputs.Vertices[j];
+			Math::MultiplyVertexByMatrix(vertex, inputs.Matrices[j & (MATRIX_COUNT - 1)]);
+			checksum += vertex.X + vertex.Y + vertex.Z + vertex.W;
+		}
+		return static_cast<unsigned int>(checksum);
+	});
+}
+
+/* iterations calls of Sampler::SampleBilinearBlock, each filtering Lanes::Width texels */
+template<class Lanes>
+unsigned int SampleBilinearBlocks(const BenchmarkInputs& inputs, const MipLevel& level, unsigned int iterations)
+{
+	alignas(32) unsigned int texels[Lanes::Width];
+	unsigned int checksum = 0;
+	for (unsigned int i = 0; i < iterations; i++)
+	{
+		unsigned int j = (i * Lanes::Width) & INPUT_MASK;
+		Lanes::StoreInt(texels, Sampler::SampleBilinearBlock<Lanes>(level, Lanes::Load(inputs.TexCoordsU + j), Lanes::Load(inputs.TexCoordsV + j), Lanes::FullMask));
+		checksum += texels[i & (Lanes::Width - 1)];
+	}
+	return checksum;
+}
+
+#if SIMD_AVX2_AVAILABLE
+SIMD_AVX2_ENTRY unsigned int SampleBilinearBlocksAVX2(const BenchmarkInputs& inputs, const MipLevel& level, unsigned int iterations)
+{
+	return SampleBilinearBlocks<AVX2Lanes>(inputs, level, iterations);
+}
+#endif
+
+/* One call of sampleBlocks' kernel filters lanes texels */
+void RunSamplingBlockBenchmark(const BenchmarkOptions& options, const char* name, BenchmarkInputs& inputs, const MipLevel& level, int lanes,
+	unsigned int (*sampleBlocks)(const BenchmarkInputs&, const MipLevel&, unsigned int))
+{
+	RunBenchmark(options, name, "texel", lanes, [&](unsigned int iterations)
+	{
+		return sampleBlocks(inputs, level, iterations);
+	});
+}
+
+void RunSamplingBenchmarks(const BenchmarkOptions& options, BenchmarkInputs& inputs, RenderContext& context)
+{
+	const MipLevel& level = context.TextureSampler.GetLevel(0);
+	RunBenchmark(options, "Sampler::SampleBilinear", "texel", 1.0, [&](unsigned int iterations)
+	{
+		unsigned int checksum = 0;
+		for (unsigned int i = 0; i < iterations; i++)
+		{
+			const PixelShaderInput& input = inputs.PixelInputs[i & INPUT_MASK];
+			checksum += Sampler::SampleBilinear(level, input.TexCoordU, input.TexCoordV);
+		}
+		return checksum;
+	});
+
+#if SIMD_SSE2_AVAILABLE
+	RunSamplingBlockBenchmark(options, "Sampler::SampleBilinearBlock SSE2", inputs, level, SSE2Lanes::Width, SampleBilinearBlocks<SSE2Lanes>);
+#endif
+#if SIMD_AVX2_AVAILABLE
+	if (SIMD::IsAVX2Supported())
+	{
+		RunSamplingBlockBenchmark(options, "Sampler::SampleBilinearBlock AVX2", inputs, level, 8, SampleBilinearBlocksAVX2);
+	}
+#endif
+
+	const TextureFilter filters[] = { TextureFilter::NEAREST, TextureFilter::BILINEAR, TextureFilter::TRILINEAR };
+	const char* names[] = { "PS_Texture NEAREST", "PS_Texture BILINEAR", "PS_Texture TRILINEAR" };
+	for (unsigned int filter = 0; filter < 3; filter++)
+	{
+		context.SamplerFilter = filters[filter];
+		RunBenchmark(options, names[filter], "pixel", 1.0, [&](unsigned int iterations)
+		{
+			unsigned int checksum = 0;
+			for (unsigned int i = 0; i < iterations; i++)
+			{
+				unsigned int pixel = 0;
+				PS_Texture(context, inputs.PixelInputs[i & INPUT_MASK], pixel);
+				checksum += pixel;
+			}
+			return checksum;
+		});
+	}
+}
+
+/* Bilinear filters LARGE_TEXTURE_SIZE texels in a line, one texel apart, along u (rows) or v (columns), in every TextureLayout
+*  and compressed. Walking v reads a new row every texel: linear storage touches a new cache line each time, tiled one every 4 texels.
+*  Compressed textures read a quarter to an eighth of the bytes, then decode them through the thread's DecodedBlockCache
+*/
+void RunTextureLayoutBenchmarks(const BenchmarkOptions& options)
+{
+	const TextureLayout layouts[] = { TextureLayout::Linear, TextureLayout::Tiled, TextureLayout::Tiled, TextureLayout::Tiled };
+	const TextureFormat formats[] = { TextureFormat::ARGB, TextureFormat::ARGB, TextureFormat::BC1, TextureFormat::BC3 };
+	const char* layoutNames[] = { "Linear", "Tiled", "Tiled BC1", "Tiled BC3" };
+
+	for (unsigned int layout = 0; layout < 4; layout++)
+	{
+		MipChain mipChain;
+		CreateMipChain(mipChain, LARGE_TEXTURE_SIZE, layouts[layout], formats[layout]);
+		const MipLevel& level = mipChain.GetLevels()[0];
+
+		for (unsigned int bAlongV = 0; bAlongV < 2; bAlongV++)
+		{
+			char name[64];
+			snprintf(name, sizeof(name), "Texture layout %s along %s", layoutNames[layout], bAlongV ? "v" : "u");
+			RunBenchmark(options, name, "texel", 1.0, [&](unsigned int iterations)
+			{
+				const float texelSize = 1.0f / LARGE_TEXTURE_SIZE;
+				unsigned int checksum = 0;
+				for (unsigned int i = 0; i < iterations; i++)
+				{
+					// A new line, one texel over, every LARGE_TEXTURE_SIZE samples
+					float along = ((i & (LARGE_TEXTURE_SIZE - 1)) + 0.25f) * texelSize;
+					float across = ((i / LARGE_TEXTURE_SIZE) + 0.25f) * texelSize;
+					checksum += bAlongV ? Sampler::SampleBilinear(level, across, along) : Sampler::SampleBilinear(level, along, across);
+				}
+				return checksum;
+			});
+		}
+	}
+}
+
+/* Draws one textured, bilinear filtered right triangle with legs size pixels long in the middle of the screen, over and over.
+*  It sits at a constant depth, which passes the depth test against itself, so every repetition fills every pixel again
+*/
+void RunTriangleFillBenchmarks(const BenchmarkOptions& options, RenderContext& context)
+{
+	// Identity matrices, the vertices are given in clip space
+	context.VertexShader = VS_World;
+	context.PixelShader = PS_Texture;
+	context.FrameMode = RenderFrameMode::Textured;
+	context.SamplerFilter = TextureFilter::BILINEAR;
+	context.WorldMatrix = Matrix4D::Identity();
+	context.ViewMatrix = Matrix4D::Identity();
+	context.ProjectionMatrix = Matrix4D::Identity();
+	context.CameraForwardVector = Vector3D(0.0f, 0.0f, 1.0f);
+	context.PointLightRadius = 1.0f;
+	context.AmbientTerm = 1.0f;
+
+	// Fill on this thread only, binning would time the Workers' scheduling as well
+	context.bTiledRasterization = false;
+
+	const unsigned int sizes[] = { 4, 16, 64, 256 };
+	const FillPath fillPaths[] = { FillPath::Scalar, FillPath::SSE2, FillPath::AVX2 };
+	const char* fillPathNames[] = { "Scalar", "SSE2", "AVX2" };
+	const unsigned int indices[] = { 0, 1, 2 };
+
+	for (unsigned int path = 0; path < 3; path++)
+	{
+		if ((fillPaths[path] == FillPath::SSE2 && !SIMD_SSE2_AVAILABLE) || (fillPaths[path] == FillPath::AVX2 && !SIMD::IsAVX2Supported()))
+		{
+			continue;
+		}
+		context.TriangleFillPath = fillPaths[path];
+
+		for (unsigned int size : sizes)
+		{
+			float width = 2.0f * size / (RASTER_WIDTH - 1);
+			float height = 2.0f * size / (RASTER_HEIGHT - 1);
+			Vertex vertices[3] =
+			{
+				Vertex(-0.5f * width, 0.5f * height, 0.5f, 1.0f, 0.0f, 0.0f),
+				Vertex(0.5f * width, 0.5f * height, 0.5f, 1.0f, 1.0f, 0.0f),
+				Vertex(-0.5f * width, -0.5f * height, 0.5f, 1.0f, 0.0f, 1.0f)
+			};
+
+			// Count the pixels one fill covers, flipping the winding if it came out back facing
+			Rasterization::ClearBuffers(context, 0);
+			Rasterization::ResetPipelineStats(context);
+			Rasterization::DrawTriangleWithIndexBuffer(context, vertices, indices, 3);
+			if (context.Stats.TrianglesBackFaceCulled)
+			{
+				std::swap(vertices[1], vertices[2]);
+				Rasterization::ResetPipelineStats(context);
+				Rasterization::DrawTriangleWithIndexBuffer(context, vertices, indices, 3);
+			}
+			double pixels = static_cast<double>(context.Stats.FragmentsShaded.load());
+
+			char name[64];
+			snprintf(name, sizeof(name), "Triangle fill %s %ux%u", fillPathNames[path], size, size);
+			RunBenchmark(options, name, "pixel", pixels, [&](unsigned int iterations)
+			{
+				for (unsigned int i = 0; i < iterations; i++)
+				{
+					Rasterization::DrawTriangleWithIndexBuffer(context, vertices, indices, 3);
+				}
+				return context.Pixels[Math::Convert2DTo1D(RASTER_WIDTH / 2, RASTER_HEIGHT / 2, RASTER_WIDTH)];
+			});
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkOptions options;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+		{
+			options.Filter = argv[++i];
+		}
+		else if (strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc)
+		{
+			options.Repetitions = (std::max)(1, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+		{
+			options.MinRepetitionSeconds = (std::max)(1, atoi(argv[++i])) / 1000.0;
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--filter <name substring>] [--repetitions N] [--min-time <ms>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	RenderContext context;
+	MipChain mipChain;
+	CreateMipChain(mipChain, TEXTURE_SIZE, TEXTURES_TILED ? TextureLayout::Tiled : TextureLayout::Linear,
+		TEXTURES_COMPRESSED ? TextureFormat::BC1 : TextureFormat::ARGB);
+	context.TextureSampler = Sampler(mipChain);
+
+	BenchmarkInputs* inputs = new BenchmarkInputs();
+	InitializeInputs(*inputs, context.TextureSampler.MaxLevel);
+
+	printf("%u repetitions of at least %.0f ms each, AVX2 %s\n", options.Repetitions, options.MinRepetitionSeconds * 1000.0,
+		SIMD::IsAVX2Supported() ? "supported" : "not supported");
+	printf("%-40s %12s %12s %9s %16s\n", "", "median ns/op", "min ns/op", "stddev", "throughput");
+
+	RunColorBenchmarks(options, *inputs);
+	RunTransformBenchmarks(options, *inputs);
+	RunSamplingBenchmarks(options, *inputs, context);
+	RunTextureLayoutBenchmarks(options);
+	RunTriangleFillBenchmarks(options, context);
+
+	delete inputs;
+	return 0;
+}
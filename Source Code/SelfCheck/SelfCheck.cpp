@@ -0,0 +1,736 @@
+/* Checks that the renderer's fast paths compute exactly what the code they replace computes: every result is compared bit for bit,
+*  on deterministic inputs, against the path it was derived from. Prints a line per check and exits with 1 if any of them failed.
+*
+*  Build the SelfCheck project of the solution, or on Linux:
+*               g++ -O2 -std=c++14 -ffp-contract=off -Wno-psabi -I"../Assignment4" SelfCheck.cpp -o SelfCheck -lpthread
+*               (-ffp-contract=off: GCC fuses multiplies and adds wherever it sees them, differently in every path, MSVC doesn't unless asked to)
+*  Usage:       SelfCheck [--filter <name substring>]
+*/
+
+// The checks don't need the profiler's scopes
+#define PROFILING_ENABLED 0
+
+#include "Rasterization_Functions.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+const unsigned int TEXTURE_SIZE = 128;
+const unsigned int TRIANGLE_COUNT = 300;
+
+/* Texture coordinates every sampler check runs per mip level */
+const unsigned int SAMPLE_COUNT = 1 << 14;
+
+/* Random blocks the block decoding check fetches from, a few of them often and the rest seldom, FETCH_COUNT times */
+const unsigned int BLOCK_COUNT = 4096;
+const unsigned int HOT_BLOCK_COUNT = 16;
+const unsigned int FETCH_COUNT = 1 << 18;
+
+/* Screen space triangles the mip level check runs, each at most this many pixels a side */
+const unsigned int LOD_TRIANGLE_COUNT = 2000;
+const int LOD_TRIANGLE_SIZE = 48;
+
+struct CheckOptions
+{
+	const char* Filter = nullptr;
+};
+
+struct CheckResults
+{
+	unsigned int Passed = 0;
+	unsigned int Failed = 0;
+};
+
+/* xorshift32, rand() differs between C runtimes */
+unsigned int NextRandom(unsigned int& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+float NextRandomRatio(unsigned int& state)
+{
+	return (NextRandom(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+bool IsCheckSelected(const CheckOptions& options, const char* name)
+{
+	return !options.Filter || strstr(name, options.Filter);
+}
+
+/* Prints one check's line, mismatches of comparisons results differed */
+void ReportCheck(CheckResults& results, const char* name, unsigned long long mismatches, unsigned long long comparisons)
+{
+	printf("%-56s %s  %llu of %llu differ\n", name, mismatches ? "FAIL" : "ok  ", mismatches, comparisons);
+	(mismatches ? results.Failed : results.Passed)++;
+}
+
+/* A size square of noise with a gradient under it, so every mip level and every block differs from its neighbours */
+void CreateMipChain(MipChain& mipChain, unsigned int size, TextureLayout layout, TextureFormat format)
+{
+	std::vector<unsigned int> pixels(size * size);
+
+	unsigned int state = 0x2545F491u;
+	for (unsigned int y = 0; y < size; y++)
+	{
+		for (unsigned int x = 0; x < size; x++)
+		{
+			unsigned int noise = NextRandom(state);
+			unsigned int alpha = format == TextureFormat::BC3 ? (noise >> 24) : (ALPHA_CHANNEL >> 24);
+			pixels[Math::Convert2DTo1D(x, y, size)] = alpha << 24 | ((x * 2 + (noise & 0x3F)) & 0xFF) << 16 | ((y * 2 + (noise >> 8 & 0x3F)) & 0xFF) << 8 | (noise >> 16 & 0xFF);
+		}
+	}
+
+	mipChain.Build(pixels.data(), size, size, layout, format);
+}
+
+/* Random texture coordinates wrapping around the texture both ways and trilinear ratios, SAMPLE_COUNT of each */
+struct SampleInputs
+{
+	std::vector<float> U;
+	std::vector<float> V;
+	std::vector<float> Ratios;
+
+public:
+	SampleInputs()
+		: U(SAMPLE_COUNT), V(SAMPLE_COUNT), Ratios(SAMPLE_COUNT)
+	{
+		unsigned int state = 0x6C8E9CF5u;
+		for (unsigned int i = 0; i < SAMPLE_COUNT; i++)
+		{
+			U[i] = NextRandomRatio(state) * 5.0f - 2.0f;
+			V[i] = NextRandomRatio(state) * 5.0f - 2.0f;
+			Ratios[i] = NextRandomRatio(state);
+		}
+	}
+};
+
+/* The level trilinear filtering blends level with */
+const MipLevel& GetNextLevel(const MipChain& mipChain, unsigned int level)
+{
+	return mipChain.GetLevels()[(std::min)(level + 1, mipChain.GetLevelCount() - 1)];
+}
+
+/* Sampler's filtering one channel at a time, in plain integers, against its packed filtering of all 4 channels at once */
+unsigned int LerpTexelChannels(unsigned int start, unsigned int end, unsigned int weight)
+{
+	unsigned int texel = 0;
+	for (unsigned int shift = 0; shift < 32; shift += 8)
+	{
+		unsigned int startChannel = (start >> shift) & 0xFF;
+		unsigned int endChannel = (end >> shift) & 0xFF;
+		unsigned int channel = (startChannel * (Sampler::FILTER_WEIGHT_ONE - weight) + endChannel * weight + Sampler::FILTER_WEIGHT_ONE / 2) >> Sampler::FILTER_WEIGHT_BITS;
+		texel |= channel << shift;
+	}
+	return texel;
+}
+
+/* Sampler::SampleBilinear of an ARGB level from the same fixed point texel coordinates, filtering with LerpTexelChannels */
+unsigned int SampleBilinearReference(const MipLevel& level, float u, float v)
+{
+	unsigned int texelU = static_cast<unsigned int>(static_cast<int>(u * (level.ScaleU * Sampler::FILTER_WEIGHT_ONE)));
+	unsigned int texelV = static_cast<unsigned int>(static_cast<int>(v * (level.ScaleV * Sampler::FILTER_WEIGHT_ONE)));
+
+	unsigned int left = (texelU >> Sampler::FILTER_WEIGHT_BITS) & level.WidthMask;
+	unsigned int right = (left + 1) & level.WidthMask;
+	unsigned int top = (texelV >> Sampler::FILTER_WEIGHT_BITS) & level.HeightMask;
+	unsigned int bottom = (top + 1) & level.HeightMask;
+
+	unsigned int uWeight = texelU & (Sampler::FILTER_WEIGHT_ONE - 1);
+	unsigned int vWeight = texelV & (Sampler::FILTER_WEIGHT_ONE - 1);
+
+	unsigned int color1 = LerpTexelChannels(level.Pixels[level.GetTexelIndex(left, top)], level.Pixels[level.GetTexelIndex(right, top)], uWeight);
+	unsigned int color2 = LerpTexelChannels(level.Pixels[level.GetTexelIndex(left, bottom)], level.Pixels[level.GetTexelIndex(right, bottom)], uWeight);
+
+	return LerpTexelChannels(color1, color2, vWeight) | ALPHA_CHANNEL;
+}
+
+/* Sampler::SampleTrilinear of two ARGB levels, filtering with LerpTexelChannels */
+unsigned int SampleTrilinearReference(const MipLevel& level1, const MipLevel& level2, float u, float v, float ratio)
+{
+	unsigned int weight = static_cast<unsigned int>(ratio * Sampler::FILTER_WEIGHT_ONE);
+	return LerpTexelChannels(SampleBilinearReference(level1, u, v), SampleBilinearReference(level2, u, v), weight) | ALPHA_CHANNEL;
+}
+
+/* The scalar sampler of filter, what the block samplers are compared with */
+unsigned int SampleScalar(TextureFilter filter, const MipChain& mipChain, unsigned int level, float u, float v, float ratio)
+{
+	switch (filter)
+	{
+	case TextureFilter::NEAREST: return Sampler::SampleNearest(mipChain.GetLevels()[level], u, v);
+	case TextureFilter::BILINEAR: return Sampler::SampleBilinear(mipChain.GetLevels()[level], u, v);
+	case TextureFilter::TRILINEAR: return Sampler::SampleTrilinear(mipChain.GetLevels()[level], GetNextLevel(mipChain, level), u, v, ratio);
+	}
+	return 0;
+}
+
+/* Texels of every level of mipChain that the block sampler of filter returns differently from the scalar one, all lanes in the mask */
+template<class Lanes>
+unsigned long long CountBlockSamplerMismatches(TextureFilter filter, const MipChain& mipChain, const SampleInputs& inputs)
+{
+	unsigned int texels[Lanes::Width];
+	unsigned long long mismatches = 0;
+	for (unsigned int level = 0; level < mipChain.GetLevelCount(); level++)
+	{
+		const MipLevel& mipLevel = mipChain.GetLevels()[level];
+		for (unsigned int i = 0; i < SAMPLE_COUNT; i += Lanes::Width)
+		{
+			typename Lanes::Float u = Lanes::Load(&inputs.U[i]);
+			typename Lanes::Float v = Lanes::Load(&inputs.V[i]);
+			switch (filter)
+			{
+			case TextureFilter::NEAREST:
+				Lanes::StoreInt(texels, Sampler::SampleNearestBlock<Lanes>(mipLevel, u, v, Lanes::FullMask));
+				break;
+			case TextureFilter::BILINEAR:
+				Lanes::StoreInt(texels, Sampler::SampleBilinearBlock<Lanes>(mipLevel, u, v, Lanes::FullMask));
+				break;
+			case TextureFilter::TRILINEAR:
+				Lanes::StoreInt(texels, Sampler::SampleTrilinearBlock<Lanes>(mipLevel, GetNextLevel(mipChain, level), u, v, Lanes::Load(&inputs.Ratios[i]), Lanes::FullMask));
+				break;
+			}
+
+			for (int lane = 0; lane < Lanes::Width; lane++)
+			{
+				mismatches += texels[lane] != SampleScalar(filter, mipChain, level, inputs.U[i + lane], inputs.V[i + lane], inputs.Ratios[i + lane]);
+			}
+		}
+	}
+	return mismatches;
+}
+
+#if SIMD_AVX2_AVAILABLE
+SIMD_AVX2_ENTRY unsigned long long CountBlockSamplerMismatchesAVX2(TextureFilter filter, const MipChain& mipChain, const SampleInputs& inputs)
+{
+	return CountBlockSamplerMismatches<AVX2Lanes>(filter, mipChain, inputs);
+}
+#endif
+
+/* Sampler's packed fixed point filtering against the same filtering one channel at a time, then its SSE2 and AVX2 block
+*  samplers against the scalar ones, on every level of every layout and format
+*/
+void CheckSamplers(const CheckOptions& options, CheckResults& results)
+{
+	const TextureLayout layouts[] = { TextureLayout::Linear, TextureLayout::Tiled, TextureLayout::Tiled, TextureLayout::Tiled };
+	const TextureFormat formats[] = { TextureFormat::ARGB, TextureFormat::ARGB, TextureFormat::BC1, TextureFormat::BC3 };
+	const char* textureNames[] = { "Linear ARGB", "Tiled ARGB", "BC1", "BC3" };
+	const TextureFilter filters[] = { TextureFilter::NEAREST, TextureFilter::BILINEAR, TextureFilter::TRILINEAR };
+	const char* filterNames[] = { "Nearest", "Bilinear", "Trilinear" };
+
+	SampleInputs inputs;
+	for (unsigned int texture = 0; texture < 4; texture++)
+	{
+		MipChain mipChain;
+		CreateMipChain(mipChain, TEXTURE_SIZE, layouts[texture], formats[texture]);
+		unsigned long long comparisons = static_cast<unsigned long long>(SAMPLE_COUNT) * mipChain.GetLevelCount();
+		char name[96];
+
+		if (formats[texture] == TextureFormat::ARGB)
+		{
+			unsigned long long bilinearMismatches = 0;
+			unsigned long long trilinearMismatches = 0;
+			for (unsigned int level = 0; level < mipChain.GetLevelCount(); level++)
+			{
+				const MipLevel& mipLevel = mipChain.GetLevels()[level];
+				for (unsigned int i = 0; i < SAMPLE_COUNT; i++)
+				{
+					float u = inputs.U[i];
+					float v = inputs.V[i];
+					bilinearMismatches += Sampler::SampleBilinear(mipLevel, u, v) != SampleBilinearReference(mipLevel, u, v);
+					trilinearMismatches += Sampler::SampleTrilinear(mipLevel, GetNextLevel(mipChain, level), u, v, inputs.Ratios[i]) !=
+						SampleTrilinearReference(mipLevel, GetNextLevel(mipChain, level), u, v, inputs.Ratios[i]);
+				}
+			}
+
+			snprintf(name, sizeof(name), "Sampler::SampleBilinear per channel %s", textureNames[texture]);
+			if (IsCheckSelected(options, name)) { ReportCheck(results, name, bilinearMismatches, comparisons); }
+			snprintf(name, sizeof(name), "Sampler::SampleTrilinear per channel %s", textureNames[texture]);
+			if (IsCheckSelected(options, name)) { ReportCheck(results, name, trilinearMismatches, comparisons); }
+		}
+
+		for (unsigned int filter = 0; filter < 3; filter++)
+		{
+			snprintf(name, sizeof(name), "Sampler::Sample%sBlock SSE2 %s", filterNames[filter], textureNames[texture]);
+			if (SIMD_SSE2_AVAILABLE && IsCheckSelected(options, name))
+			{
+				ReportCheck(results, name, CountBlockSamplerMismatches<SSE2Lanes>(filters[filter], mipChain, inputs), comparisons);
+			}
+
+#if SIMD_AVX2_AVAILABLE
+			snprintf(name, sizeof(name), "Sampler::Sample%sBlock AVX2 %s", filterNames[filter], textureNames[texture]);
+			if (SIMD::IsAVX2Supported() && IsCheckSelected(options, name))
+			{
+				ReportCheck(results, name, CountBlockSamplerMismatchesAVX2(filters[filter], mipChain, inputs), comparisons);
+			}
+#endif
+		}
+	}
+}
+
+/* An RGB565 endpoint's channel of width bits expanded to 8 bits by repeating its top bits */
+unsigned int ExpandChannel(unsigned int endpoint, unsigned int shift, unsigned int bits)
+{
+	unsigned int channel = (endpoint >> shift) & ((1u << bits) - 1);
+	return (channel << (8 - bits)) | (channel >> (2 * bits - 8));
+}
+
+/* Texel texel of a BC1 (alpha is unused) or BC3 block straight from the block's bits, one channel at a time with plain divisions */
+unsigned int DecodeTexelReference(TextureFormat format, unsigned long long color, unsigned long long alpha, unsigned int texel)
+{
+	unsigned int endpoint0 = static_cast<unsigned int>(color & 0xFFFF);
+	unsigned int endpoint1 = static_cast<unsigned int>((color >> 16) & 0xFFFF);
+	unsigned int index = static_cast<unsigned int>(color >> (32 + texel * 2)) & 3;
+	bool bFourColors = format == TextureFormat::BC3 || endpoint0 > endpoint1;
+
+	// BC1's fourth color of three is transparent black
+	if (!bFourColors && index == 3) { return 0; }
+
+	const unsigned int shifts[] = { 0, 5, 11 };
+	const unsigned int bits[] = { 5, 6, 5 };
+	unsigned int result = ALPHA_CHANNEL;
+	for (unsigned int channel = 0; channel < 3; channel++)
+	{
+		unsigned int value0 = ExpandChannel(endpoint0, shifts[channel], bits[channel]);
+		unsigned int value1 = ExpandChannel(endpoint1, shifts[channel], bits[channel]);
+
+		unsigned int value = index == 0 ? value0 : value1;
+		if (index == 2) { value = bFourColors ? (value0 * 2 + value1) / 3 : (value0 + value1) / 2; }
+		if (index == 3) { value = (value0 + value1 * 2) / 3; }
+
+		result |= value << (channel * 8);
+	}
+
+	if (format != TextureFormat::BC3) { return result; }
+
+	unsigned int alpha0 = static_cast<unsigned int>(alpha & 0xFF);
+	unsigned int alpha1 = static_cast<unsigned int>((alpha >> 8) & 0xFF);
+	unsigned int alphaIndex = static_cast<unsigned int>(alpha >> (16 + texel * 3)) & 7;
+
+	unsigned int alphaValue = alphaIndex == 0 ? alpha0 : alpha1;
+	if (alphaIndex >= 2 && alpha0 > alpha1) { alphaValue = (alpha0 * (8 - alphaIndex) + alpha1 * (alphaIndex - 1)) / 7; }
+	if (alphaIndex >= 2 && alpha0 <= alpha1) { alphaValue = alphaIndex == 6 ? 0 : alphaIndex == 7 ? 255 : (alpha0 * (6 - alphaIndex) + alpha1 * (alphaIndex - 1)) / 5; }
+
+	return (result & ~ALPHA_CHANNEL) | alphaValue << 24;
+}
+
+/* Texels fetched through DecodedBlockCache, then through Sampler from encoded chains, against DecodeTexelReference.
+*  The cache gets random blocks of both BC1 modes and BC3, interleaved, so it hits, misses, evicts and tells the formats apart
+*/
+void CheckBlockDecoding(const CheckOptions& options, CheckResults& results)
+{
+	std::vector<unsigned long long> colors(BLOCK_COUNT);
+	std::vector<unsigned long long> alphas(BLOCK_COUNT);
+	unsigned int state = 0x85EBCA6Bu;
+	for (unsigned int i = 0; i < BLOCK_COUNT; i++)
+	{
+		colors[i] = static_cast<unsigned long long>(NextRandom(state)) << 32 | NextRandom(state);
+		alphas[i] = static_cast<unsigned long long>(NextRandom(state)) << 32 | NextRandom(state);
+	}
+
+	const char* cacheName = "DecodedBlockCache BC1 / BC3";
+	if (IsCheckSelected(options, cacheName))
+	{
+		DecodedBlockCache& cache = DecodedBlockCache::GetThreadCache();
+		unsigned long long mismatches = 0;
+		for (unsigned int i = 0; i < FETCH_COUNT; i++)
+		{
+			unsigned int random = NextRandom(state);
+			unsigned int block = (random & 1) ? (random >> 8) % HOT_BLOCK_COUNT : (random >> 8) % BLOCK_COUNT;
+			TextureFormat format = (random & 2) ? TextureFormat::BC3 : TextureFormat::BC1;
+			// BC3 blocks whose alpha word is 0 share their key with BC1 blocks of the same color
+			unsigned long long alpha = (format == TextureFormat::BC3 && (random & 4)) ? alphas[block] : 0;
+
+			const unsigned int* texels = cache.GetTexels(format, colors[block], alpha);
+			unsigned int texel = (random >> 3) & (BlockCompression::BLOCK_TEXELS - 1);
+			mismatches += texels[texel] != DecodeTexelReference(format, colors[block], alpha, texel);
+		}
+		ReportCheck(results, cacheName, mismatches, FETCH_COUNT);
+	}
+
+	const TextureFormat formats[] = { TextureFormat::BC1, TextureFormat::BC3 };
+	const char* names[] = { "Sampler::SampleNearest BC1 texels", "Sampler::SampleNearest BC3 texels" };
+	for (unsigned int format = 0; format < 2; format++)
+	{
+		if (!IsCheckSelected(options, names[format])) { continue; }
+
+		MipChain mipChain;
+		CreateMipChain(mipChain, TEXTURE_SIZE, TextureLayout::Tiled, formats[format]);
+
+		unsigned long long mismatches = 0;
+		unsigned long long comparisons = 0;
+		for (unsigned int level = 0; level < mipChain.GetLevelCount(); level++)
+		{
+			const MipLevel& mipLevel = mipChain.GetLevels()[level];
+			if (mipLevel.Format == TextureFormat::ARGB) { continue; }
+
+			for (unsigned int y = 0; y < mipLevel.Height; y++)
+			{
+				for (unsigned int x = 0; x < mipLevel.Width; x++)
+				{
+					// Tiles are blocks, so the texel index is the block's index then the texel's within it
+					unsigned int index = mipLevel.GetTexelIndex(x, y);
+					unsigned int block = index / BlockCompression::BLOCK_TEXELS;
+					unsigned long long color = mipLevel.Format == TextureFormat::BC3 ? mipLevel.Blocks[block * 2 + 1] : mipLevel.Blocks[block];
+					unsigned long long alpha = mipLevel.Format == TextureFormat::BC3 ? mipLevel.Blocks[block * 2] : 0;
+
+					unsigned int texel = Sampler::SampleNearest(mipLevel, (x + 0.5f) / mipLevel.ScaleU, (y + 0.5f) / mipLevel.ScaleV);
+					mismatches += texel != DecodeTexelReference(mipLevel.Format, color, alpha, index % BlockCompression::BLOCK_TEXELS);
+					comparisons++;
+				}
+			}
+		}
+		ReportCheck(results, names[format], mismatches, comparisons);
+	}
+}
+
+/* Pixels inside the triangle of edges where TexCoordGradients::GetLodBlock differs from GetLod, in blocks of Lanes::Width
+*  pixels the way the block fills walk the triangle's bounding box
+*/
+template<class Lanes>
+unsigned long long CountLodMismatches(const Texel& a, const Texel& b, const Texel& c, const TriangleEdges& edges, const TexCoordGradients& gradients,
+	unsigned long long& comparisons)
+{
+	// u / w, v / w and 1 / w at a pixel, from a's values and the gradients
+	float uOverWA = a.TexCoordU / a.W;
+	float vOverWA = a.TexCoordV / a.W;
+	float recipWA = 1.0f / a.W;
+
+	float laneUOverW[Lanes::Width];
+	float laneVOverW[Lanes::Width];
+	float laneRecipW[Lanes::Width];
+	float lods[Lanes::Width];
+
+	int startX = (std::min)((std::min)(a.X, b.X), c.X) & ~(Lanes::Width - 1);
+	int endX = (std::max)((std::max)(a.X, b.X), c.X);
+	int startY = (std::min)((std::min)(a.Y, b.Y), c.Y);
+	int endY = (std::max)((std::max)(a.Y, b.Y), c.Y);
+
+	unsigned long long mismatches = 0;
+	for (int y = startY; y <= endY; y++)
+	{
+		for (int x = startX; x <= endX; x += Lanes::Width)
+		{
+			for (int lane = 0; lane < Lanes::Width; lane++)
+			{
+				float stepsX = static_cast<float>(x + lane - a.X);
+				float stepsY = static_cast<float>(y - a.Y);
+				laneUOverW[lane] = uOverWA + stepsX * gradients.UdX + stepsY * gradients.UdY;
+				laneVOverW[lane] = vOverWA + stepsX * gradients.VdX + stepsY * gradients.VdY;
+				laneRecipW[lane] = recipWA + stepsX * gradients.RecipWdX + stepsY * gradients.RecipWdY;
+			}
+
+			Lanes::Store(lods, gradients.GetLodBlock<Lanes>(Lanes::Load(laneUOverW), Lanes::Load(laneVOverW), Lanes::Load(laneRecipW), x, y));
+
+			for (int lane = 0; lane < Lanes::Width; lane++)
+			{
+				// Only the pixels the fills shade, 1 / w goes through 0 further out
+				if (edges.BC.Evaluate(x + lane, y) < 0 || edges.CA.Evaluate(x + lane, y) < 0 || edges.AB.Evaluate(x + lane, y) < 0) { continue; }
+
+				float lod = gradients.GetLod(laneUOverW[lane], laneVOverW[lane], laneRecipW[lane], x + lane, y);
+				mismatches += memcmp(&lod, &lods[lane], sizeof(float)) != 0;
+				comparisons++;
+			}
+		}
+	}
+	return mismatches;
+}
+
+#if SIMD_AVX2_AVAILABLE
+SIMD_AVX2_ENTRY unsigned long long CountLodMismatchesAVX2(const Texel& a, const Texel& b, const Texel& c, const TriangleEdges& edges,
+	const TexCoordGradients& gradients, unsigned long long& comparisons)
+{
+	return CountLodMismatches<AVX2Lanes>(a, b, c, edges, gradients, comparisons);
+}
+#endif
+
+/* TexCoordGradients::GetLodBlock against GetLod, on every pixel of random screen space triangles at random depths */
+void CheckMipLevelSelection(const CheckOptions& options, CheckResults& results)
+{
+	MipChain mipChain;
+	CreateMipChain(mipChain, TEXTURE_SIZE, TextureLayout::Linear, TextureFormat::ARGB);
+	Sampler sampler(mipChain);
+
+	const char* names[] = { "TexCoordGradients::GetLodBlock SSE2", "TexCoordGradients::GetLodBlock AVX2" };
+	for (unsigned int path = 0; path < 2; path++)
+	{
+		if (!IsCheckSelected(options, names[path]) || (path == 0 && !SIMD_SSE2_AVAILABLE) || (path == 1 && !SIMD::IsAVX2Supported()))
+		{
+			continue;
+		}
+
+		unsigned long long mismatches = 0;
+		unsigned long long comparisons = 0;
+		unsigned int state = 0x1B873593u;
+		for (unsigned int i = 0; i < LOD_TRIANGLE_COUNT; i++)
+		{
+			int x = static_cast<int>(NextRandom(state) % (RASTER_WIDTH - LOD_TRIANGLE_SIZE));
+			int y = static_cast<int>(NextRandom(state) % (RASTER_HEIGHT - LOD_TRIANGLE_SIZE));
+			Texel vertices[3] = { Texel(0, 0), Texel(0, 0), Texel(0, 0) };
+			for (Texel& vertex : vertices)
+			{
+				vertex = Texel(x + static_cast<int>(NextRandom(state) % LOD_TRIANGLE_SIZE), y + static_cast<int>(NextRandom(state) % LOD_TRIANGLE_SIZE),
+					NextRandomRatio(state), 0.2f + NextRandomRatio(state) * 30.0f, NextRandomRatio(state) * 8.0f - 4.0f, NextRandomRatio(state) * 8.0f - 4.0f);
+			}
+
+			TriangleEdges edges(vertices[0], vertices[1], vertices[2]);
+			if (edges.Area == 0) { continue; }
+			TexCoordGradients gradients(vertices[0], vertices[1], vertices[2], edges, sampler);
+
+#if SIMD_SSE2_AVAILABLE
+			if (path == 0) { mismatches += CountLodMismatches<SSE2Lanes>(vertices[0], vertices[1], vertices[2], edges, gradients, comparisons); }
+#endif
+#if SIMD_AVX2_AVAILABLE
+			if (path == 1) { mismatches += CountLodMismatchesAVX2(vertices[0], vertices[1], vertices[2], edges, gradients, comparisons); }
+#endif
+		}
+		ReportCheck(results, names[path], mismatches, comparisons);
+	}
+}
+
+/* Draws the same TRIANGLE_COUNT random triangles, both windings, some of them crossing the near plane */
+void DrawRandomTriangles(RenderContext& context)
+{
+	const unsigned int indices[] = { 0, 1, 2 };
+
+	unsigned int state = 0x9E3779B9u;
+	for (unsigned int i = 0; i < TRIANGLE_COUNT; i++)
+	{
+		float depth = 0.5f + NextRandomRatio(state) * 20.0f;
+
+		Vertex vertices[3];
+		for (Vertex& vertex : vertices)
+		{
+			vertex = Vertex((NextRandomRatio(state) - 0.5f) * depth * 1.5f, (NextRandomRatio(state) - 0.5f) * depth * 1.5f,
+				depth + (NextRandomRatio(state) - 0.5f) * depth, 1.0f, NextRandomRatio(state) * 4.0f - 1.0f, NextRandomRatio(state) * 4.0f - 1.0f);
+			vertex.Normal = Vector3D(NextRandomRatio(state) - 0.5f, NextRandomRatio(state) - 0.5f, -1.0f);
+			vertex.Normal.Normalize();
+		}
+
+		Rasterization::DrawTriangleWithIndexBuffer(context, vertices, indices, 3);
+		std::swap(vertices[1], vertices[2]);
+		Rasterization::DrawTriangleWithIndexBuffer(context, vertices, indices, 3);
+	}
+}
+
+/* The SSE2 and AVX2 block fills against the scalar half space fill, color and depth of every pixel,
+*  through each of the pipelines DispatchTrianglePipeline picks and for every texture format
+*/
+void CheckTriangleFills(const CheckOptions& options, CheckResults& results, RenderContext& context)
+{
+	struct FillState
+	{
+		const char* Name;
+		RenderFrameMode FrameMode;
+		PixelShaderFunction PixelShader;
+		TextureFilter Filter;
+	};
+	const FillState states[] =
+	{
+		{ "Textured NEAREST", RenderFrameMode::Textured, PS_Texture, TextureFilter::NEAREST },
+		{ "Textured BILINEAR", RenderFrameMode::Textured, PS_Texture, TextureFilter::BILINEAR },
+		{ "Textured TRILINEAR", RenderFrameMode::Textured, PS_Texture, TextureFilter::TRILINEAR },
+		{ "Shaded", RenderFrameMode::Shaded, PS_Texture, TextureFilter::NEAREST },
+		{ "Dynamic pipeline", RenderFrameMode::Textured, PS_TextureFiltered<TextureFilter::BILINEAR>, TextureFilter::BILINEAR }
+	};
+	const TextureFormat formats[] = { TextureFormat::ARGB, TextureFormat::BC1, TextureFormat::BC3 };
+	const char* formatNames[] = { "ARGB", "BC1", "BC3" };
+	const FillPath fillPaths[] = { FillPath::SSE2, FillPath::AVX2 };
+	const char* fillPathNames[] = { "SSE2", "AVX2" };
+
+	context.VertexShader = VS_World;
+	context.WorldMatrix = Matrix4D::Identity();
+	context.ViewMatrix = Matrix4D::Identity();
+	context.ProjectionMatrix = Math::GetProjectionMatrix(RASTER_WIDTH, RASTER_HEIGHT, 90.0f, context.NearPlane, context.FarPlane);
+	context.CameraForwardVector = Vector3D(0.0f, 0.0f, 1.0f);
+	context.DirectionLightDirection = Vector3D(0.0f, 0.0f, 1.0f);
+	context.DirectionalLightColor = 0xFFC0A080;
+	context.PointLightPosition = Vector3D(0.0f, 0.0f, 2.0f);
+	context.PointLightColor = 0xFF4080FF;
+	context.PointLightRadius = 10.0f;
+	context.AmbientTerm = 0.2f;
+
+	// Fill on this thread only, the Workers fill tiles through the same paths
+	context.bTiledRasterization = false;
+
+	std::vector<unsigned int> referencePixels(TOTAL_PIXELS);
+	std::vector<float> referenceDepths(TOTAL_PIXELS);
+
+	for (unsigned int format = 0; format < 3; format++)
+	{
+		MipChain mipChain;
+		CreateMipChain(mipChain, TEXTURE_SIZE, TEXTURES_TILED ? TextureLayout::Tiled : TextureLayout::Linear, formats[format]);
+		context.TextureSampler = Sampler(mipChain);
+
+		for (const FillState& state : states)
+		{
+			context.FrameMode = state.FrameMode;
+			context.PixelShader = state.PixelShader;
+			context.SamplerFilter = state.Filter;
+
+			for (unsigned int path = 0; path < 2; path++)
+			{
+				char name[96];
+				snprintf(name, sizeof(name), "Triangle fill %s %s %s", fillPathNames[path], state.Name, formatNames[format]);
+				if (!IsCheckSelected(options, name) ||
+					(fillPaths[path] == FillPath::SSE2 && !SIMD_SSE2_AVAILABLE) || (fillPaths[path] == FillPath::AVX2 && !SIMD::IsAVX2Supported()))
+				{
+					continue;
+				}
+
+				context.TriangleFillPath = FillPath::Scalar;
+				Rasterization::ClearBuffers(context, 0);
+				DrawRandomTriangles(context);
+				std::copy(context.Pixels, context.Pixels + TOTAL_PIXELS, referencePixels.begin());
+				std::copy(context.DepthBuffer, context.DepthBuffer + TOTAL_PIXELS, referenceDepths.begin());
+
+				context.TriangleFillPath = fillPaths[path];
+				Rasterization::ClearBuffers(context, 0);
+				DrawRandomTriangles(context);
+
+				unsigned long long mismatches = 0;
+				for (unsigned int i = 0; i < TOTAL_PIXELS; i++)
+				{
+					mismatches += context.Pixels[i] != referencePixels[i] || memcmp(&context.DepthBuffer[i], &referenceDepths[i], sizeof(float)) != 0;
+				}
+				ReportCheck(results, name, mismatches, TOTAL_PIXELS);
+			}
+		}
+	}
+}
+
+/* A tile binned indexed draw against the same draw unbinned, color and depth of every pixel.
+*  Vertex normals are shown so the lines a triangle draws have to land behind its fill in the tile bins, as they do unbinned
+*/
+void CheckBinnedDraw(const CheckOptions& options, CheckResults& results, RenderContext& context)
+{
+	const char* name = "Tile binned draw with vertex normals";
+	if (!IsCheckSelected(options, name)) { return; }
+
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	unsigned int state = 0x27D4EB2Fu;
+	for (unsigned int i = 0; i < TRIANGLE_COUNT * 3; i++)
+	{
+		float depth = 0.5f + NextRandomRatio(state) * 20.0f;
+
+		Vertex vertex((NextRandomRatio(state) - 0.5f) * depth * 1.5f, (NextRandomRatio(state) - 0.5f) * depth * 1.5f,
+			depth, 1.0f, NextRandomRatio(state) * 4.0f - 1.0f, NextRandomRatio(state) * 4.0f - 1.0f);
+		vertex.Normal = Vector3D(NextRandomRatio(state) - 0.5f, NextRandomRatio(state) - 0.5f, -1.0f);
+		vertex.Normal.Normalize();
+
+		vertices.push_back(vertex);
+		indices.push_back(i);
+	}
+
+	MipChain mipChain;
+	CreateMipChain(mipChain, TEXTURE_SIZE, TEXTURES_TILED ? TextureLayout::Tiled : TextureLayout::Linear, TextureFormat::ARGB);
+	context.TextureSampler = Sampler(mipChain);
+	context.FrameMode = RenderFrameMode::Textured;
+	context.PixelShader = PS_Texture;
+	context.SamplerFilter = TextureFilter::NEAREST;
+	context.bShowTriangleVertexNormals = true;
+
+	context.bTiledRasterization = false;
+	Rasterization::ClearBuffers(context, 0);
+	Rasterization::DrawTriangleWithIndexBuffer(context, vertices.data(), indices.data(), static_cast<unsigned int>(indices.size()));
+	std::vector<unsigned int> referencePixels(context.Pixels, context.Pixels + TOTAL_PIXELS);
+	std::vector<float> referenceDepths(context.DepthBuffer, context.DepthBuffer + TOTAL_PIXELS);
+
+	context.bTiledRasterization = true;
+	Rasterization::ClearBuffers(context, 0);
+	Rasterization::DrawTriangleWithIndexBuffer(context, vertices.data(), indices.data(), static_cast<unsigned int>(indices.size()));
+
+	unsigned long long mismatches = 0;
+	for (unsigned int i = 0; i < TOTAL_PIXELS; i++)
+	{
+		mismatches += context.Pixels[i] != referencePixels[i] || memcmp(&context.DepthBuffer[i], &referenceDepths[i], sizeof(float)) != 0;
+	}
+	ReportCheck(results, name, mismatches, TOTAL_PIXELS);
+
+	context.bShowTriangleVertexNormals = false;
+	context.bTiledRasterization = false;
+}
+
+/* Vertex shading stats of an indexed VertexBuffer draw against the same draw from a Vertex array,
+*  with an index buffer that leaves part of the vertices unreferenced and references the rest several times
+*/
+void CheckVertexStats(const CheckOptions& options, CheckResults& results, RenderContext& context)
+{
+	const char* name = "Vertex stats VertexBuffer vs Vertex array";
+	if (!IsCheckSelected(options, name)) { return; }
+
+	const unsigned int VERTEX_COUNT = 64;
+	const unsigned int REFERENCED_COUNT = 48;
+	const unsigned int INDEX_COUNT = 300;
+
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	unsigned int state = 0x165667B1u;
+	for (unsigned int i = 0; i < VERTEX_COUNT; i++)
+	{
+		vertices.push_back(Vertex((NextRandomRatio(state) - 0.5f) * 8.0f, (NextRandomRatio(state) - 0.5f) * 8.0f, 2.0f + NextRandomRatio(state) * 8.0f, 1.0f,
+			NextRandomRatio(state), NextRandomRatio(state)));
+	}
+	for (unsigned int i = 0; i < INDEX_COUNT; i++)
+	{
+		indices.push_back(NextRandom(state) % REFERENCED_COUNT);
+	}
+
+	VertexBuffer vertexBuffer;
+	vertexBuffer.Assign(vertices.data(), VERTEX_COUNT);
+
+	MipChain mipChain;
+	CreateMipChain(mipChain, TEXTURE_SIZE, TEXTURES_TILED ? TextureLayout::Tiled : TextureLayout::Linear, TextureFormat::ARGB);
+	context.TextureSampler = Sampler(mipChain);
+	context.FrameMode = RenderFrameMode::Textured;
+	context.PixelShader = PS_Texture;
+	context.SamplerFilter = TextureFilter::NEAREST;
+
+	Rasterization::ClearBuffers(context, 0);
+	Rasterization::ResetPipelineStats(context);
+	Rasterization::DrawTriangleWithIndexBuffer(context, vertices.data(), indices.data(), INDEX_COUNT);
+	unsigned long long referenceShaded = context.Stats.VerticesShaded;
+	unsigned long long referenceHits = context.Stats.VertexCacheHits;
+
+	Rasterization::ClearBuffers(context, 0);
+	Rasterization::ResetPipelineStats(context);
+	Rasterization::DrawTriangleWithIndexBuffer(context, vertexBuffer, indices.data(), INDEX_COUNT);
+
+	unsigned long long mismatches = (context.Stats.VerticesShaded != referenceShaded) + (context.Stats.VertexCacheHits != referenceHits);
+	ReportCheck(results, name, mismatches, 2);
+}
+
+int main(int argc, char** argv)
+{
+	CheckOptions options;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+		{
+			options.Filter = argv[++i];
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--filter <name substring>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	printf("AVX2 %s\n", SIMD::IsAVX2Supported() ? "supported" : "not supported, its checks are skipped");
+
+	RenderContext context;
+	CheckResults results;
+
+	CheckTriangleFills(options, results, context);
+	CheckBinnedDraw(options, results, context);
+	CheckVertexStats(options, results, context);
+	CheckSamplers(options, results);
+	CheckMipLevelSelection(options, results);
+	CheckBlockDecoding(options, results);
+
+	printf("%u checks passed, %u failed\n", results.Passed, results.Failed);
+	return results.Failed ? 1 : 0;
+}